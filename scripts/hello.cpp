@@ -0,0 +1,15 @@
+// Sample in-process script: GET/POST /script/hello
+// Built against the runtime prelude (engine/script_api.h), so nothing needs including.
+
+static nn_str str(std::string_view s) { return nn_str{ s.data(), s.size() }; }
+
+extern "C" int doGet(const nn_request* req, nn_response* res) {
+    std::string body = "hello from " + std::string(req->path.data, req->path.size) + "\n";
+    res->add_header(res->ctx, str("Content-Type"), str("text/plain"));
+    return res->write(res->ctx, body.data(), body.size());
+}
+
+extern "C" int doPost(const nn_request* req, nn_response* res) {
+    res->add_header(res->ctx, str("Content-Type"), str("application/octet-stream"));
+    return res->write(res->ctx, req->body.data, req->body.size);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace common {
+
+// Read a line-based settings file: one `<key> <value...>` per line, with
+// empty lines and text after '#' ignored. Each line is handed to `apply`,
+// which returns false to reject it (an unknown key, a wrong number of values);
+// exceptions from number parsing reject it too. Errors are logged under
+// `log_tag` (e.g. "services/sqlite"). False if the file cannot be opened or
+// any line is rejected; callers parse into a copy so a bad file changes nothing.
+inline bool read_key_value_config(const std::string& path, const char* log_tag,
+                                  const std::function<bool(const std::string& key, const std::vector<std::string>& values)>& apply) {
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        std::cerr << "[" << log_tag << "] could not open " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(ifs, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        std::istringstream ss(line);
+        std::string key;
+        if (!(ss >> key)) continue;
+        std::vector<std::string> values;
+        for (std::string v; ss >> v;) values.push_back(v);
+
+        bool ok;
+        try {
+            ok = apply(key, values);
+        } catch (const std::exception&) {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "[" << log_tag << "] invalid setting '" << key << "' in " << path << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace common
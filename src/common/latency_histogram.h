@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace common {
+
+// Latency histogram with power-of-two microsecond buckets (<=1us, <=2us, ...
+// <=2^(BUCKETS-2)us, +Inf). Lock-free to record.
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 26; // last finite bucket ~16.7s
+
+    static size_t bucket_for(uint64_t ns) {
+        uint64_t us = (ns + 999) / 1000;
+        size_t b = 0;
+        while (b + 1 < BUCKETS && us > (1ULL << b)) ++b;
+        return b;
+    }
+
+    void record(uint64_t ns) {
+        buckets_[bucket_for(ns)].fetch_add(1, std::memory_order_relaxed);
+        sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+    // Prometheus series <name>_bucket, <name>_sum and <name>_count in seconds,
+    // each labelled with `labels` (e.g. phase="fork")
+    void render_prometheus(std::ostream& out, const char* name, const std::string& labels) const {
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            cumulative += buckets_[b].load(std::memory_order_relaxed);
+            out << name << "_bucket{" << labels << ",le=\"";
+            if (b + 1 == BUCKETS) out << "+Inf";
+            else out << static_cast<double>(1ULL << b) / 1e6;
+            out << "\"} " << cumulative << "\n";
+        }
+        out << name << "_sum{" << labels << "} " << static_cast<double>(sum_ns_.load(std::memory_order_relaxed)) / 1e9 << "\n"
+            << name << "_count{" << labels << "} " << count() << "\n";
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{ 0 };
+    std::atomic<uint64_t> sum_ns_{ 0 };
+};
+
+} // namespace common
@@ -1,15 +1,152 @@
 #include "engine.h"
+#include "preload.h"
+#include "prelude.h"
+#include "script_cache.h"
+#include "script_registry.h"
+#include "script_worker.h"
+#include "tiering.h"
+#include "sandbox/policy.h"
 #include <iostream>
 #include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
 
 namespace engine {
 
 static std::atomic<bool> g_initialized{false};
+static std::unique_ptr<TaskGraph> g_preload_graph;
+static std::thread g_preload;
 
+// Precompile the script API header and make every script compile use it.
+// With tiering, scripts use the per-tier preludes instead.
+static void build_runtime_prelude(const TierConfig& tiers) {
+    Prelude prelude = build_prelude(script_api_header_path(), "./cache/pch", script_cache().config());
+    if (!prelude.valid()) {
+        std::cerr << "[engine] no runtime prelude; scripts compile without it" << std::endl;
+        return;
+    }
+    set_runtime_prelude(prelude);
+    if (!tiers.enabled) script_cache().set_extra_flags(prelude.flags);
+}
+
+// A PCH is only used with the -O/-m flags it was built with, so each tier
+// gets its own prelude, in a sibling of ./cache/pch so they don't evict each other
+static std::vector<std::string> tier_prelude_flags(const std::vector<std::string>& tier_flags, const std::string& dir) {
+    CompilerConfig cfg = script_cache().config();
+    cfg.flags.insert(cfg.flags.end(), tier_flags.begin(), tier_flags.end());
+    Prelude prelude = build_prelude(script_api_header_path(), dir, cfg);
+    if (!prelude.valid()) {
+        std::cerr << "[engine] no prelude for tier flags in " << dir << "; compiling without it" << std::endl;
+        return {};
+    }
+    return prelude.flags;
+}
+
+// Every C++ source under `roots`, each file once
+static std::vector<std::string> discover_scripts(const std::vector<std::string>& roots) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> found;
+    std::set<std::string> seen;
+    for (const auto& root : roots) {
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            const auto ext = it->path().extension();
+            if (!it->is_regular_file() || (ext != ".cpp" && ext != ".cc" && ext != ".cxx")) continue;
+            if (seen.insert(fs::weakly_canonical(it->path(), ec).string()).second) found.push_back(it->path().string());
+        }
+    }
+    return found;
+}
+
+// Compile the scripts on a work-stealing pool while the rest of the process
+// comes up. The tier preludes go first (in parallel with each other) since
+// every script includes one; scripts of the registry are published as they
+// finish and tracked in preload_status(), others are only built into the cache.
+static void start_preload(const std::string& preload_path, const TierConfig& tiers) {
+    g_preload_graph = std::make_unique<TaskGraph>();
+    TaskGraph& graph = *g_preload_graph;
+    std::vector<TaskGraph::TaskId> preludes;
+    if (tiers.enabled) {
+        auto baseline = std::make_shared<std::vector<std::string>>();
+        auto optimized = std::make_shared<std::vector<std::string>>();
+        auto b = graph.add("prelude-baseline", [tiers, baseline] {
+            *baseline = tier_prelude_flags(tiers.baseline_flags, "./cache/pch-baseline");
+            return !baseline->empty();
+        });
+        auto o = graph.add("prelude-optimized", [tiers, optimized] {
+            *optimized = tier_prelude_flags(tiers.optimized_flags, "./cache/pch-optimized");
+            return !optimized->empty();
+        });
+        // Compile scripts at the baseline tier and optimize hot ones in the background
+        preludes.push_back(graph.add("tiering", [tiers, baseline, optimized] {
+            script_registry().enable_tiering(tiers, *baseline, *optimized);
+            std::cout << "[engine] tiered compilation on (optimize after " << tiers.hot_threshold << " calls)" << std::endl;
+            return true;
+        }, { b, o }));
+    }
+
+    std::vector<std::string> roots = { preload_path };
+    std::error_code ec;
+    if (!std::filesystem::equivalent(preload_path, script_registry().dir(), ec)) roots.push_back(script_registry().dir());
+    for (const auto& path : discover_scripts(roots)) {
+        std::string name = script_registry().name_for(path);
+        if (name.empty()) {
+            graph.add(path, [path] { return script_cache().load(path) != nullptr; }, preludes);
+            continue;
+        }
+        preload_status().set(name, ScriptState::Pending);
+        graph.add(name, [name, path] {
+            preload_status().set(name, ScriptState::Compiling);
+            bool ok = script_registry().reload(path);
+            preload_status().set(name, ok ? ScriptState::Ready : ScriptState::Failed);
+            return ok;
+        }, preludes);
+    }
+
+    g_preload = std::thread([] {
+        auto start = std::chrono::steady_clock::now();
+        size_t failed = g_preload_graph->run();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "[engine] preload finished in " << ms << " ms: " << script_registry().size() << " script(s) live"
+                  << (failed ? ", " + std::to_string(failed) + " task(s) failed" : "") << " (cache: "
+                  << script_cache().compiles() << " compiled, " << script_cache().hits() << " reused)" << std::endl;
+        // Recompile edits from now on; the rescan catches any made while preloading
+        if (!script_registry().start_watching()) {
+            std::cerr << "[engine] script hot reload unavailable; edits need a restart" << std::endl;
+        }
+        script_registry().load_all();
+        preload_status().set_done(true);
+    });
+}
+
+// Fork the sandboxed script workers (see initialize() for why this comes first)
+static void start_script_workers() {
+    auto policy = sandbox::policy_cache().get(sandbox::script_worker_policy_config());
+    if (!policy) {
+        std::cerr << "[engine] failed to compile the script worker policy; in-process scripts disabled" << std::endl;
+        return;
+    }
+    script_workers().set_policy(policy);
+    if (!script_workers().start()) {
+        std::cerr << "[engine] script workers failed to start; in-process scripts disabled" << std::endl;
+    }
+}
 
 bool initialize(const std::string& preload_path) {
     std::cout << "[engine] initializing (preload: " << preload_path << ")" << std::endl;
-    // Placeholder for JIT initialization (Cling/LLVM)
+    TierConfig tiers = configured_tiering();
+    // Synchronous: REPL sessions and untiered script builds both use it
+    build_runtime_prelude(tiers);
+    // Fork the workers while the process is single-threaded: main() starts
+    // the policy watcher, services and web server only after this returns,
+    // and the preload thread starts below
+    start_script_workers();
+    // Scripts become live one by one in the background; see /api/status
+    start_preload(preload_path, tiers);
     g_initialized = true;
     // Run a quick JIT smoke test if JIT is enabled
 #ifdef ENGINE_JIT
@@ -23,6 +160,12 @@ bool initialize(const std::string& preload_path) {
 
 void shutdown() {
     std::cout << "[engine] shutdown" << std::endl;
+    if (g_preload.joinable()) {
+        g_preload_graph->cancel();
+        g_preload.join();
+    }
+    script_registry().stop_watching();
+    script_workers().stop();
     g_initialized = false;
 }
 
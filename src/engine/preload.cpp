@@ -0,0 +1,160 @@
+#include "preload.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace engine {
+
+TaskGraph::TaskId TaskGraph::add(std::string name, std::function<bool()> fn, const std::vector<TaskId>& deps) {
+    TaskId id = tasks_.size();
+    auto task = std::make_unique<Task>();
+    task->name = std::move(name);
+    task->fn = std::move(fn);
+    for (TaskId dep : deps) {
+        if (dep >= id) continue; // only earlier tasks, so the graph stays acyclic
+        tasks_[dep]->dependents.push_back(id);
+        ++task->deps;
+    }
+    tasks_.push_back(std::move(task));
+    return id;
+}
+
+void TaskGraph::push(size_t worker, TaskId id) {
+    {
+        std::lock_guard<std::mutex> lk(workers_[worker]->mtx);
+        workers_[worker]->queue.push_back(id);
+    }
+    {
+        std::lock_guard<std::mutex> lk(idle_mtx_);
+        ++queued_;
+    }
+    idle_cv_.notify_one();
+}
+
+bool TaskGraph::pop(size_t self, TaskId& id) {
+    // Own work first, newest first
+    {
+        Worker& w = *workers_[self];
+        std::lock_guard<std::mutex> lk(w.mtx);
+        if (!w.queue.empty()) {
+            id = w.queue.back();
+            w.queue.pop_back();
+            return true;
+        }
+    }
+    // Then steal the oldest task of another worker
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        Worker& w = *workers_[(self + i) % workers_.size()];
+        std::lock_guard<std::mutex> lk(w.mtx);
+        if (!w.queue.empty()) {
+            id = w.queue.front();
+            w.queue.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskGraph::work(size_t self) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(idle_mtx_);
+            idle_cv_.wait(lk, [this] { return queued_ > 0 || remaining_ == 0; });
+            if (remaining_ == 0) return;
+            --queued_; // claim one queued task
+        }
+        // The claimed task is in some deque, though not necessarily where the
+        // first scan looked
+        TaskId id;
+        while (!pop(self, id)) std::this_thread::yield();
+
+        Task& task = *tasks_[id];
+        bool ok = true;
+        if (!cancelled_) {
+            try {
+                ok = task.fn();
+            } catch (const std::exception& e) {
+                std::cerr << "[engine/preload] task '" << task.name << "' threw: " << e.what() << std::endl;
+                ok = false;
+            }
+        }
+        if (!ok) ++failed_;
+        for (TaskId next : task.dependents) {
+            if (tasks_[next]->waiting.fetch_sub(1) == 1) push(self, next);
+        }
+        std::lock_guard<std::mutex> lk(idle_mtx_);
+        if (--remaining_ == 0) idle_cv_.notify_all();
+    }
+}
+
+size_t TaskGraph::run(size_t threads) {
+    if (tasks_.empty()) return 0;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, tasks_.size());
+    workers_.clear();
+    for (size_t i = 0; i < threads; ++i) workers_.push_back(std::make_unique<Worker>());
+    failed_ = 0;
+    remaining_ = tasks_.size();
+    queued_ = 0;
+
+    size_t next = 0;
+    for (TaskId id = 0; id < tasks_.size(); ++id) {
+        tasks_[id]->waiting = tasks_[id]->deps;
+        if (tasks_[id]->deps == 0) {
+            workers_[next]->queue.push_back(id);
+            ++queued_;
+            next = (next + 1) % threads;
+        }
+    }
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; ++i) pool.emplace_back(&TaskGraph::work, this, i);
+    work(0);
+    for (auto& t : pool) t.join();
+    return failed_;
+}
+
+const char* script_state_name(ScriptState state) {
+    switch (state) {
+    case ScriptState::Pending: return "pending";
+    case ScriptState::Compiling: return "compiling";
+    case ScriptState::Ready: return "ready";
+    case ScriptState::Failed: return "failed";
+    }
+    return "unknown";
+}
+
+void PreloadStatus::set(const std::string& name, ScriptState state) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    states_[name] = state;
+}
+
+bool PreloadStatus::get(const std::string& name, ScriptState& state) const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = states_.find(name);
+    if (it == states_.end()) return false;
+    state = it->second;
+    return true;
+}
+
+std::vector<PreloadStatus::Item> PreloadStatus::items() const {
+    std::vector<Item> out;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (const auto& kv : states_) out.push_back(Item{ kv.first, kv.second });
+    }
+    std::sort(out.begin(), out.end(), [](const Item& a, const Item& b) { return a.name < b.name; });
+    return out;
+}
+
+size_t PreloadStatus::count(ScriptState state) const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return std::count_if(states_.begin(), states_.end(), [state](const auto& kv) { return kv.second == state; });
+}
+
+PreloadStatus& preload_status() {
+    static PreloadStatus status;
+    return status;
+}
+
+} // namespace engine
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace engine {
+
+// A dependency graph of tasks run on a work-stealing pool. A task becomes
+// runnable once every task it depends on has finished. Each worker pops its
+// own deque from the back (newly unblocked work stays on the thread that
+// unblocked it) and steals from the front of the others when it runs dry.
+// Dependencies only order tasks: a failed task does not cancel its
+// dependents.
+class TaskGraph {
+public:
+    using TaskId = size_t;
+
+    TaskGraph() = default;
+
+    // Non-copyable
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    // Add a task; `deps` must be ids returned earlier. Returns false from
+    // `fn` to count it as failed.
+    TaskId add(std::string name, std::function<bool()> fn, const std::vector<TaskId>& deps = {});
+
+    // Run every task on `threads` workers (0 = one per core) and block until
+    // they are done. Returns the number of failed tasks.
+    size_t run(size_t threads = 0);
+
+    // Skip the tasks that have not started yet; run() then returns early
+    void cancel() { cancelled_ = true; }
+
+    size_t size() const { return tasks_.size(); }
+
+private:
+    struct Task {
+        std::string name;
+        std::function<bool()> fn;
+        std::vector<TaskId> dependents;
+        size_t deps = 0;
+        std::atomic<size_t> waiting{ 0 }; // unfinished dependencies during run()
+    };
+    struct Worker {
+        std::mutex mtx;
+        std::deque<TaskId> queue;
+    };
+
+    bool pop(size_t self, TaskId& id);
+    void push(size_t worker, TaskId id);
+    void work(size_t self);
+
+    std::vector<std::unique_ptr<Task>> tasks_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex idle_mtx_;
+    std::condition_variable idle_cv_;
+    size_t queued_ = 0;       // tasks sitting in any deque (guarded by idle_mtx_)
+    size_t remaining_ = 0;    // tasks not finished yet (guarded by idle_mtx_)
+    std::atomic<size_t> failed_{ 0 };
+    std::atomic<bool> cancelled_{ false };
+};
+
+enum class ScriptState { Pending, Compiling, Ready, Failed };
+
+const char* script_state_name(ScriptState state);
+
+// Per-script progress of the startup preload, for /api/status
+class PreloadStatus {
+public:
+    struct Item {
+        std::string name;
+        ScriptState state;
+    };
+
+    void set(const std::string& name, ScriptState state);
+    bool get(const std::string& name, ScriptState& state) const; // false if not being preloaded
+    std::vector<Item> items() const; // sorted by name
+    size_t count(ScriptState state) const;
+
+    void set_done(bool done) { done_ = done; }
+    bool done() const { return done_.load(); }
+
+private:
+    mutable std::mutex mtx_;
+    std::unordered_map<std::string, ScriptState> states_;
+    std::atomic<bool> done_{ false };
+};
+
+// Process-wide preload progress of ./scripts
+PreloadStatus& preload_status();
+
+} // namespace engine
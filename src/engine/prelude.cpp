@@ -0,0 +1,118 @@
+#include "prelude.h"
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace engine {
+
+namespace fs = std::filesystem;
+
+std::string prelude_key(const std::string& header_path, const CompilerConfig& cfg, const std::string& version) {
+    return script_cache_key(read_with_local_includes(header_path), cfg, version);
+}
+
+// Flags for building the PCH: the script flags minus linking ones
+static std::vector<std::string> pch_flags(const CompilerConfig& cfg) {
+    std::vector<std::string> flags;
+    for (const auto& f : cfg.flags) {
+        if (f != "-shared") flags.push_back(f);
+    }
+    return flags;
+}
+
+Prelude build_prelude(const std::string& header_path, const std::string& cache_dir, const CompilerConfig& cfg,
+                      bool* rebuilt) {
+    if (rebuilt) *rebuilt = false;
+    std::error_code ec;
+    if (!fs::is_regular_file(header_path, ec)) {
+        std::cerr << "[engine/prelude] header not found: " << header_path << std::endl;
+        return {};
+    }
+    std::string version = toolchain_version(cfg.compiler);
+    if (version.empty()) {
+        std::cerr << "[engine/prelude] compiler '" << cfg.compiler << "' not found" << std::endl;
+        return {};
+    }
+
+    Prelude p;
+    p.key = prelude_key(header_path, cfg, version);
+    p.clang = version.find("clang") != std::string::npos;
+    fs::path source = fs::absolute(header_path, ec);
+    fs::path dir = fs::absolute(cache_dir, ec) / p.key;
+    fs::path header = dir / source.filename();
+    // GCC only picks up "<header>.gch"; clang looks for "<header>.pch" first
+    fs::path pch = header;
+    pch += p.clang ? ".pch" : ".gch";
+    p.header = header.string();
+    p.pch = pch.string();
+    // The copy lives elsewhere, so its own "..." includes resolve via -I
+    std::string include_dir = "-I" + source.parent_path().string();
+    p.flags = { include_dir, "-include", p.header };
+
+    if (fs::exists(pch, ec) && fs::exists(header, ec)) return p;
+
+    fs::create_directories(cache_dir, ec);
+    fs::path tmp = dir;
+    tmp += ".tmp." + std::to_string(getpid());
+    fs::remove_all(tmp, ec);
+    fs::create_directories(tmp, ec);
+    fs::copy_file(source, tmp / source.filename(), fs::copy_options::overwrite_existing, ec);
+    if (ec) {
+        std::cerr << "[engine/prelude] cannot stage header in " << tmp << ": " << ec.message() << std::endl;
+        fs::remove_all(tmp, ec);
+        return {};
+    }
+
+    std::cout << "[engine/prelude] precompiling " << header_path << " -> " << p.pch << std::endl;
+    std::vector<std::string> args = { cfg.compiler };
+    for (auto& f : pch_flags(cfg)) args.push_back(f);
+    args.insert(args.end(), { include_dir, "-x", "c++-header", (tmp / source.filename()).string(), "-o",
+                              (tmp / pch.filename()).string() });
+    if (!run_compiler(args)) {
+        std::cerr << "[engine/prelude] precompiling failed" << std::endl;
+        fs::remove_all(tmp, ec);
+        return {};
+    }
+    // Publish atomically; a concurrent builder with the same key may have won
+    fs::rename(tmp, dir, ec);
+    if (ec) {
+        fs::remove_all(tmp, ec);
+        if (!fs::exists(pch, ec)) return {};
+    }
+    if (rebuilt) *rebuilt = true;
+
+    // Builds for other keys are stale: the header or toolchain changed
+    for (const auto& e : fs::directory_iterator(cache_dir, ec)) {
+        if (e.is_directory(ec) && e.path().filename() != p.key &&
+            e.path().filename().string().find(".tmp.") == std::string::npos) {
+            fs::remove_all(e.path(), ec);
+        }
+    }
+    return p;
+}
+
+std::string script_api_header_path() {
+    if (const char* env = getenv("NATIVE_NODE_SCRIPT_API"); env && *env) return env;
+#ifdef SCRIPT_API_HEADER
+    return SCRIPT_API_HEADER;
+#else
+    return "src/engine/script_api.h";
+#endif
+}
+
+static std::mutex g_prelude_mtx;
+static Prelude g_prelude;
+
+void set_runtime_prelude(const Prelude& prelude) {
+    std::lock_guard<std::mutex> lk(g_prelude_mtx);
+    g_prelude = prelude;
+}
+
+Prelude runtime_prelude() {
+    std::lock_guard<std::mutex> lk(g_prelude_mtx);
+    return g_prelude;
+}
+
+} // namespace engine
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "script_cache.h"
+
+namespace engine {
+
+// A precompiled build of the script API header, stored under
+// <cache_dir>/<key>/ next to a copy of the header so `-include` picks it up.
+struct Prelude {
+    std::string header; // copy of the API header inside the versioned directory
+    std::string pch;    // compiled header beside it (.gch for GCC, .pch for clang)
+    std::string key;
+    bool clang = false; // built by clang, so clang-repl can load it too
+    std::vector<std::string> flags; // added to every script compile
+
+    bool valid() const { return !header.empty(); }
+};
+
+// Hash of the header, the local ("...") headers it includes, the compiler,
+// its flags and toolchain version. Changes whenever the PCH must be rebuilt.
+std::string prelude_key(const std::string& header_path, const CompilerConfig& cfg, const std::string& version);
+
+// Reuse <cache_dir>/<key> if it exists, otherwise compile it (and remove
+// builds for older keys). Returns an invalid Prelude on failure.
+Prelude build_prelude(const std::string& header_path, const std::string& cache_dir, const CompilerConfig& cfg,
+                      bool* rebuilt = nullptr);
+
+// Location of script_api.h: $NATIVE_NODE_SCRIPT_API, else the build's source tree
+std::string script_api_header_path();
+
+// Process-wide prelude installed by engine::initialize (invalid until then)
+void set_runtime_prelude(const Prelude& prelude);
+Prelude runtime_prelude();
+
+} // namespace engine
@@ -0,0 +1,462 @@
+#include "repl_pool.h"
+#include "prelude.h"
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace engine {
+
+// Runs the fork() of every session. PR_SET_PDEATHSIG fires when the thread
+// that forked the child exits, not the process, so a session started from a
+// request thread would die with it; this thread lives as long as the process.
+class SessionLauncher {
+public:
+    SessionLauncher() { thread_ = std::thread(&SessionLauncher::run, this); }
+
+    ~SessionLauncher() {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    // Non-copyable
+    SessionLauncher(const SessionLauncher&) = delete;
+    SessionLauncher& operator=(const SessionLauncher&) = delete;
+
+    // Run `fn` on the launcher thread and wait for it
+    void call(const std::function<void()>& fn) {
+        std::packaged_task<void()> task(fn);
+        auto done = task.get_future();
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+        done.wait();
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::packaged_task<void()> task;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                cv_.wait(lk, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.erase(tasks_.begin());
+            }
+            task();
+        }
+    }
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector<std::packaged_task<void()>> tasks_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+static SessionLauncher& launcher() {
+    static SessionLauncher l;
+    return l;
+}
+
+ReplSession::ReplSession(const ReplOptions& opts) : opts_(opts) {}
+
+ReplSession::~ReplSession() {
+    stop();
+}
+
+bool ReplSession::start() {
+    stop();
+    int in[2], out[2];
+    if (pipe2(in, O_CLOEXEC) != 0) {
+        std::cerr << "[engine/repl] pipe failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (pipe2(out, O_CLOEXEC) != 0) {
+        std::cerr << "[engine/repl] pipe failed: " << strerror(errno) << std::endl;
+        close(in[0]);
+        close(in[1]);
+        return false;
+    }
+
+    std::vector<std::string> args = { opts_.command };
+    args.insert(args.end(), opts_.args.begin(), opts_.args.end());
+    std::vector<char*> argv;
+    for (auto& a : args) argv.push_back(a.data());
+    argv.push_back(nullptr);
+
+    pid_t parent = getpid();
+    pid_t pid = -1;
+    int fork_errno = 0;
+    launcher().call([&] {
+        pid = fork();
+        if (pid == 0) {
+            // Don't outlive the server (or miss its exit before the prctl)
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (getppid() != parent) _exit(127);
+            dup2(in[0], STDIN_FILENO);
+            dup2(out[1], STDOUT_FILENO);
+            dup2(out[1], STDERR_FILENO);
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+        fork_errno = errno;
+    });
+    if (pid < 0) {
+        std::cerr << "[engine/repl] fork failed: " << strerror(fork_errno) << std::endl;
+        for (int fd : { in[0], in[1], out[0], out[1] }) close(fd);
+        return false;
+    }
+    close(in[0]);
+    close(out[1]);
+    pid_ = pid;
+    in_fd_ = in[1];
+    out_fd_ = out[0];
+    evaluations_ = 0;
+
+    std::string preload;
+    for (const auto& line : opts_.preload) preload += line + "\n";
+    EvalResult r = round_trip(preload, opts_.startup_timeout_ms);
+    if (!r.ok) {
+        std::cerr << "[engine/repl] session failed to start (" << opts_.command << ")"
+                  << (r.output.empty() ? "" : ": " + r.output) << std::endl;
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void ReplSession::stop() {
+    if (in_fd_ >= 0) close(in_fd_);
+    if (out_fd_ >= 0) close(out_fd_);
+    in_fd_ = out_fd_ = -1;
+    if (pid_ > 0) {
+        kill(pid_, SIGKILL);
+        while (waitpid(pid_, nullptr, 0) < 0 && errno == EINTR) {}
+    }
+    pid_ = -1;
+}
+
+// Write all of `data`, turning a dead reader into EPIPE instead of SIGPIPE
+static bool write_all(int fd, const std::string& data) {
+    sigset_t pipe_set, old_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+    bool ok = true;
+    size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = write(fd, data.data() + off, data.size() - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        off += static_cast<size_t>(n);
+    }
+    if (!ok && errno == EPIPE) {
+        // Discard the SIGPIPE raised for this thread before unblocking
+        timespec zero{ 0, 0 };
+        sigtimedwait(&pipe_set, nullptr, &zero);
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+    return ok;
+}
+
+EvalResult ReplSession::round_trip(const std::string& code, int timeout_ms) {
+    EvalResult r;
+    if (pid_ <= 0) {
+        r.output = "session not running";
+        return r;
+    }
+    std::string marker = "__native_node_repl_";
+    marker += std::to_string(pid_);
+    marker += '_';
+    marker += std::to_string(++next_marker_);
+    marker += "__";
+
+    std::string input = code;
+    if (!input.empty() && input.back() != '\n') input += '\n';
+    input += opts_.sentinel(marker) + "\n";
+    if (!write_all(in_fd_, input)) {
+        r.output = "write to session failed: " + std::string(strerror(errno));
+        stop();
+        return r;
+    }
+
+    const std::string terminator = "\n" + marker + "\n";
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::string buf;
+    size_t found = std::string::npos;
+    char chunk[4096];
+    while (found == std::string::npos) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) {
+            r.timed_out = true;
+            break;
+        }
+        pollfd pfd{ out_fd_, POLLIN, 0 };
+        int pr = poll(&pfd, 1, static_cast<int>(left));
+        if (pr < 0 && errno == EINTR) continue;
+        if (pr == 0) {
+            r.timed_out = true;
+            break;
+        }
+        ssize_t n = read(out_fd_, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break; // session exited
+        buf.append(chunk, static_cast<size_t>(n));
+        found = buf.find(terminator);
+    }
+
+    if (found == std::string::npos) {
+        // Timed out or died mid-evaluation: the session's state is unknown
+        r.output = buf;
+        stop();
+        return r;
+    }
+    buf.resize(found);
+    if (!opts_.prompt.empty()) {
+        for (size_t p; (p = buf.find(opts_.prompt)) != std::string::npos;) buf.erase(p, opts_.prompt.size());
+    }
+    if (!buf.empty() && buf.back() == '\n') buf.pop_back();
+    r.output = std::move(buf);
+    r.ok = r.output.find("error:") == std::string::npos;
+    return r;
+}
+
+// Drop a // comment from `line`, tracking /* */ comments across lines in
+// `in_block`. Literals are skipped; a quote right after a digit or letter is
+// a digit separator or a literal prefix, not the start of a character literal.
+static std::string strip_line_comment(const std::string& line, bool& in_block) {
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        char next = i + 1 < line.size() ? line[i + 1] : '\0';
+        if (in_block) {
+            if (c == '*' && next == '/') {
+                in_block = false;
+                ++i;
+            }
+        } else if (quote) {
+            if (c == '\\') ++i;
+            else if (c == quote) quote = 0;
+        } else if (c == '"' || (c == '\'' && (i == 0 || !isalnum(static_cast<unsigned char>(line[i - 1]))))) {
+            quote = c;
+        } else if (c == '/' && next == '*') {
+            in_block = true;
+            ++i;
+        } else if (c == '/' && next == '/') {
+            return line.substr(0, i);
+        }
+    }
+    return line;
+}
+
+EvalResult ReplSession::evaluate(const std::string& code, int timeout_ms) {
+    // The REPL takes one line per input, a trailing '\' continuing it. Code
+    // lines are joined that way so a definition can span several, but a
+    // directive ends at its own line break and goes in separately, and //
+    // comments are dropped since they would run on over the joined lines.
+    std::string input;
+    std::string pending; // code lines joined so far
+    bool in_block = false;
+    bool in_directive = false; // the last directive line ended in '\'
+    size_t start = 0;
+    while (start <= code.size()) {
+        size_t nl = code.find('\n', start);
+        std::string line = code.substr(start, nl == std::string::npos ? std::string::npos : nl - start);
+        size_t first = line.find_first_not_of(" \t");
+        if (in_directive || (!in_block && first != std::string::npos && line[first] == '#')) {
+            if (!in_directive && !pending.empty()) {
+                input += pending + "\n";
+                pending.clear();
+            }
+            input += line + "\n";
+            in_directive = !line.empty() && line.back() == '\\';
+        } else {
+            if (!pending.empty()) pending += " \\\n";
+            pending += strip_line_comment(line, in_block);
+        }
+        if (nl == std::string::npos) break;
+        start = nl + 1;
+    }
+    input += pending;
+    ++evaluations_;
+    return round_trip(input, timeout_ms);
+}
+
+bool ReplSession::exited() {
+    if (pid_ <= 0) return true;
+    if (waitpid(pid_, nullptr, WNOHANG) == pid_) {
+        pid_ = -1; // already reaped
+        stop();
+        return true;
+    }
+    return false;
+}
+
+bool ReplSession::healthy(int timeout_ms) {
+    if (exited()) return false;
+    return round_trip("", timeout_ms).ok;
+}
+
+uint64_t ReplSession::rss_bytes() const {
+    if (pid_ <= 0) return 0;
+    std::ifstream statm("/proc/" + std::to_string(pid_) + "/statm");
+    uint64_t size = 0, resident = 0;
+    if (!(statm >> size >> resident)) return 0;
+    return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+ReplPool::ReplPool(size_t size, ReplOptions opts) : size_(size ? size : 1), opts_(std::move(opts)) {
+    for (size_t i = 0; i < size_; ++i) idle_.push_back(std::make_unique<ReplSession>(opts_));
+    if (opts_.health_check_interval_ms > 0) health_thread_ = std::thread(&ReplPool::health_loop, this);
+}
+
+ReplPool::~ReplPool() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    if (health_thread_.joinable()) health_thread_.join();
+}
+
+void ReplPool::health_loop() {
+    const auto interval = std::chrono::milliseconds(opts_.health_check_interval_ms);
+    std::unique_lock<std::mutex> lk(mtx_);
+    while (!stop_cv_.wait_for(lk, interval, [this] { return stopping_; })) {
+        lk.unlock();
+        check_health();
+        lk.lock();
+    }
+}
+
+std::unique_ptr<ReplSession> ReplPool::take() {
+    std::unique_lock<std::mutex> lk(mtx_);
+    cv_.wait(lk, [this] { return !idle_.empty(); });
+    // Prefer a warm session over one that still has to start
+    auto it = idle_.begin();
+    for (auto i = idle_.begin(); i != idle_.end(); ++i) {
+        if ((*i)->running()) {
+            it = i;
+            break;
+        }
+    }
+    auto s = std::move(*it);
+    idle_.erase(it);
+    return s;
+}
+
+void ReplPool::give_back(std::unique_ptr<ReplSession> session) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        idle_.push_back(std::move(session));
+    }
+    cv_.notify_one();
+}
+
+bool ReplPool::needs_recycle(const ReplSession& s) const {
+    if (!s.running()) return true;
+    if (s.evaluations() >= opts_.max_evaluations) return true;
+    return opts_.max_rss_bytes && s.rss_bytes() > opts_.max_rss_bytes;
+}
+
+size_t ReplPool::warm() {
+    std::vector<std::unique_ptr<ReplSession>> sessions;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        sessions.swap(idle_);
+    }
+    size_t up = 0;
+    for (auto& s : sessions) {
+        if (s->running() || s->start()) ++up;
+    }
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (auto& s : sessions) idle_.push_back(std::move(s));
+    }
+    cv_.notify_all();
+    return up;
+}
+
+EvalResult ReplPool::evaluate(const std::string& code, int timeout_ms) {
+    auto session = take();
+    // A session that died while idle would fail this evaluation; restart it first
+    if (session->exited() && !session->start()) {
+        give_back(std::move(session));
+        EvalResult r;
+        r.output = "no JIT session available";
+        return r;
+    }
+    EvalResult r = session->evaluate(code, timeout_ms);
+    if (needs_recycle(*session)) {
+        // Restart now so the next caller gets a warm session
+        ++recycled_;
+        session->start();
+    }
+    give_back(std::move(session));
+    return r;
+}
+
+size_t ReplPool::check_health() {
+    std::vector<std::unique_ptr<ReplSession>> sessions;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        sessions.swap(idle_);
+    }
+    size_t restarted = 0;
+    for (auto& s : sessions) {
+        if (!s->running() || s->healthy()) continue;
+        std::cerr << "[engine/repl] session failed health check; restarting" << std::endl;
+        ++recycled_;
+        ++restarted;
+        s->start();
+    }
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (auto& s : sessions) idle_.push_back(std::move(s));
+    }
+    cv_.notify_all();
+    return restarted;
+}
+
+ReplOptions default_repl_options() {
+    ReplOptions opts;
+    Prelude prelude = runtime_prelude();
+    if (!prelude.valid()) return opts;
+    if (prelude.clang) {
+        opts.args = { "-Xcc=-include-pch", "-Xcc=" + prelude.pch };
+    }
+    // With the PCH loaded this include is a no-op; without it the
+    // header is parsed once per session rather than per evaluation
+    opts.preload = { "#include \"" + prelude.header + "\"" };
+    return opts;
+}
+
+ReplPool& repl_pool() {
+    static ReplPool pool(2, default_repl_options());
+    return pool;
+}
+
+} // namespace engine
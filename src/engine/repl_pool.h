@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+namespace engine {
+
+struct ReplOptions {
+    std::string command = "clang-repl";
+    std::vector<std::string> args;
+    // Evaluated once when a session starts (runtime headers, using-declarations)
+    std::vector<std::string> preload = { "#include <cstdio>", "#include <cstdlib>", "#include <string>",
+                                         "#include <vector>" };
+    // Statement that prints `marker` on its own line and flushes stdout
+    std::function<std::string(const std::string& marker)> sentinel = [](const std::string& marker) {
+        return "std::printf(\"\\n" + marker + "\\n\"); std::fflush(stdout);";
+    };
+    std::string prompt = "clang-repl> "; // stripped from output
+    int startup_timeout_ms = 30000;       // cold start + preload
+    size_t max_evaluations = 1000;        // recycle after this many evaluations
+    uint64_t max_rss_bytes = 512ULL << 20; // recycle once resident memory exceeds this
+    int health_check_interval_ms = 30000; // idle sessions checked this often (0: never)
+};
+
+struct EvalResult {
+    bool ok = false;       // completed without a diagnostic or timeout
+    bool timed_out = false;
+    std::string output;    // stdout and stderr of the evaluation
+};
+
+// One long-lived interpreter process driven over pipes. Code lines are written
+// as one logical line (continued with '\'), preprocessor directives on lines of
+// their own, followed by a sentinel statement; output is read until the
+// sentinel's marker appears. Processes are forked from a process-wide launcher
+// thread, so a session outlives the thread that started it but not the server.
+class ReplSession {
+public:
+    explicit ReplSession(const ReplOptions& opts);
+    ~ReplSession();
+
+    // Non-copyable
+    ReplSession(const ReplSession&) = delete;
+    ReplSession& operator=(const ReplSession&) = delete;
+
+    // Spawn the process and run the preload lines
+    bool start();
+    void stop();
+
+    EvalResult evaluate(const std::string& code, int timeout_ms);
+
+    // Process alive and answering a bare sentinel
+    bool healthy(int timeout_ms = 1000);
+    // Not started, stopped, or the process has exited (reaped here)
+    bool exited();
+
+    bool running() const { return pid_ > 0; }
+    size_t evaluations() const { return evaluations_; }
+    uint64_t rss_bytes() const;
+
+private:
+    EvalResult round_trip(const std::string& code, int timeout_ms);
+
+    ReplOptions opts_;
+    pid_t pid_ = -1;
+    int in_fd_ = -1;  // our end of the session's stdin
+    int out_fd_ = -1; // our end of the session's stdout/stderr
+    size_t evaluations_ = 0;
+    uint64_t next_marker_ = 0;
+};
+
+// Fixed-size pool of warm sessions. A session is recycled (restarted) after
+// max_evaluations, when its RSS exceeds max_rss_bytes, when an evaluation
+// times out, or when it fails a health check. Idle sessions are checked every
+// health_check_interval_ms on a background thread; a session whose process
+// has died is also restarted when it is next lent out.
+class ReplPool {
+public:
+    ReplPool(size_t size, ReplOptions opts = {});
+    ~ReplPool();
+
+    // Non-copyable
+    ReplPool(const ReplPool&) = delete;
+    ReplPool& operator=(const ReplPool&) = delete;
+
+    // Start every session up front; returns the number that came up
+    size_t warm();
+
+    // Evaluate on an idle session (waiting for one if all are busy)
+    EvalResult evaluate(const std::string& code, int timeout_ms = 10000);
+
+    // Health-check idle sessions, restarting any that fail; returns restarts
+    size_t check_health();
+
+    size_t size() const { return size_; }
+    uint64_t recycled() const { return recycled_; }
+
+private:
+    std::unique_ptr<ReplSession> take();
+    void give_back(std::unique_ptr<ReplSession> session);
+    bool needs_recycle(const ReplSession& s) const;
+    void health_loop();
+
+    size_t size_;
+    ReplOptions opts_;
+    std::vector<std::unique_ptr<ReplSession>> idle_; // sessions not lent out
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::atomic<uint64_t> recycled_{ 0 };
+    bool stopping_ = false; // guarded by mtx_
+    std::condition_variable stop_cv_; // wakes the health thread to exit
+    std::thread health_thread_;
+};
+
+// Defaults plus the runtime prelude: sessions #include the script API header
+// and, when the PCH was built by clang, load it instead of parsing
+ReplOptions default_repl_options();
+
+// Process-wide pool of two clang-repl sessions (default_repl_options() at first use)
+ReplPool& repl_pool();
+
+} // namespace engine
@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ * Stable C ABI between the engine and compiled scripts.
+ *
+ * A script exports handlers named after the HTTP method:
+ *
+ *     extern "C" int doGet(const nn_request* req, nn_response* res);
+ *     extern "C" int doPost(const nn_request* req, nn_response* res);
+ *
+ * Every nn_str in the request points straight into the connection buffer
+ * and is valid only for the duration of the call; strings are not NUL
+ * terminated. Response bytes go through the writer callbacks into a buffer
+ * shared with the server, which sends them without copying. A handler
+ * returns 0 on success; anything else becomes a 500 response.
+ *
+ * Structs only ever grow at the end; check abi_version before using fields
+ * added later.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NN_SCRIPT_ABI_VERSION 1
+
+typedef struct nn_str {
+    const char* data;
+    size_t size;
+} nn_str;
+
+typedef struct nn_header {
+    nn_str name;
+    nn_str value;
+} nn_header;
+
+typedef struct nn_request {
+    uint32_t abi_version;
+    nn_str method;
+    nn_str path;  /* without the query string */
+    nn_str query; /* after '?', empty if none */
+    const nn_header* headers;
+    size_t header_count;
+    nn_str body;
+} nn_request;
+
+typedef struct nn_response {
+    void* ctx; /* owned by the engine; pass back unchanged */
+    void (*set_status)(void* ctx, int status);
+    /* Returns 0, or -1 when the header area is full */
+    int (*add_header)(void* ctx, nn_str name, nn_str value);
+    /* Appends to the body. Returns 0, or -1 when the body area is full */
+    int (*write)(void* ctx, const void* data, size_t size);
+} nn_response;
+
+typedef int (*nn_handler)(const nn_request* req, nn_response* res);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+
+// Runtime universe for scripts: the entry point ABI and the whitelisted
+// standard library surface that every script compile and REPL session sees
+// without including anything. The engine precompiles this header at startup
+// (see prelude.h); keep it to headers scripts are allowed to use, since each
+// addition costs PCH size.
+
+#include "script_abi.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
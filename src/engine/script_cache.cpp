@@ -0,0 +1,312 @@
+#include "script_cache.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace engine {
+
+namespace fs = std::filesystem;
+
+CompilerConfig default_compiler_config() {
+    CompilerConfig cfg;
+    if (const char* cxx = getenv("CXX"); cxx && *cxx) cfg.compiler = cxx;
+    return cfg;
+}
+
+std::string toolchain_version(const std::string& compiler) {
+    std::string cmd = compiler + " --version 2>/dev/null";
+    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
+    if (!pipe) return {};
+    std::array<char, 256> buffer;
+    std::string line;
+    if (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) line = buffer.data();
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+    return line;
+}
+
+uint64_t fnv1a64(const std::string& data, uint64_t seed) {
+    uint64_t h = seed;
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+std::string script_cache_key(const std::string& source, const CompilerConfig& cfg, const std::string& version) {
+    uint64_t h = fnv1a64(source);
+    h = fnv1a64(std::string(1, '\0') + cfg.compiler, h);
+    for (const auto& f : cfg.flags) h = fnv1a64(std::string(1, '\0') + f, h);
+    h = fnv1a64(std::string(1, '\0') + version, h);
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+    return buf;
+}
+
+static void collect_sources(const fs::path& path, std::set<fs::path>& seen, std::string& out,
+                            std::vector<std::string>* files) {
+    std::error_code ec;
+    fs::path canonical = fs::weakly_canonical(path, ec);
+    if (!seen.insert(canonical).second) return;
+    std::ifstream ifs(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << ifs.rdbuf();
+    std::string text = ss.str();
+    if (files) files->push_back(path.string());
+    out += path.filename().string();
+    out += '\0';
+    out += text;
+    out += '\0';
+    std::istringstream lines(text);
+    for (std::string line; std::getline(lines, line);) {
+        size_t p = line.find_first_not_of(" \t");
+        if (p == std::string::npos || line[p] != '#') continue;
+        size_t inc = line.find("include", p);
+        size_t open = line.find('"', p);
+        if (inc == std::string::npos || open == std::string::npos || open < inc) continue;
+        size_t close = line.find('"', open + 1);
+        if (close == std::string::npos) continue;
+        fs::path dep = path.parent_path() / line.substr(open + 1, close - open - 1);
+        if (fs::exists(dep, ec)) collect_sources(dep, seen, out, files);
+    }
+}
+
+std::string read_with_local_includes(const std::string& path, std::vector<std::string>* files) {
+    std::set<fs::path> seen;
+    std::string out;
+    collect_sources(path, seen, out, files);
+    return out;
+}
+
+bool run_compiler(const std::vector<std::string>& args) {
+    std::vector<char*> argv;
+    for (const auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    int rc = posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ);
+    if (rc != 0) {
+        std::cerr << "[engine/cache] failed to run " << args[0] << ": " << strerror(rc) << std::endl;
+        return false;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+CompiledScript::CompiledScript(std::string so_path, std::string key)
+    : so_path_(std::move(so_path)), key_(std::move(key)) {}
+
+ScriptCache::ScriptCache(std::string cache_dir, uint64_t max_bytes, CompilerConfig cfg)
+    : dir_(std::move(cache_dir)), max_bytes_(max_bytes), base_cfg_(cfg), cfg_(std::move(cfg)) {
+    std::error_code ec;
+    fs::create_directories(dir_, ec);
+    if (ec) std::cerr << "[engine/cache] cannot create cache dir " << dir_ << ": " << ec.message() << std::endl;
+    version_ = toolchain_version(cfg_.compiler);
+    if (version_.empty()) std::cerr << "[engine/cache] compiler '" << cfg_.compiler << "' not found" << std::endl;
+}
+
+bool ScriptCache::compile(const std::string& source_path, const std::string& so_path, const CompilerConfig& cfg) {
+    // Build into a private temp file and rename, so concurrent builders and
+    // crashed builds never leave a truncated object under the final name
+    std::string tmp = so_path + ".tmp." + std::to_string(getpid()) + "." +
+                      std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    std::vector<std::string> args = { cfg.compiler };
+    args.insert(args.end(), cfg.flags.begin(), cfg.flags.end());
+    args.insert(args.end(), { "-o", tmp, source_path });
+    if (!run_compiler(args)) {
+        std::cerr << "[engine/cache] compilation failed: " << source_path << std::endl;
+        unlink(tmp.c_str());
+        return false;
+    }
+    if (rename(tmp.c_str(), so_path.c_str()) != 0) {
+        std::cerr << "[engine/cache] rename failed: " << strerror(errno) << std::endl;
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+void ScriptCache::set_extra_flags(const std::vector<std::string>& flags) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    cfg_ = base_cfg_;
+    cfg_.flags.insert(cfg_.flags.end(), flags.begin(), flags.end());
+    sources_.clear(); // cached keys were computed with the old flags
+}
+
+CompilerConfig ScriptCache::config() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return base_cfg_;
+}
+
+std::shared_ptr<CompiledScript> ScriptCache::load(const std::string& source_path) {
+    return load(source_path, {});
+}
+
+bool ScriptCache::stamp(const std::string& path, FileStamp& out) {
+    std::error_code ec;
+    auto mtime = fs::last_write_time(path, ec);
+    if (ec) return false;
+    uint64_t size = fs::file_size(path, ec);
+    if (ec) return false;
+    out = FileStamp{ path, std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count(), size };
+    return true;
+}
+
+std::shared_ptr<CompiledScript> ScriptCache::load(const std::string& source_path, const std::vector<std::string>& flags) {
+    for (int attempt = 1;; ++attempt) {
+        bool stale = false;
+        auto script = load_once(source_path, flags, stale);
+        if (!stale) return script;
+        if (attempt == MAX_LOAD_ATTEMPTS) {
+            std::cerr << "[engine/cache] " << source_path << " kept changing while compiling; giving up" << std::endl;
+            return nullptr;
+        }
+    }
+}
+
+std::shared_ptr<CompiledScript> ScriptCache::load_once(const std::string& source_path, const std::vector<std::string>& flags,
+                                                       bool& stale) {
+    FileStamp source;
+    if (!stamp(source_path, source)) {
+        std::cerr << "[engine/cache] cannot stat " << source_path << std::endl;
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lk(mtx_);
+    CompilerConfig cfg = cfg_;
+    cfg.flags.insert(cfg.flags.end(), flags.begin(), flags.end());
+
+    // Re-hash only when the mtime or size of the source or one of the local
+    // headers it includes changed
+    std::string state_key = source_path;
+    for (const auto& f : flags) state_key += '\0' + f;
+    SourceState& st = sources_[state_key];
+    bool changed = st.key.empty();
+    for (size_t i = 0; !changed && i < st.files.size(); ++i) {
+        const FileStamp& was = st.files[i];
+        FileStamp now;
+        changed = !stamp(was.path, now) || now.mtime_ns != was.mtime_ns || now.size != was.size;
+    }
+    if (changed) {
+        std::vector<std::string> paths;
+        std::string sources = read_with_local_includes(source_path, &paths);
+        st.files.clear();
+        for (const auto& path : paths) {
+            FileStamp file;
+            if (stamp(path, file)) st.files.push_back(std::move(file));
+        }
+        st.key = script_cache_key(sources, cfg, version_);
+    }
+
+    std::string key = st.key; // `st` may move once the lock is dropped
+    // Another thread building the same object: wait for it instead of racing
+    for (;;) {
+        if (auto live = live_[key].lock()) {
+            ++hits_;
+            return live;
+        }
+        if (!building_.count(key)) break;
+        built_cv_.wait(lk);
+    }
+
+    std::string so_path = dir_ + "/" + key + ".so";
+    bool compiled = false;
+    std::error_code ec;
+    if (fs::exists(so_path, ec)) {
+        ++hits_;
+        // Mark as recently used for LRU eviction
+        fs::last_write_time(so_path, fs::file_time_type::clock::now(), ec);
+    } else {
+        // Compile without the lock so different scripts build in parallel
+        building_.insert(key);
+        lk.unlock();
+        std::cout << "[engine/cache] compiling " << source_path << " -> " << so_path << std::endl;
+        bool ok = compile(source_path, so_path, cfg);
+        // An edit the compiler saw but the key doesn't: drop the object before
+        // building_ is cleared and anyone else can pick it up under this key
+        if (ok && script_cache_key(read_with_local_includes(source_path), cfg, version_) != key) {
+            std::cout << "[engine/cache] " << source_path << " changed while compiling; discarding " << so_path << std::endl;
+            unlink(so_path.c_str());
+            ok = false;
+            stale = true;
+        }
+        lk.lock();
+        building_.erase(key);
+        built_cv_.notify_all();
+        if (stale) sources_.erase(state_key); // re-hash on the next attempt
+        if (!ok) return nullptr;
+        ++compiles_;
+        compiled = true;
+    }
+
+    auto script = std::make_shared<CompiledScript>(so_path, key);
+    live_[key] = script;
+    if (compiled) {
+        lk.unlock();
+        evict();
+    }
+    return script;
+}
+
+uint64_t ScriptCache::disk_bytes() const {
+    uint64_t total = 0;
+    std::error_code ec;
+    for (const auto& e : fs::directory_iterator(dir_, ec)) {
+        if (e.is_regular_file(ec) && e.path().extension() == ".so") total += e.file_size(ec);
+    }
+    return total;
+}
+
+size_t ScriptCache::evict() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    struct Object {
+        fs::path path;
+        fs::file_time_type used;
+        uint64_t size;
+    };
+    std::vector<Object> objects;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (const auto& e : fs::directory_iterator(dir_, ec)) {
+        if (!e.is_regular_file(ec) || e.path().extension() != ".so") continue;
+        objects.push_back({ e.path(), e.last_write_time(ec), e.file_size(ec) });
+        total += objects.back().size;
+    }
+    std::sort(objects.begin(), objects.end(), [](const Object& a, const Object& b) { return a.used < b.used; });
+
+    size_t removed = 0;
+    for (const auto& o : objects) {
+        if (total <= max_bytes_) break;
+        auto it = live_.find(o.path.stem().string());
+        if (it != live_.end() && !it->second.expired()) continue;
+        if (building_.count(o.path.stem().string())) continue; // just renamed in, not loaded yet
+        if (fs::remove(o.path, ec)) {
+            total -= o.size;
+            ++removed;
+            if (it != live_.end()) live_.erase(it);
+        }
+    }
+    if (removed) std::cout << "[engine/cache] evicted " << removed << " object(s)" << std::endl;
+    return removed;
+}
+
+ScriptCache& script_cache() {
+    static ScriptCache cache("./cache/scripts", 256ULL << 20);
+    return cache;
+}
+
+} // namespace engine
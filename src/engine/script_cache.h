@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace engine {
+
+// Toolchain used to build scripts into shared objects
+struct CompilerConfig {
+    std::string compiler = "c++"; // overridden by $CXX in default_compiler_config()
+    std::vector<std::string> flags = { "-std=c++20", "-O2", "-fPIC", "-shared" };
+};
+
+CompilerConfig default_compiler_config();
+
+// First line of `<compiler> --version` (empty if the compiler cannot be run)
+std::string toolchain_version(const std::string& compiler);
+
+// 64-bit FNV-1a, chainable through `seed`
+uint64_t fnv1a64(const std::string& data, uint64_t seed = 0xcbf29ce484222325ULL);
+
+// Run a compiler command line (args[0] looked up on PATH) and wait for it.
+// True when it exits with status 0.
+bool run_compiler(const std::vector<std::string>& args);
+
+// Cache key: hex hash of the source text, compiler, flags and toolchain version
+std::string script_cache_key(const std::string& source, const CompilerConfig& cfg, const std::string& version);
+
+// Text of `path` followed by every local ("...") header it includes, directly
+// or through other local headers, each once. `files` (optional) receives the
+// path of every file read.
+std::string read_with_local_includes(const std::string& path, std::vector<std::string>* files = nullptr);
+
+// A compiled script object on disk. The server never loads it: script
+// workers dlopen() it inside their sandbox, so its static constructors never
+// run with the server's privileges. While referenced, the object is kept by
+// eviction.
+class CompiledScript {
+public:
+    CompiledScript(std::string so_path, std::string key);
+
+    // Non-copyable
+    CompiledScript(const CompiledScript&) = delete;
+    CompiledScript& operator=(const CompiledScript&) = delete;
+
+    const std::string& path() const { return so_path_; }
+    const std::string& key() const { return key_; }
+
+private:
+    std::string so_path_;
+    std::string key_;
+};
+
+// On-disk cache of compiled scripts: <cache_dir>/<key>.so. A script is only
+// compiled when no object with its key exists, so unchanged scripts are never
+// rebuilt, across invocations or restarts. Objects are touched on use and the
+// least recently used ones are removed once the cache exceeds max_bytes
+// (objects still referenced are kept). load() is thread-safe: different
+// scripts compile in parallel, concurrent loads of one share a single build.
+// The compiler reads the files itself, so after a build the source and its
+// headers are hashed again; if they changed meanwhile, the object is deleted
+// rather than kept under the old text's key, and the load starts over.
+class ScriptCache {
+public:
+    ScriptCache(std::string cache_dir, uint64_t max_bytes, CompilerConfig cfg = default_compiler_config());
+
+    // Non-copyable
+    ScriptCache(const ScriptCache&) = delete;
+    ScriptCache& operator=(const ScriptCache&) = delete;
+
+    // Compile a script if needed. Returns nullptr if it fails to compile.
+    std::shared_ptr<CompiledScript> load(const std::string& source_path);
+    // Same, with `flags` appended to the configured ones (e.g. an optimization tier)
+    std::shared_ptr<CompiledScript> load(const std::string& source_path, const std::vector<std::string>& flags);
+
+    // Build every script with these extra flags from now on (the runtime
+    // prelude). They are part of the cache key, so objects built without them
+    // are not reused.
+    void set_extra_flags(const std::vector<std::string>& flags);
+    CompilerConfig config() const; // without the extra flags
+
+    // Remove least recently used objects until the cache fits in max_bytes.
+    // Returns the number of files removed.
+    size_t evict();
+
+    uint64_t disk_bytes() const;
+    uint64_t hits() const { return hits_.load(); }
+    uint64_t compiles() const { return compiles_.load(); }
+    const std::string& dir() const { return dir_; }
+
+private:
+    struct FileStamp {
+        std::string path;
+        int64_t mtime_ns = 0;
+        uint64_t size = 0;
+    };
+    struct SourceState {
+        std::vector<FileStamp> files; // the source and its local headers
+        std::string key;
+    };
+
+    static bool stamp(const std::string& path, FileStamp& out);
+
+    static constexpr int MAX_LOAD_ATTEMPTS = 3; // builds discarded because the source kept changing
+    // One attempt at load(); sets `stale` if the source changed while compiling
+    std::shared_ptr<CompiledScript> load_once(const std::string& source_path, const std::vector<std::string>& flags, bool& stale);
+
+    bool compile(const std::string& source_path, const std::string& so_path, const CompilerConfig& cfg);
+
+    std::string dir_;
+    uint64_t max_bytes_;
+    CompilerConfig base_cfg_;
+    CompilerConfig cfg_; // base_cfg_ plus extra flags
+    std::string version_;
+    mutable std::mutex mtx_;
+    std::unordered_map<std::string, SourceState> sources_;                    // source path + flags -> last key
+    std::unordered_map<std::string, std::weak_ptr<CompiledScript>> live_;     // key -> referenced object
+    std::unordered_set<std::string> building_;                                // keys being compiled
+    std::condition_variable built_cv_;
+    std::atomic<uint64_t> hits_{ 0 };
+    std::atomic<uint64_t> compiles_{ 0 };
+};
+
+// Process-wide cache (./cache/scripts, 256 MiB)
+ScriptCache& script_cache();
+
+} // namespace engine
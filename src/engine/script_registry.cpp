@@ -0,0 +1,289 @@
+#include "script_registry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <vector>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+namespace engine {
+
+namespace fs = std::filesystem;
+
+ScriptRegistry::ScriptRegistry(std::string dir, ScriptCache& cache) : dir_(std::move(dir)), cache_(cache) {}
+
+ScriptRegistry::~ScriptRegistry() {
+    stop_watching();
+    stop_optimizer();
+}
+
+std::string ScriptRegistry::name_for(const std::string& source_path) const {
+    fs::path p(source_path);
+    auto ext = p.extension();
+    if (ext != ".cpp" && ext != ".cc" && ext != ".cxx") return {};
+    std::error_code ec;
+    fs::path rel = fs::relative(p, dir_, ec);
+    if (ec || rel.empty() || *rel.begin() == "..") return {};
+    return rel.replace_extension().generic_string();
+}
+
+std::shared_ptr<CompiledScript> ScriptRegistry::get(const std::string& name) const {
+    auto snap = snapshot_.load(std::memory_order_acquire);
+    auto it = snap->find(name);
+    return it == snap->end() ? nullptr : it->second.object;
+}
+
+std::shared_ptr<CompiledScript> ScriptRegistry::call(const std::string& name) {
+    auto snap = snapshot_.load(std::memory_order_acquire);
+    auto it = snap->find(name);
+    if (it == snap->end()) return nullptr;
+    const Entry& e = it->second;
+    uint64_t n = e.calls->fetch_add(1, std::memory_order_relaxed) + 1;
+    // Exactly one caller crosses the threshold per source version
+    if (tiering_ && n == hot_threshold_ && e.tier == ScriptTier::Baseline) {
+        {
+            std::lock_guard<std::mutex> lk(jobs_mtx_);
+            jobs_.push_back(OptimizeJob{ name, e.source, e.calls });
+        }
+        jobs_cv_.notify_one();
+    }
+    return e.object;
+}
+
+ScriptTier ScriptRegistry::tier(const std::string& name) const {
+    auto snap = snapshot_.load(std::memory_order_acquire);
+    auto it = snap->find(name);
+    return it == snap->end() ? ScriptTier::Baseline : it->second.tier;
+}
+
+std::vector<ScriptRegistry::Stats> ScriptRegistry::stats() const {
+    auto snap = snapshot_.load(std::memory_order_acquire);
+    std::vector<Stats> out;
+    for (const auto& kv : *snap) out.push_back(Stats{ kv.first, kv.second.tier, kv.second.calls->load() });
+    std::sort(out.begin(), out.end(), [](const Stats& a, const Stats& b) { return a.name < b.name; });
+    return out;
+}
+
+void ScriptRegistry::enable_tiering(const TierConfig& cfg, std::vector<std::string> baseline_extra,
+                                    std::vector<std::string> optimized_extra) {
+    stop_optimizer();
+    if (!cfg.enabled) {
+        tiering_ = false;
+        return;
+    }
+    tier_flags_[0] = cfg.baseline_flags;
+    tier_flags_[0].insert(tier_flags_[0].end(), baseline_extra.begin(), baseline_extra.end());
+    tier_flags_[1] = cfg.optimized_flags;
+    tier_flags_[1].insert(tier_flags_[1].end(), optimized_extra.begin(), optimized_extra.end());
+    hot_threshold_ = std::max<uint64_t>(cfg.hot_threshold, 1);
+    tiering_ = true;
+    stopping_ = false;
+    for (size_t i = 0; i < std::max<size_t>(cfg.optimizer_threads, 1); ++i) {
+        optimizers_.emplace_back(&ScriptRegistry::optimizer_loop, this);
+    }
+}
+
+void ScriptRegistry::stop_optimizer() {
+    {
+        std::lock_guard<std::mutex> lk(jobs_mtx_);
+        stopping_ = true;
+        jobs_.clear();
+    }
+    jobs_cv_.notify_all();
+    for (auto& t : optimizers_) t.join();
+    optimizers_.clear();
+}
+
+void ScriptRegistry::optimizer_loop() {
+    for (;;) {
+        OptimizeJob job;
+        {
+            std::unique_lock<std::mutex> lk(jobs_mtx_);
+            jobs_cv_.wait(lk, [this] { return stopping_ || !jobs_.empty(); });
+            if (stopping_) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto optimized = cache_.load(job.source, tier_flags_[1]);
+        if (!optimized) {
+            std::cerr << "[engine/registry] optimized build of '" << job.name << "' failed; staying at baseline" << std::endl;
+            continue;
+        }
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto snap = snapshot_.load(std::memory_order_acquire);
+        auto it = snap->find(job.name);
+        // Drop the result if the script was edited or removed meanwhile
+        if (it == snap->end() || it->second.calls != job.calls) continue;
+        auto next = std::make_shared<Map>(*snap);
+        Entry& e = (*next)[job.name];
+        e.object = std::move(optimized);
+        e.tier = ScriptTier::Optimized;
+        snapshot_.store(std::move(next), std::memory_order_release);
+        ++generation_;
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "[engine/registry] '" << job.name << "' is hot; optimized build live after " << ms << " ms" << std::endl;
+    }
+}
+
+size_t ScriptRegistry::load_all(size_t* failed) {
+    size_t loaded = 0, errors = 0;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(dir_, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (!it->is_regular_file() || name_for(it->path().string()).empty()) continue;
+        if (reload(it->path().string())) ++loaded;
+        else ++errors;
+    }
+    if (failed) *failed = errors;
+    return loaded;
+}
+
+bool ScriptRegistry::reload(const std::string& source_path) {
+    std::string name = name_for(source_path);
+    if (name.empty()) return false;
+    uint64_t stamp = ++next_stamp_;
+    // Compile without holding the lock; lookups never wait on it anyway
+    auto script = tiering_ ? cache_.load(source_path, tier_flags_[0]) : cache_.load(source_path);
+    if (!script) {
+        std::cerr << "[engine/registry] keeping previous version of '" << name << "'; " << source_path
+                  << " failed to compile" << std::endl;
+        return false;
+    }
+    std::lock_guard<std::mutex> lk(mtx_);
+    // A reload that read the source later already published or removed it
+    uint64_t& last = stamps_[name];
+    if (last > stamp) return true;
+    last = stamp;
+    auto snap = snapshot_.load(std::memory_order_acquire);
+    auto it = snap->find(name);
+    // Unchanged source: keep the live version, which may already be optimized
+    if (it != snap->end() && it->second.baseline_key == script->key()) return true;
+    auto next = std::make_shared<Map>(*snap);
+    std::string key = script->key();
+    (*next)[name] = Entry{ std::move(script), source_path, std::move(key), ScriptTier::Baseline,
+                           std::make_shared<std::atomic<uint64_t>>(0) };
+    snapshot_.store(std::move(next), std::memory_order_release);
+    ++generation_;
+    return true;
+}
+
+void ScriptRegistry::remove(const std::string& source_path) {
+    std::string name = name_for(source_path);
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (name.empty()) return;
+    // Reloads already compiling the deleted source must not bring it back
+    stamps_[name] = ++next_stamp_;
+    auto snap = snapshot_.load(std::memory_order_acquire);
+    if (!snap->count(name)) return;
+    auto next = std::make_shared<Map>(*snap);
+    next->erase(name);
+    snapshot_.store(std::move(next), std::memory_order_release);
+    ++generation_;
+    std::cout << "[engine/registry] removed '" << name << "'" << std::endl;
+}
+
+void ScriptRegistry::watch_tree(const std::string& dir) {
+    std::error_code ec;
+    std::vector<std::string> dirs = { dir };
+    for (auto it = fs::recursive_directory_iterator(dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_directory()) dirs.push_back(it->path().string());
+    }
+    for (const auto& d : dirs) {
+        // Directories rather than files: editors replace files by rename
+        int wd = inotify_add_watch(inotify_fd_, d.c_str(),
+                                   IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_ONLYDIR);
+        if (wd < 0) {
+            std::cerr << "[engine/registry] inotify_add_watch failed for " << d << ": " << strerror(errno) << std::endl;
+            continue;
+        }
+        watched_dirs_[wd] = d;
+    }
+}
+
+bool ScriptRegistry::start_watching() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (inotify_fd_ >= 0) return true;
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd_ < 0 || stop_fd_ < 0) {
+        std::cerr << "[engine/registry] failed to set up inotify: " << strerror(errno) << std::endl;
+        if (inotify_fd_ >= 0) close(inotify_fd_);
+        if (stop_fd_ >= 0) close(stop_fd_);
+        inotify_fd_ = stop_fd_ = -1;
+        return false;
+    }
+    watch_tree(dir_);
+    watcher_ = std::thread(&ScriptRegistry::watch_loop, this);
+    return true;
+}
+
+void ScriptRegistry::stop_watching() {
+    if (!watcher_.joinable()) return;
+    uint64_t one = 1;
+    if (write(stop_fd_, &one, sizeof(one)) < 0) {
+        std::cerr << "[engine/registry] failed to signal watcher: " << strerror(errno) << std::endl;
+    }
+    watcher_.join();
+    std::lock_guard<std::mutex> lk(mtx_);
+    close(inotify_fd_);
+    close(stop_fd_);
+    inotify_fd_ = stop_fd_ = -1;
+    watched_dirs_.clear();
+}
+
+void ScriptRegistry::watch_loop() {
+    alignas(struct inotify_event) char buf[4096];
+    for (;;) {
+        struct pollfd pfds[2] = { { inotify_fd_, POLLIN, 0 }, { stop_fd_, POLLIN, 0 } };
+        if (poll(pfds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (pfds[1].revents & POLLIN) return;
+
+        ssize_t n = read(inotify_fd_, buf, sizeof(buf));
+        if (n <= 0) continue;
+        // One batch may hold several events for the same file; compile each once
+        std::set<std::string> changed, removed;
+        for (char* p = buf; p < buf + n;) {
+            auto* ev = reinterpret_cast<struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->len == 0) continue;
+            std::lock_guard<std::mutex> lk(mtx_);
+            auto it = watched_dirs_.find(ev->wd);
+            if (it == watched_dirs_.end()) continue;
+            std::string path = it->second + "/" + ev->name;
+            if (ev->mask & IN_ISDIR) {
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO)) watch_tree(path);
+            } else if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                changed.insert(path);
+                removed.erase(path);
+            } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                removed.insert(path);
+                changed.erase(path);
+            }
+        }
+        for (const auto& path : removed) remove(path);
+        for (const auto& path : changed) {
+            if (name_for(path).empty()) continue;
+            auto start = std::chrono::steady_clock::now();
+            if (reload(path)) {
+                auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+                std::cout << "[engine/registry] reloaded " << path << " in " << ms << " ms" << std::endl;
+            }
+        }
+    }
+}
+
+ScriptRegistry& script_registry() {
+    static ScriptRegistry registry("./scripts", script_cache());
+    return registry;
+}
+
+} // namespace engine
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "script_cache.h"
+#include "tiering.h"
+
+namespace engine {
+
+// Live set of compiled scripts under a directory, keyed by their path relative
+// to it without the extension ("hello", "webapps/shop"). Lookups are a single
+// atomic snapshot load and never lock. With watching enabled, an edited
+// script is recompiled in the background and the new version swapped in;
+// callers holding the old one finish on it, and a script that fails to
+// compile keeps serving its previous version. Reloads of one script may
+// overlap (the watcher and a rescan); each is stamped before it reads the
+// source, and one that finishes after a later-stamped reload or removal of
+// the same script is dropped rather than published over it.
+//
+// With tiering enabled, scripts are first published at the baseline tier.
+// Invocations are counted through call(); at the hot threshold the script is
+// recompiled with the optimized flags on a background thread and the result
+// is swapped in the same way, unless the source changed in the meantime.
+class ScriptRegistry {
+public:
+    struct Stats {
+        std::string name;
+        ScriptTier tier;
+        uint64_t calls;
+    };
+
+    ScriptRegistry(std::string dir, ScriptCache& cache);
+    ~ScriptRegistry();
+
+    // Non-copyable
+    ScriptRegistry(const ScriptRegistry&) = delete;
+    ScriptRegistry& operator=(const ScriptRegistry&) = delete;
+
+    // Current version of a script (nullptr if unknown)
+    std::shared_ptr<CompiledScript> get(const std::string& name) const;
+    // Same, counting one invocation towards the hot threshold
+    std::shared_ptr<CompiledScript> call(const std::string& name);
+
+    // Compile in tiers: each tier appends its TierConfig flags plus the given
+    // extra flags (e.g. a prelude built with that tier's flags). Call before
+    // load_all() and start_watching(); starts the optimizer threads.
+    void enable_tiering(const TierConfig& cfg, std::vector<std::string> baseline_extra = {},
+                        std::vector<std::string> optimized_extra = {});
+
+    ScriptTier tier(const std::string& name) const;
+    std::vector<Stats> stats() const;
+
+    // Compile every script under the directory and publish them.
+    // Returns the number published; `failed` counts the rest.
+    size_t load_all(size_t* failed = nullptr);
+
+    // Compile one source file and publish it. False (previous version kept) on failure.
+    bool reload(const std::string& source_path);
+    // Unpublish a deleted script
+    void remove(const std::string& source_path);
+
+    // Start/stop the inotify watcher thread
+    bool start_watching();
+    void stop_watching();
+
+    size_t size() const { return snapshot_.load(std::memory_order_acquire)->size(); }
+    uint64_t generation() const { return generation_.load(); } // publications so far
+    const std::string& dir() const { return dir_; }
+
+    // Script name for a source path, or empty if it is not a script
+    std::string name_for(const std::string& source_path) const;
+
+private:
+    struct Entry {
+        std::shared_ptr<CompiledScript> object;
+        std::string source;
+        std::string baseline_key; // identifies the source version
+        ScriptTier tier = ScriptTier::Baseline;
+        // Shared by the tiers of one source version; replaced when it is edited
+        std::shared_ptr<std::atomic<uint64_t>> calls;
+    };
+    using Map = std::unordered_map<std::string, Entry>;
+    struct OptimizeJob {
+        std::string name;
+        std::string source;
+        std::shared_ptr<std::atomic<uint64_t>> calls; // identifies the source version
+    };
+
+    void watch_tree(const std::string& dir); // requires mtx_
+    void watch_loop();
+    void optimizer_loop();
+    void stop_optimizer();
+
+    std::string dir_;
+    ScriptCache& cache_;
+    std::atomic<std::shared_ptr<const Map>> snapshot_{ std::make_shared<const Map>() };
+    std::atomic<uint64_t> generation_{ 0 };
+    std::mutex mtx_; // serializes publication; compiling happens outside it
+    std::atomic<uint64_t> next_stamp_{ 0 };
+    std::unordered_map<std::string, uint64_t> stamps_; // guarded by mtx_: name -> stamp of the last publication or removal
+    int inotify_fd_ = -1;
+    int stop_fd_ = -1;
+    std::unordered_map<int, std::string> watched_dirs_; // inotify wd -> directory
+    std::thread watcher_;
+
+    bool tiering_ = false;
+    uint64_t hot_threshold_ = 0;
+    std::vector<std::string> tier_flags_[2]; // indexed by ScriptTier
+    std::mutex jobs_mtx_;
+    std::condition_variable jobs_cv_;
+    std::deque<OptimizeJob> jobs_;
+    bool stopping_ = false;
+    std::vector<std::thread> optimizers_;
+};
+
+// Process-wide registry of ./scripts, backed by script_cache()
+ScriptRegistry& script_registry();
+
+} // namespace engine
@@ -0,0 +1,525 @@
+#include "script_worker.h"
+#include "script_abi.h"
+#include "sandbox/policy.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace engine {
+
+// Written by the worker at the start of its slot
+struct SlotControl {
+    int32_t status;
+    uint32_t header_len;
+    uint32_t body_len;
+};
+
+struct Command {
+    uint32_t request_size;
+    RequestLayout layout;
+    char entry[64];
+    char so_path[PATH_MAX];
+};
+
+struct Reply {
+    int32_t rc;        // handler return value
+    int32_t loaded;    // 0 if the script or entry point could not be loaded
+    char error[256];
+};
+
+struct SpawnRequest {
+    uint32_t slot;
+};
+
+struct SpawnReply {
+    pid_t pid; // -1 if fork failed
+};
+
+static constexpr size_t CONTROL_BYTES = 64;
+static constexpr size_t MAX_LOADED = 64; // script objects kept open per worker
+
+static bool ieq(std::string_view a, std::string_view b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return tolower(x) == tolower(y); });
+}
+
+long parse_request_head(const char* buf, size_t size, RequestLayout& out, size_t& content_length) {
+    std::string_view all(buf, size);
+    size_t end = all.find("\r\n\r\n");
+    if (end == std::string_view::npos) return 0;
+    out = RequestLayout{};
+    content_length = 0;
+    auto span = [buf](const char* p, size_t len) {
+        return RequestLayout::Span{ static_cast<uint32_t>(p - buf), static_cast<uint32_t>(len) };
+    };
+
+    // Request line: METHOD SP target SP version
+    size_t line_end = all.find("\r\n");
+    std::string_view line = all.substr(0, line_end);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = sp1 == std::string_view::npos ? sp1 : line.find(' ', sp1 + 1);
+    if (sp1 == 0 || sp2 == std::string_view::npos || sp2 == sp1 + 1) return -1;
+    out.method = span(buf, sp1);
+    std::string_view target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    size_t q = target.find('?');
+    out.path = span(target.data(), std::min(q, target.size()));
+    if (q != std::string_view::npos) out.query = span(target.data() + q + 1, target.size() - q - 1);
+
+    size_t pos = line_end + 2;
+    while (pos < end) {
+        size_t eol = all.find("\r\n", pos);
+        std::string_view h = all.substr(pos, eol - pos);
+        pos = eol + 2;
+        size_t colon = h.find(':');
+        if (colon == std::string_view::npos || colon == 0) return -1;
+        std::string_view name = h.substr(0, colon);
+        std::string_view value = h.substr(colon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+        if (ieq(name, "Content-Length")) {
+            size_t n = 0;
+            for (char c : value) {
+                if (c < '0' || c > '9') return -1;
+                n = n * 10 + static_cast<size_t>(c - '0');
+            }
+            content_length = n;
+        }
+        if (out.header_count < RequestLayout::MAX_HEADERS) {
+            out.headers[out.header_count++] = { span(name.data(), name.size()), span(value.data(), value.size()) };
+        }
+    }
+    return static_cast<long>(end + 4);
+}
+
+// ---- worker side ----
+
+struct Writer {
+    SlotControl* ctl;
+    char* headers;
+    size_t header_cap;
+    char* body;
+    size_t body_cap;
+};
+
+static void writer_set_status(void* ctx, int status) {
+    static_cast<Writer*>(ctx)->ctl->status = status;
+}
+
+static int writer_add_header(void* ctx, nn_str name, nn_str value) {
+    auto* w = static_cast<Writer*>(ctx);
+    size_t need = name.size + 2 + value.size + 2;
+    if (w->ctl->header_len + need > w->header_cap) return -1;
+    char* p = w->headers + w->ctl->header_len;
+    memcpy(p, name.data, name.size);
+    memcpy(p + name.size, ": ", 2);
+    memcpy(p + name.size + 2, value.data, value.size);
+    memcpy(p + name.size + 2 + value.size, "\r\n", 2);
+    w->ctl->header_len += static_cast<uint32_t>(need);
+    return 0;
+}
+
+static int writer_write(void* ctx, const void* data, size_t size) {
+    auto* w = static_cast<Writer*>(ctx);
+    if (w->ctl->body_len + size > w->body_cap) return -1;
+    memcpy(w->body + w->ctl->body_len, data, size);
+    w->ctl->body_len += static_cast<uint32_t>(size);
+    return 0;
+}
+
+[[noreturn]] static void worker_main(int sock, char* slot, const ScriptWorkerOptions& opts) {
+    std::unordered_map<std::string, void*> libs; // so path -> handle
+    char* request = slot + CONTROL_BYTES;
+    Writer writer{ reinterpret_cast<SlotControl*>(slot), request + opts.request_bytes, opts.header_bytes,
+                   request + opts.request_bytes + opts.header_bytes, opts.body_bytes };
+    Command cmd;
+    for (;;) {
+        ssize_t n = recv(sock, &cmd, sizeof(cmd), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n != static_cast<ssize_t>(sizeof(cmd))) _exit(0); // server went away
+        cmd.so_path[sizeof(cmd.so_path) - 1] = '\0';
+        cmd.entry[sizeof(cmd.entry) - 1] = '\0';
+
+        Reply reply{};
+        if (libs.size() >= MAX_LOADED && !libs.count(cmd.so_path)) {
+            // Hot reloads leave old versions behind; start over rather than grow
+            for (auto& kv : libs) {
+                if (kv.second) dlclose(kv.second);
+            }
+            libs.clear();
+        }
+        void*& handle = libs[cmd.so_path];
+        if (!handle) handle = dlopen(cmd.so_path, RTLD_NOW | RTLD_LOCAL);
+        auto fn = handle ? reinterpret_cast<nn_handler>(dlsym(handle, cmd.entry)) : nullptr;
+        if (!fn) {
+            snprintf(reply.error, sizeof(reply.error), "%s", handle ? "script has no handler for this method" : dlerror());
+            if (!handle) libs.erase(cmd.so_path);
+            send(sock, &reply, sizeof(reply), MSG_NOSIGNAL);
+            continue;
+        }
+
+        auto view = [&](const RequestLayout::Span& s) {
+            if (static_cast<size_t>(s.off) + s.len > cmd.request_size) return nn_str{ request, 0 };
+            return nn_str{ request + s.off, s.len };
+        };
+        nn_header headers[RequestLayout::MAX_HEADERS];
+        size_t count = std::min<size_t>(cmd.layout.header_count, RequestLayout::MAX_HEADERS);
+        for (size_t i = 0; i < count; ++i) {
+            headers[i] = nn_header{ view(cmd.layout.headers[i][0]), view(cmd.layout.headers[i][1]) };
+        }
+        nn_request req{ NN_SCRIPT_ABI_VERSION, view(cmd.layout.method), view(cmd.layout.path), view(cmd.layout.query),
+                        headers, count, view(cmd.layout.body) };
+        *writer.ctl = SlotControl{ 200, 0, 0 };
+        nn_response res{ &writer, writer_set_status, writer_add_header, writer_write };
+
+        reply.loaded = 1;
+        reply.rc = fn(&req, &res);
+        send(sock, &reply, sizeof(reply), MSG_NOSIGNAL);
+    }
+}
+
+static bool send_fd(int sock, const void* data, size_t size, int fd) {
+    iovec iov{ const_cast<void*>(data), size };
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    if (fd >= 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr* c = CMSG_FIRSTHDR(&msg);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(c), &fd, sizeof(int));
+    }
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(size);
+}
+
+static bool recv_fd(int sock, void* data, size_t size, int& fd) {
+    iovec iov{ data, size };
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    fd = -1;
+    ssize_t n;
+    while ((n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR) {}
+    if (n != static_cast<ssize_t>(size)) return false;
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) memcpy(&fd, CMSG_DATA(c), sizeof(int));
+    }
+    return true;
+}
+
+// Close every descriptor above stdio except `a` and `b` (-1: unused). Runs
+// in the forked zygote and workers, which must not hold on to the server's
+// descriptors: the arena memfd would let a script map the other workers'
+// slots. No allocation, since the parent may have had other threads.
+static void close_other_fds(int a, int b) {
+    int keep[2] = { std::min(a, b), std::max(a, b) };
+    unsigned first = 3;
+    for (int fd : keep) {
+        if (fd < static_cast<int>(first)) continue;
+        if (static_cast<unsigned>(fd) > first) close_range(first, static_cast<unsigned>(fd) - 1, 0);
+        first = static_cast<unsigned>(fd) + 1;
+    }
+    if (close_range(first, ~0U, 0) != 0) {
+        // Kernels before 5.9
+        long max = sysconf(_SC_OPEN_MAX);
+        for (long fd = first; fd < max; ++fd) close(static_cast<int>(fd));
+    }
+}
+
+// ---- pool ----
+
+ScriptWorkerPool::ScriptWorkerPool(ScriptWorkerOptions opts) : opts_(std::move(opts)) {}
+
+ScriptWorkerPool::~ScriptWorkerPool() {
+    stop();
+}
+
+size_t ScriptWorkerPool::slot_size() const {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t bytes = CONTROL_BYTES + opts_.request_bytes + opts_.header_bytes + opts_.body_bytes;
+    return (bytes + page - 1) / page * page;
+}
+
+char* ScriptWorkerPool::slot_base(size_t slot) const {
+    return arena_ + slot * slot_size();
+}
+
+// Threads of this process, from /proc/self/task (0 if unknown)
+static size_t thread_count() {
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return 0;
+    size_t n = 0;
+    while (dirent* e = readdir(dir)) {
+        if (e->d_name[0] != '.') ++n;
+    }
+    closedir(dir);
+    return n;
+}
+
+bool ScriptWorkerPool::start() {
+    if (running()) return true;
+    // The zygote allocates and forks after fork(), which is only safe when no
+    // other thread can have held a lock (malloc's, stdio's) at that moment
+    if (size_t threads = thread_count(); threads > 1) {
+        std::cerr << "[engine/worker] refusing to fork the zygote with " << threads << " threads running" << std::endl;
+        return false;
+    }
+    size_t count = std::max<size_t>(opts_.workers, 1);
+    arena_size_ = slot_size() * count;
+    arena_fd_ = memfd_create("native_node_script_arena", MFD_CLOEXEC);
+    if (arena_fd_ < 0 || ftruncate(arena_fd_, static_cast<off_t>(arena_size_)) != 0) {
+        std::cerr << "[engine/worker] cannot create arena: " << strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+    void* mem = mmap(nullptr, arena_size_, PROT_READ | PROT_WRITE, MAP_SHARED, arena_fd_, 0);
+    if (mem == MAP_FAILED) {
+        std::cerr << "[engine/worker] cannot map arena: " << strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+    arena_ = static_cast<char*>(mem);
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) {
+        std::cerr << "[engine/worker] socketpair failed: " << strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "[engine/worker] fork failed: " << strerror(errno) << std::endl;
+        close(sv[0]);
+        close(sv[1]);
+        stop();
+        return false;
+    }
+    if (pid == 0) {
+        // Zygote: fork a worker per request and hand its socket back
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        signal(SIGCHLD, SIG_IGN); // workers are reaped automatically
+        // The arena stays mapped; the memfd and the server's other descriptors go
+        close_other_fds(sv[1], opts_.policy ? opts_.policy->ruleset_fd() : -1);
+        SpawnRequest req;
+        while (recv(sv[1], &req, sizeof(req), 0) == static_cast<ssize_t>(sizeof(req))) {
+            int pair[2];
+            SpawnReply reply{ -1 };
+            if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) != 0) {
+                send_fd(sv[1], &reply, sizeof(reply), -1);
+                continue;
+            }
+            pid_t worker = fork();
+            if (worker == 0) {
+                prctl(PR_SET_PDEATHSIG, SIGKILL);
+                signal(SIGCHLD, SIG_DFL);
+                close_other_fds(pair[1], opts_.policy ? opts_.policy->ruleset_fd() : -1);
+                // Keep only this worker's slot mapped
+                char* slot = slot_base(req.slot);
+                if (slot > arena_) munmap(arena_, static_cast<size_t>(slot - arena_));
+                char* slot_end = slot + slot_size();
+                if (slot_end < arena_ + arena_size_) munmap(slot_end, static_cast<size_t>(arena_ + arena_size_ - slot_end));
+                if (opts_.policy && !opts_.policy->apply_in_child()) _exit(126);
+                worker_main(pair[1], slot, opts_);
+            }
+            close(pair[1]);
+            reply.pid = worker;
+            send_fd(sv[1], &reply, sizeof(reply), worker > 0 ? pair[0] : -1);
+            close(pair[0]);
+        }
+        _exit(0);
+    }
+    close(sv[1]);
+    zygote_pid_ = pid;
+    zygote_sock_ = sv[0];
+
+    workers_.assign(count, Worker{});
+    idle_.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (!spawn(i)) {
+            stop();
+            return false;
+        }
+        idle_.push_back(i);
+    }
+    std::cout << "[engine/worker] " << count << " script worker(s) ready" << std::endl;
+    return true;
+}
+
+void ScriptWorkerPool::stop() {
+    for (size_t i = 0; i < workers_.size(); ++i) retire(i);
+    workers_.clear();
+    idle_.clear();
+    if (zygote_sock_ >= 0) close(zygote_sock_);
+    zygote_sock_ = -1;
+    if (zygote_pid_ > 0) {
+        kill(zygote_pid_, SIGKILL);
+        while (waitpid(zygote_pid_, nullptr, 0) < 0 && errno == EINTR) {}
+    }
+    zygote_pid_ = -1;
+    if (arena_) munmap(arena_, arena_size_);
+    arena_ = nullptr;
+    if (arena_fd_ >= 0) close(arena_fd_);
+    arena_fd_ = -1;
+}
+
+bool ScriptWorkerPool::spawn(size_t slot) {
+    std::lock_guard<std::mutex> lk(zygote_mtx_);
+    SpawnRequest req{ static_cast<uint32_t>(slot) };
+    SpawnReply reply{ -1 };
+    int fd = -1;
+    if (send(zygote_sock_, &req, sizeof(req), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(req)) ||
+        !recv_fd(zygote_sock_, &reply, sizeof(reply), fd) || reply.pid <= 0 || fd < 0) {
+        std::cerr << "[engine/worker] zygote failed to spawn a worker" << std::endl;
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    workers_[slot] = Worker{ reply.pid, fd };
+    return true;
+}
+
+void ScriptWorkerPool::retire(size_t slot) {
+    Worker& w = workers_[slot];
+    if (w.pid > 0) kill(w.pid, SIGKILL); // reaped by the zygote
+    if (w.sock >= 0) close(w.sock);
+    w = Worker{};
+}
+
+ScriptWorkerPool::Lease ScriptWorkerPool::acquire(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lk(mtx_);
+    if (!running()) return {};
+    auto idle = [this] { return !idle_.empty(); };
+    if (timeout.count() < 0) {
+        cv_.wait(lk, idle);
+    } else if (!cv_.wait_for(lk, timeout, idle)) {
+        return {};
+    }
+    size_t slot = idle_.back();
+    idle_.pop_back();
+    return Lease(this, slot);
+}
+
+void ScriptWorkerPool::give_back(size_t slot) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        idle_.push_back(slot);
+    }
+    cv_.notify_one();
+}
+
+ScriptWorkerPool::Lease::~Lease() {
+    release();
+}
+
+ScriptWorkerPool::Lease::Lease(Lease&& other) noexcept : pool_(other.pool_), slot_(other.slot_) {
+    other.pool_ = nullptr;
+}
+
+ScriptWorkerPool::Lease& ScriptWorkerPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        slot_ = other.slot_;
+        other.pool_ = nullptr;
+    }
+    return *this;
+}
+
+void ScriptWorkerPool::Lease::release() {
+    if (pool_) pool_->give_back(slot_);
+    pool_ = nullptr;
+}
+
+char* ScriptWorkerPool::Lease::request_buffer() const {
+    return pool_->slot_base(slot_) + CONTROL_BYTES;
+}
+
+size_t ScriptWorkerPool::Lease::request_capacity() const {
+    return pool_->request_capacity();
+}
+
+ScriptResponse ScriptWorkerPool::Lease::invoke(const std::string& so_path, const std::string& entry,
+                                               const RequestLayout& layout, size_t request_size) {
+    ScriptResponse r;
+    ScriptWorkerPool& pool = *pool_;
+    // Replace the worker after a crash or timeout so the lease goes back healthy
+    auto replace = [&](int status, const char* error) {
+        pool.retire(slot_);
+        if (pool.spawn(slot_)) ++pool.respawns_;
+        r.status = status;
+        r.error = error;
+        return r;
+    };
+
+    if (so_path.size() >= sizeof(Command::so_path) || entry.size() >= sizeof(Command::entry)) {
+        r.error = "script path too long";
+        return r;
+    }
+    Worker& w = pool.workers_[slot_];
+    if (w.sock < 0 && !pool.spawn(slot_)) {
+        r.status = 503;
+        r.error = "no script worker available";
+        return r;
+    }
+
+    Command cmd{};
+    cmd.request_size = static_cast<uint32_t>(std::min(request_size, pool.opts_.request_bytes));
+    cmd.layout = layout;
+    memcpy(cmd.entry, entry.c_str(), entry.size() + 1);
+    memcpy(cmd.so_path, so_path.c_str(), so_path.size() + 1);
+    if (send(w.sock, &cmd, sizeof(cmd), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(cmd))) {
+        return replace(502, "script worker exited");
+    }
+
+    pollfd pfd{ w.sock, POLLIN, 0 };
+    int pr;
+    while ((pr = poll(&pfd, 1, pool.opts_.timeout_ms)) < 0 && errno == EINTR) {}
+    if (pr == 0) return replace(504, "script timed out");
+    Reply reply{};
+    ssize_t n;
+    while ((n = recv(w.sock, &reply, sizeof(reply), 0)) < 0 && errno == EINTR) {}
+    if (n != static_cast<ssize_t>(sizeof(reply))) return replace(502, "script worker crashed");
+
+    if (!reply.loaded) {
+        reply.error[sizeof(reply.error) - 1] = '\0';
+        r.error = reply.error;
+        return r;
+    }
+    if (reply.rc != 0) {
+        r.error = "handler returned " + std::to_string(reply.rc);
+        return r;
+    }
+    const char* slot = pool.slot_base(slot_);
+    const auto* ctl = reinterpret_cast<const SlotControl*>(slot);
+    const char* headers = slot + CONTROL_BYTES + pool.opts_.request_bytes;
+    const char* body = headers + pool.opts_.header_bytes;
+    r.ok = true;
+    r.status = ctl->status;
+    r.headers = std::string_view(headers, std::min<size_t>(ctl->header_len, pool.opts_.header_bytes));
+    r.body = std::string_view(body, std::min<size_t>(ctl->body_len, pool.opts_.body_bytes));
+    return r;
+}
+
+ScriptWorkerPool& script_workers() {
+    static ScriptWorkerPool pool;
+    return pool;
+}
+
+} // namespace engine
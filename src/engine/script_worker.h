@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+namespace sandbox {
+class CompiledPolicy;
+}
+
+namespace engine {
+
+// Position of each request part inside a worker's request buffer. Offsets
+// rather than pointers, since the worker maps the buffer at another address.
+struct RequestLayout {
+    struct Span {
+        uint32_t off = 0;
+        uint32_t len = 0;
+    };
+    static constexpr size_t MAX_HEADERS = 64;
+
+    Span method, path, query, body;
+    std::array<std::array<Span, 2>, MAX_HEADERS> headers{}; // name, value
+    uint32_t header_count = 0;
+};
+
+// Parse the HTTP/1.x request head in buf[0, size). Returns the head length
+// (through the blank line) and fills `out` (body excluded) and
+// `content_length`; 0 if the head is incomplete, -1 if it is malformed.
+long parse_request_head(const char* buf, size_t size, RequestLayout& out, size_t& content_length);
+
+// Result of one handler call. `headers` and `body` point into the shared
+// arena and stay valid until the Lease they came from is released.
+struct ScriptResponse {
+    bool ok = false; // handler ran and returned 0
+    int status = 500;
+    std::string_view headers; // "Name: value\r\n" lines
+    std::string_view body;
+    std::string error;
+};
+
+struct ScriptWorkerOptions {
+    size_t workers = 2;
+    size_t request_bytes = 64 * 1024; // head + body of one request
+    size_t header_bytes = 8 * 1024;   // response headers
+    size_t body_bytes = 1024 * 1024;  // response body
+    int timeout_ms = 10000;           // per call; the worker is killed and replaced after this
+    // Applied once in each worker before it loads any script (nullptr: none)
+    std::shared_ptr<const sandbox::CompiledPolicy> policy;
+};
+
+// Pre-forked, pre-sandboxed processes that call doGet/doPost of dlopen()ed
+// scripts (see script_abi.h). A zygote forked at start() creates the workers,
+// so replacements never fork the multi-threaded server. Each worker owns one
+// slot of a shared memfd arena: the server receives the request directly into
+// the slot, the worker hands the script views into it and collects the
+// response in the same slot, and the server sends it from there.
+class ScriptWorkerPool {
+public:
+    // Exclusive use of one worker and its arena slot
+    class Lease {
+    public:
+        Lease() = default;
+        ~Lease();
+
+        // Moveable
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+
+        // Non-copyable
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        explicit operator bool() const { return pool_ != nullptr; }
+
+        // Receive the request into this buffer
+        char* request_buffer() const;
+        size_t request_capacity() const;
+
+        // Call `entry` (e.g. "doGet") of the script object at `so_path` with the
+        // first `request_size` bytes of the request buffer, described by `layout`
+        ScriptResponse invoke(const std::string& so_path, const std::string& entry, const RequestLayout& layout,
+                              size_t request_size);
+
+    private:
+        friend class ScriptWorkerPool;
+        Lease(ScriptWorkerPool* pool, size_t slot) : pool_(pool), slot_(slot) {}
+        void release();
+
+        ScriptWorkerPool* pool_ = nullptr;
+        size_t slot_ = 0;
+    };
+
+    explicit ScriptWorkerPool(ScriptWorkerOptions opts = {});
+    ~ScriptWorkerPool();
+
+    // Non-copyable
+    ScriptWorkerPool(const ScriptWorkerPool&) = delete;
+    ScriptWorkerPool& operator=(const ScriptWorkerPool&) = delete;
+
+    // Create the arena, fork the zygote and spawn the workers. Call early:
+    // fails if the process already runs other threads.
+    bool start();
+    void stop();
+    // Sandbox applied in each worker. Call before start(): the zygote keeps
+    // the policy it was forked with.
+    void set_policy(std::shared_ptr<const sandbox::CompiledPolicy> policy) { opts_.policy = std::move(policy); }
+    bool running() const { return zygote_pid_ > 0; }
+
+    // Wait up to `timeout` (negative: forever) for an idle worker. Empty
+    // Lease if none became idle in time or the pool is not running.
+    Lease acquire(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+    // Largest request (head + body) a worker accepts
+    size_t request_capacity() const { return opts_.request_bytes; }
+
+    size_t size() const { return workers_.size(); }
+    uint64_t respawns() const { return respawns_.load(); }
+
+private:
+    struct Worker {
+        pid_t pid = -1;
+        int sock = -1; // SOCK_SEQPACKET to the worker
+    };
+
+    size_t slot_size() const;
+    char* slot_base(size_t slot) const;
+    bool spawn(size_t slot);
+    void retire(size_t slot); // kill and forget a worker
+    void give_back(size_t slot);
+
+    ScriptWorkerOptions opts_;
+    int arena_fd_ = -1;
+    char* arena_ = nullptr;
+    size_t arena_size_ = 0;
+    pid_t zygote_pid_ = -1;
+    int zygote_sock_ = -1;
+    std::mutex zygote_mtx_;
+    std::vector<Worker> workers_;
+    std::vector<size_t> idle_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::atomic<uint64_t> respawns_{ 0 };
+};
+
+// Process-wide worker pool started by engine::initialize
+ScriptWorkerPool& script_workers();
+
+} // namespace engine
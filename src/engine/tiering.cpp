@@ -0,0 +1,41 @@
+#include "tiering.h"
+#include "common/key_value_config.h"
+#include <unistd.h>
+
+namespace engine {
+
+static const char* TIERING_CONF = "config/tiering.conf";
+
+const char* script_tier_name(ScriptTier tier) {
+    switch (tier) {
+    case ScriptTier::Baseline: return "baseline";
+    case ScriptTier::Optimized: return "optimized";
+    }
+    return "unknown";
+}
+
+bool load_tier_config(const std::string& path, TierConfig& cfg) {
+    TierConfig parsed = cfg;
+    bool ok = common::read_key_value_config(path, "engine/tiering", [&parsed](const std::string& key, const std::vector<std::string>& values) {
+        if (key == "enabled" && values.size() == 1) parsed.enabled = values[0] != "0";
+        else if (key == "hot_threshold" && values.size() == 1) parsed.hot_threshold = std::stoull(values[0]);
+        else if (key == "optimizer_threads" && values.size() == 1) parsed.optimizer_threads = std::stoul(values[0]);
+        else if (key == "baseline_flags") parsed.baseline_flags = values;
+        else if (key == "optimized_flags") parsed.optimized_flags = values;
+        else return false;
+        return true;
+    });
+    if (!ok) return false;
+    if (parsed.hot_threshold == 0) parsed.hot_threshold = 1;
+    if (parsed.optimizer_threads == 0) parsed.optimizer_threads = 1;
+    cfg = std::move(parsed);
+    return true;
+}
+
+TierConfig configured_tiering() {
+    TierConfig cfg;
+    if (access(TIERING_CONF, R_OK) == 0) load_tier_config(TIERING_CONF, cfg);
+    return cfg;
+}
+
+} // namespace engine
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace engine {
+
+// Compilation tiers of a script
+enum class ScriptTier { Baseline = 0, Optimized = 1 };
+
+const char* script_tier_name(ScriptTier tier);
+
+// Settings from config/tiering.conf. `baseline_flags` and `optimized_flags`
+// are appended to the compiler flags of the respective tier.
+struct TierConfig {
+    bool enabled = true;
+    uint64_t hot_threshold = 100;
+    size_t optimizer_threads = 1;
+    std::vector<std::string> baseline_flags = { "-O0" };
+    std::vector<std::string> optimized_flags = { "-O2", "-march=native" };
+};
+
+// Parse a tiering config file into `cfg` (unchanged on error)
+bool load_tier_config(const std::string& path, TierConfig& cfg);
+
+// config/tiering.conf if readable, defaults otherwise
+TierConfig configured_tiering();
+
+} // namespace engine
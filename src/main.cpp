@@ -1,10 +1,12 @@
 #include <iostream>
 #include <string>
+#include <vector>
 #include <thread>
 #include <chrono>
 
 #include "engine/engine.h"
 #include "sandbox/sandbox.h"
+#include "sandbox/syscall_profile.h"
 #include "services/services.h"
 #include "web/simple_http.h"
 #include <signal.h>
@@ -33,6 +35,23 @@ int main(int argc, char** argv) {
             std::cout << "JIT smoke test " << (ok ? "succeeded" : "failed") << std::endl;
             return ok ? 0 : 2;
         }
+        // --profile-syscalls <out.conf> <command> [args...]: trace a script and
+        // emit a frequency-ordered seccomp whitelist
+        if (arg == "--profile-syscalls") {
+            if (i + 2 >= argc) {
+                std::cerr << "usage: native_node --profile-syscalls <out.conf> <command> [args...]" << std::endl;
+                return 2;
+            }
+            std::string out = argv[i + 1];
+            std::vector<std::string> cmd(argv + i + 2, argv + argc);
+            sandbox::SyscallCounts counts;
+            if (!sandbox::profile_syscalls(cmd, counts) || !sandbox::write_profiled_whitelist(out, counts)) {
+                std::cerr << "Syscall profiling failed" << std::endl;
+                return 2;
+            }
+            std::cout << "Wrote " << counts.size() << " syscalls to " << out << std::endl;
+            return 0;
+        }
     }
 
     if (!sandbox::apply_default_policy()) {
@@ -44,6 +63,8 @@ int main(int argc, char** argv) {
         std::cerr << "Engine initialization failed" << std::endl;
         return 1;
     }
+    // Threads only from here on: the engine has forked its script workers
+    sandbox::watch_policy_files();
 
     if (!services::initialize()) {
         std::cerr << "Services initialization failed" << std::endl;
@@ -23,7 +23,8 @@ bool is_cgroup_v2_available() {
 static bool write_file(const std::string& path, const std::string& data) {
     std::ofstream ofs(path);
     if (!ofs.is_open()) return false;
-    ofs << data;
+    // The kernel rejects a value in write(), which only happens on flush
+    ofs << data << std::flush;
     return !ofs.fail();
 }
 
@@ -87,6 +88,92 @@ bool set_cgroup_pids_max(const std::string& cgroup_path, const std::string& pids
     return true;
 }
 
+bool set_cgroup_cpu_weight(const std::string& cgroup_path, const std::string& weight) {
+    std::string file = cgroup_path + "/cpu.weight";
+    if (!write_file(file, weight + "\n")) {
+        std::cerr << "[cgroups] failed to write cpu.weight" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool set_cgroup_io_weight(const std::string& cgroup_path, const std::string& weight) {
+    std::string file = cgroup_path + "/io.weight";
+    if (!write_file(file, weight + "\n")) {
+        std::cerr << "[cgroups] failed to write io.weight" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool set_cgroup_memory_high(const std::string& cgroup_path, const std::string& memory_high) {
+    std::string file = cgroup_path + "/memory.high";
+    if (!write_file(file, memory_high + "\n")) {
+        std::cerr << "[cgroups] failed to write memory.high" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool set_cgroup_cpuset_cpus(const std::string& cgroup_path, const std::string& cpus) {
+    std::string file = cgroup_path + "/cpuset.cpus";
+    if (!write_file(file, cpus + "\n")) {
+        std::cerr << "[cgroups] failed to write cpuset.cpus" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool set_cgroup_cpuset_mems(const std::string& cgroup_path, const std::string& mems) {
+    std::string file = cgroup_path + "/cpuset.mems";
+    if (!write_file(file, mems + "\n")) {
+        std::cerr << "[cgroups] failed to write cpuset.mems" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool enable_cgroup_controller(const std::string& controller) {
+    std::string file = CGROUP_ROOT + "/cgroup.subtree_control";
+    std::istringstream enabled(read_cgroup_file(file));
+    std::string name;
+    while (enabled >> name) {
+        if (name == controller) return true;
+    }
+    if (!write_file(file, "+" + controller + "\n")) {
+        std::cerr << "[cgroups] failed to enable controller " << controller << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool set_cgroup_freeze(const std::string& cgroup_path, bool frozen) {
+    std::string file = cgroup_path + "/cgroup.freeze";
+    if (!write_file(file, frozen ? "1\n" : "0\n")) {
+        std::cerr << "[cgroups] failed to write cgroup.freeze" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool kill_cgroup(const std::string& cgroup_path) {
+    std::string file = cgroup_path + "/cgroup.kill";
+    if (!write_file(file, "1\n")) {
+        std::cerr << "[cgroups] failed to write cgroup.kill" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool is_cgroup_populated(const std::string& cgroup_path) {
+    std::ifstream ifs(cgroup_path + "/cgroup.events");
+    std::string key, value;
+    while (ifs >> key >> value) {
+        if (key == "populated") return value != "0";
+    }
+    return false;
+}
+
 std::string read_cgroup_file(const std::string& path) {
     std::ifstream ifs(path);
     if (!ifs.is_open()) return std::string();
@@ -28,6 +28,32 @@ bool set_cgroup_memory_max(const std::string& cgroup_path, const std::string& me
 // Set pids max (integer or "max")
 bool set_cgroup_pids_max(const std::string& cgroup_path, const std::string& pids_max);
 
+// Set the proportional CPU share (cpu.weight, 1-10000, default 100)
+bool set_cgroup_cpu_weight(const std::string& cgroup_path, const std::string& weight);
+
+// Set the proportional IO share (io.weight, "default <1-10000>" or a bare weight)
+bool set_cgroup_io_weight(const std::string& cgroup_path, const std::string& weight);
+
+// Set the memory throttling threshold in bytes (memory.high, or "max")
+bool set_cgroup_memory_high(const std::string& cgroup_path, const std::string& memory_high);
+
+// Set the CPUs (cpuset.cpus, e.g. "2-5,8") and NUMA memory nodes (cpuset.mems, e.g. "0")
+bool set_cgroup_cpuset_cpus(const std::string& cgroup_path, const std::string& cpus);
+bool set_cgroup_cpuset_mems(const std::string& cgroup_path, const std::string& mems);
+
+// Enable a controller (e.g. "cpuset") for children of the cgroup root via
+// cgroup.subtree_control. Returns true if it is (now) enabled.
+bool enable_cgroup_controller(const std::string& controller);
+
+// Freeze (true) or thaw (false) every process in the cgroup via cgroup.freeze
+bool set_cgroup_freeze(const std::string& cgroup_path, bool frozen);
+
+// Kill every process in the cgroup via cgroup.kill (Linux 5.14+)
+bool kill_cgroup(const std::string& cgroup_path);
+
+// True while the cgroup (or a descendant) still contains processes (cgroup.events)
+bool is_cgroup_populated(const std::string& cgroup_path);
+
 // Read back controller files for verification
 std::string read_cgroup_file(const std::string& path);
 } // namespace sandbox
@@ -1,15 +1,28 @@
 #include "executor.h"
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #include <signal.h>
+#include <poll.h>
+#include <sched.h>
 #include <errno.h>
 #include <string.h>
+#include <fcntl.h>
+#include <chrono>
 #include <iostream>
+#include <optional>
+#include <thread>
 #include <vector>
 
+#if !defined(SYS_pidfd_open) && defined(__linux__)
+# define SYS_pidfd_open 434
+#endif
+
 namespace sandbox {
 
+using Clock = std::chrono::steady_clock;
+
 static char** make_argv(const std::vector<std::string>& args) {
     char** argv = new char*[args.size() + 1];
     for (size_t i = 0; i < args.size(); ++i) {
@@ -24,85 +37,127 @@ static void free_argv(char** argv, size_t n) {
     delete[] argv;
 }
 
-ExecResult run_command_in_cgroup(const std::vector<std::string>& args, const CgroupLimits& limits, int timeout_sec) {
-    ExecResult res;
-    if (args.empty()) return res;
+// pidfd for poll()-based exit notification; -1 on kernels without pidfd_open (< 5.3)
+static int open_pidfd(pid_t pid) {
+#if defined(SYS_pidfd_open)
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+    (void)pid;
+    return -1;
+#endif
+}
 
-    InvocationCgroup ig(limits);
-    if (!ig.valid()) {
-        std::cerr << "[executor] failed to create invocation cgroup" << std::endl;
-        return res;
-    }
+// A spawned command being waited on
+struct Running {
+    size_t index = 0;
+    pid_t pid = -1;
+    int pidfd = -1;
+    std::shared_ptr<OutputCapture> cap;
+    Clock::time_point deadline;
+    const InvocationControl* control = nullptr; // frozen time extends the deadline
+    SpawnTrace trace;
+};
 
-    // Create a temp file to capture stdout/stderr
-    char tmpname[] = "/tmp/native_node_exec_XXXXXX";
-    int tmpfd = mkstemp(tmpname);
-    if (tmpfd < 0) {
-        std::cerr << "[executor] failed to create temp file" << std::endl;
-        return res;
+// Deadline with time spent frozen excluded from the timeout
+static Clock::time_point effective_deadline(const Running& r) {
+    if (!r.control) return r.deadline;
+    return r.deadline + std::chrono::duration_cast<Clock::duration>(r.control->frozen_time());
+}
+
+// CPUs a placed child may run on: its lease, else all worker CPUs. The
+// forking thread is usually pinned to the reactor CPUs, and the child keeps
+// that affinity unless it is reset: the cpuset of the invocation cgroup
+// cannot be relied on to override it (no cpuset controller, add_pid failed).
+static bool child_affinity(const CpuPlacer* placer, const CpuLease& lease, cpu_set_t& set) {
+    if (!placer) return false;
+    const std::vector<int>& cpus = lease.valid() ? lease.cpus() : placer->worker_cpus();
+    if (cpus.empty()) return false;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) CPU_SET(cpu, &set);
+    return true;
+}
+
+// Fork and exec `args` with stdout/stderr on a fresh capture, then move the
+// child into `ig`. `affinity`, if set, replaces the child's inherited CPU
+// affinity. Returns false if the capture or fork failed.
+static bool spawn(const std::vector<std::string>& args, const CaptureOptions& capture,
+                  const CompiledPolicy* policy, const cpu_set_t* affinity, InvocationCgroup& ig, int timeout_sec,
+                  Running& out) {
+    // memfd-backed capture of stdout/stderr
+    auto t = Clock::now();
+    auto cap = std::make_shared<OutputCapture>();
+    if (!cap->open(capture)) {
+        std::cerr << "[executor] failed to set up output capture" << std::endl;
+        return false;
     }
+    out.trace.mark(SpawnPhase::CaptureSetup, t);
+
+    // Build argv before fork: the child must not allocate in a threaded parent
+    char** argv = make_argv(args);
+
+    // Close-on-exec pipe: EOF in the parent marks the end of the exec phase
+    int exec_pipe[2] = { -1, -1 };
+    if (pipe2(exec_pipe, O_CLOEXEC) != 0) exec_pipe[0] = exec_pipe[1] = -1;
 
+    t = Clock::now();
     pid_t pid = fork();
     if (pid < 0) {
         std::cerr << "[executor] fork failed: " << strerror(errno) << std::endl;
-        return res;
+        free_argv(argv, args.size());
+        if (exec_pipe[0] >= 0) {
+            close(exec_pipe[0]);
+            close(exec_pipe[1]);
+        }
+        return false;
     }
 
     if (pid == 0) {
-        // Child: exec
-        // Redirect stdout/stderr to tmpfd
-        dup2(tmpfd, STDOUT_FILENO);
-        dup2(tmpfd, STDERR_FILENO);
-        // close tmpfd in child; execv will replace image
-        close(tmpfd);
-        char** argv = make_argv(args);
+        // Child: redirect stdout/stderr to the capture fd, restrict, then exec
+        int fd = cap->child_fd();
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        if (affinity) sched_setaffinity(0, sizeof(*affinity), affinity);
+        if (policy && !policy->apply_in_child()) _exit(126);
         execv(argv[0], argv);
         // If execv returns, error
         _exit(127);
     }
 
+    auto forked = Clock::now();
+    out.trace.mark(SpawnPhase::Fork, t, forked);
+    free_argv(argv, args.size());
+    cap->close_child_end();
+
     // Parent: add child pid to cgroup
     if (!ig.add_pid(pid)) {
         std::cerr << "[executor] failed to add child pid to cgroup" << std::endl;
         // continue: try to wait for child
     }
 
-    int status = 0;
-    int waited = 0;
-    while (waited < timeout_sec) {
-        pid_t w = waitpid(pid, &status, WNOHANG);
-        if (w == pid) break;
-        if (w == 0) {
-            sleep(1);
-            ++waited;
-            continue;
-        }
-        if (w < 0) {
-            if (errno == EINTR) continue;
-            break;
-        }
+    if (exec_pipe[0] >= 0) {
+        close(exec_pipe[1]);
+        char c;
+        while (read(exec_pipe[0], &c, 1) < 0 && errno == EINTR) {}
+        close(exec_pipe[0]);
     }
+    out.trace.mark(SpawnPhase::Exec, forked);
+
+    out.pid = pid;
+    out.pidfd = open_pidfd(pid);
+    out.cap = std::move(cap);
+    out.deadline = Clock::now() + std::chrono::seconds(timeout_sec);
+    return true;
+}
 
-    pid_t w = waitpid(pid, &status, WNOHANG);
-    if (w == 0) {
-        // timed out; kill child
-        kill(pid, SIGKILL);
-        waitpid(pid, &status, 0);
+// Build the result for a reaped (or killed) command
+static ExecResult make_result(Running& r, int status, bool exited) {
+    auto t = Clock::now();
+    r.trace.mark(SpawnPhase::Run, r.trace.span(SpawnPhase::Exec).end, t);
+    ExecResult res;
+    if (!exited) {
         res.success = false;
         res.exit_code = -1;
-        // read output so far
-        lseek(tmpfd, 0, SEEK_SET);
-        std::string out;
-        char buf[4096];
-        ssize_t n;
-        while ((n = read(tmpfd, buf, sizeof(buf))) > 0) out.append(buf, buf + n);
-        res.output = out;
-        close(tmpfd);
-        unlink(tmpname);
-        return res;
-    }
-
-    if (WIFEXITED(status)) {
+    } else if (WIFEXITED(status)) {
         res.exit_code = WEXITSTATUS(status);
         res.success = true;
     } else if (WIFSIGNALED(status)) {
@@ -110,17 +165,166 @@ ExecResult run_command_in_cgroup(const std::vector<std::string>& args, const Cgr
         res.success = false;
     }
 
-    // read output file
-    lseek(tmpfd, 0, SEEK_SET);
-    std::string out;
-    char buf[4096];
-    ssize_t n;
-    while ((n = read(tmpfd, buf, sizeof(buf))) > 0) out.append(buf, buf + n);
-    res.output = out;
-    close(tmpfd);
-    unlink(tmpname);
+    r.cap->finish();
+    res.output_truncated = r.cap->truncated();
+    if (r.cap->mode() == CaptureMode::Handoff) {
+        res.capture = std::move(r.cap);
+    } else {
+        res.output = r.cap->str();
+    }
+    if (r.pidfd >= 0) close(r.pidfd);
+    r.pidfd = -1;
+    r.trace.mark(SpawnPhase::Collect, t);
+    res.trace = r.trace;
+    return res;
+}
+
+// One round of waiting: reap exited or timed-out commands (handing each to
+// `done`), then block in poll() until a pidfd or capture pipe is ready or the
+// nearest deadline passes. Without pidfds, waitpid() is re-checked every 50ms.
+static void wait_round(std::vector<Running>& running, const std::function<void(Running&, ExecResult&&, bool)>& done) {
+    auto now = Clock::now();
+    for (size_t i = 0; i < running.size();) {
+        Running& r = running[i];
+        int status = 0;
+        pid_t w = waitpid(r.pid, &status, WNOHANG);
+        bool exited = w == r.pid;
+        bool lost = w < 0 && errno != EINTR;
+        if (!exited && !lost && now < effective_deadline(r)) {
+            ++i;
+            continue;
+        }
+        bool timed_out = !exited && !lost;
+        if (timed_out) {
+            kill(r.pid, SIGKILL);
+            waitpid(r.pid, &status, 0);
+        }
+        done(r, make_result(r, status, exited), timed_out);
+        running.erase(running.begin() + static_cast<long>(i));
+    }
+    if (running.empty()) return;
+
+    std::vector<struct pollfd> pfds;
+    auto next_deadline = effective_deadline(running.front());
+    bool all_pidfds = true;
+    for (const auto& r : running) {
+        if (r.pidfd >= 0) pfds.push_back({ r.pidfd, POLLIN, 0 });
+        else all_pidfds = false;
+        if (r.cap->read_fd() >= 0) pfds.push_back({ r.cap->read_fd(), POLLIN, 0 });
+        auto deadline = effective_deadline(r);
+        if (deadline < next_deadline) next_deadline = deadline;
+    }
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(next_deadline - Clock::now()).count() + 1;
+    if (left < 0) left = 0;
+    if (!all_pidfds && left > 50) left = 50;
+    poll(pfds.data(), pfds.size(), static_cast<int>(left));
+    for (auto& r : running) {
+        if (r.cap->read_fd() >= 0) r.cap->drain();
+    }
+}
+
+ExecResult run_command_in_cgroup(const std::vector<std::string>& args, const CgroupLimits& limits, int timeout_sec) {
+    ExecOptions opts;
+    opts.timeout_sec = timeout_sec;
+    return run_command_in_cgroup(args, limits, opts);
+}
+
+ExecResult run_command_in_cgroup(const std::vector<std::string>& args, const CgroupLimits& limits, const ExecOptions& opts) {
+    ExecResult res;
+    if (args.empty()) return res;
+
+    CpuLease lease;
+    CgroupLimits placed = limits;
+    if (opts.placer) {
+        lease = opts.placer->acquire(1);
+        lease.apply_to(placed);
+    }
+
+    std::vector<Running> running(1);
+    std::optional<InvocationCgroup> ig;
+    ig.emplace(placed, &running[0].trace);
+    if (!ig->valid()) {
+        std::cerr << "[executor] failed to create invocation cgroup" << std::endl;
+        return res;
+    }
+
+    cpu_set_t affinity;
+    bool pin = child_affinity(opts.placer, lease, affinity);
+    if (!spawn(args, opts.capture, opts.policy.get(), pin ? &affinity : nullptr, *ig, opts.timeout_sec, running[0])) return res;
+    pid_t pid = running[0].pid;
+    if (opts.control) {
+        opts.control->attach(ig->path());
+        running[0].control = opts.control.get();
+    }
 
+    bool timed_out = false;
+    while (!running.empty()) {
+        wait_round(running, [&](Running&, ExecResult&& r, bool t) {
+            res = std::move(r);
+            timed_out = t;
+        });
+    }
+    if (opts.control) opts.control->detach();
+    // Kill anything the command left behind so the cgroup can be removed
+    auto t = Clock::now();
+    if (timed_out) ig->kill_all();
+    ig.reset();
+    res.trace.mark(SpawnPhase::Teardown, t);
+
+    spawn_histograms().record(res.trace);
+    spawn_trace_ring().push(args[0], pid, res.trace);
     return res;
 }
 
+bool run_batch_in_cgroup(const std::vector<std::vector<std::string>>& commands, const BatchOptions& opts,
+                         const BatchCallback& on_result) {
+    size_t max_parallel = opts.max_parallel;
+    if (max_parallel == 0) max_parallel = opts.placer ? opts.placer->worker_cpus().size() : std::thread::hardware_concurrency();
+    if (max_parallel == 0) max_parallel = 1;
+
+    CpuLease lease;
+    CgroupLimits placed = opts.limits;
+    if (opts.placer) {
+        lease = opts.placer->acquire(max_parallel);
+        lease.apply_to(placed);
+    }
+
+    // One cgroup for the whole batch: its limits apply to all commands together
+    InvocationCgroup ig(placed);
+    if (!ig.valid()) {
+        std::cerr << "[executor] failed to create batch cgroup" << std::endl;
+        return false;
+    }
+
+    cpu_set_t affinity;
+    bool pin = child_affinity(opts.placer, lease, affinity);
+    std::vector<Running> running;
+    size_t next = 0;
+    bool any_timed_out = false;
+    auto done = [&](Running& r, ExecResult&& res, bool timed_out) {
+        any_timed_out = any_timed_out || timed_out;
+        spawn_histograms().record(res.trace);
+        spawn_trace_ring().push(commands[r.index][0], r.pid, res.trace);
+        on_result(r.index, std::move(res));
+    };
+    while (next < commands.size() || !running.empty()) {
+        while (next < commands.size() && running.size() < max_parallel) {
+            Running r;
+            r.index = next++;
+            if (commands[r.index].empty() ||
+                !spawn(commands[r.index], opts.capture, opts.policy.get(), pin ? &affinity : nullptr, ig,
+                       opts.item_timeout_sec, r)) {
+                on_result(r.index, ExecResult());
+                continue;
+            }
+            running.push_back(std::move(r));
+        }
+        if (!running.empty()) wait_round(running, done);
+    }
+
+    // Timed-out commands may have left grandchildren behind
+    if (any_timed_out) ig.kill_all();
+    return true;
+}
+
 } // namespace sandbox
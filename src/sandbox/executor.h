@@ -2,7 +2,13 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <functional>
 #include "invocation_cgroup.h"
+#include "output_capture.h"
+#include "policy.h"
+#include "placement.h"
+#include "spawn_trace.h"
 
 namespace sandbox {
 
@@ -10,11 +16,52 @@ struct ExecResult {
     int exit_code = -1;
     int term_signal = 0;
     bool success = false;
-    std::string output;
+    std::string output;            // retained output (empty in Handoff mode)
+    bool output_truncated = false; // output exceeded the capture limit
+    // Handoff mode only: memfd holding the full output, e.g. for sendfile()
+    std::shared_ptr<OutputCapture> capture;
+    // Per-phase timestamps (cgroup setup, fork, exec, run, collect, teardown).
+    // Also recorded in spawn_histograms() and spawn_trace_ring().
+    SpawnTrace trace;
+};
+
+struct ExecOptions {
+    int timeout_sec = 30;
+    CaptureOptions capture;
+    // Applied in the child before execv; null runs the command unrestricted
+    std::shared_ptr<const CompiledPolicy> policy;
+    // When set, the invocation is confined to one leased CPU and its NUMA node
+    // (overriding limits.cpuset_cpus/cpuset_mems)
+    CpuPlacer* placer = nullptr;
+    // When set, attached to the invocation cgroup while the command runs so
+    // other threads can freeze/thaw it; frozen time does not count toward timeout_sec
+    std::shared_ptr<InvocationControl> control;
 };
 
 // Run a command (args[0] executable, args[1..] argv) inside a transient InvocationCgroup
 // with the provided limits. Blocks until command exits or timeout (seconds) elapses.
 ExecResult run_command_in_cgroup(const std::vector<std::string>& args, const CgroupLimits& limits, int timeout_sec = 30);
 
+// As above, with explicit options (timeout, output capture, sandbox policy).
+ExecResult run_command_in_cgroup(const std::vector<std::string>& args, const CgroupLimits& limits, const ExecOptions& opts);
+
+struct BatchOptions {
+    CgroupLimits limits;      // aggregate limits on the shared parent cgroup
+    size_t max_parallel = 0;  // concurrent commands; 0 = number of online CPUs
+    int item_timeout_sec = 30;
+    CaptureOptions capture;
+    std::shared_ptr<const CompiledPolicy> policy;
+    // When set, the batch cgroup is confined to max_parallel leased CPUs
+    CpuPlacer* placer = nullptr;
+};
+
+// Invoked once per command, in completion order, on the calling thread
+using BatchCallback = std::function<void(size_t index, ExecResult&& result)>;
+
+// Run many commands inside one shared InvocationCgroup, at most max_parallel at
+// a time. The cgroup is created once for the whole batch; each command gets its
+// own output capture and timeout. Returns false if the cgroup could not be created.
+bool run_batch_in_cgroup(const std::vector<std::vector<std::string>>& commands, const BatchOptions& opts,
+                         const BatchCallback& on_result);
+
 } // namespace sandbox
@@ -0,0 +1,312 @@
+#include "executor_pool.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace sandbox {
+
+static const char* PRIORITY_CLASSES_CONF = "config/priority_classes.conf";
+
+std::vector<PriorityClass> default_priority_classes() {
+    PriorityClass interactive;
+    interactive.name = "interactive";
+    interactive.limits.cpu_weight = "1000";
+    interactive.limits.io_weight = "1000";
+    interactive.timeout_sec = 10;
+
+    PriorityClass def;
+    def.name = "default";
+    def.limits.cpu_weight = "100";
+    def.limits.io_weight = "100";
+
+    PriorityClass batch;
+    batch.name = "batch";
+    batch.limits.cpu_weight = "10";
+    batch.limits.io_weight = "10";
+    batch.limits.memory_high = "536870912";
+    batch.timeout_sec = 300;
+    batch.preemptible = true;
+
+    return { interactive, def, batch };
+}
+
+// Apply one key=value setting to a class
+static bool set_class_field(PriorityClass& cls, const std::string& key, const std::string& value) {
+    if (key == "cpu.weight") cls.limits.cpu_weight = value;
+    else if (key == "io.weight") cls.limits.io_weight = value;
+    else if (key == "memory.high") cls.limits.memory_high = value;
+    else if (key == "memory.max") cls.limits.memory_max = value;
+    else if (key == "cpu.max") cls.limits.cpu_max = value;
+    else if (key == "pids.max") cls.limits.pids_max = value;
+    else if (key == "preemptible") cls.preemptible = value == "1" || value == "true";
+    else if (key == "timeout") {
+        try {
+            cls.timeout_sec = std::stoi(value);
+        } catch (const std::exception&) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool load_priority_classes(const std::string& path, std::vector<PriorityClass>& classes) {
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        std::cerr << "[executor_pool] could not open priority classes: " << path << std::endl;
+        return false;
+    }
+    std::vector<PriorityClass> parsed;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        std::istringstream ss(line);
+        PriorityClass cls;
+        if (!(ss >> cls.name)) continue;
+        std::string field;
+        while (ss >> field) {
+            size_t eq = field.find('=');
+            if (eq == std::string::npos || !set_class_field(cls, field.substr(0, eq), field.substr(eq + 1))) {
+                std::cerr << "[executor_pool] invalid setting '" << field << "' for class " << cls.name << " in " << path << std::endl;
+                return false;
+            }
+        }
+        parsed.push_back(cls);
+    }
+    if (parsed.empty()) {
+        std::cerr << "[executor_pool] no priority classes in " << path << std::endl;
+        return false;
+    }
+    classes = std::move(parsed);
+    return true;
+}
+
+ExecutorPool::ExecutorPool(std::vector<PriorityClass> classes, size_t workers) {
+    for (auto& cls : classes) queues_.push_back(Queue{ std::move(cls), {} });
+    if (workers == 0) workers = 1;
+    limit_ = workers;
+    for (size_t i = 0; i < workers; ++i) workers_.emplace_back(&ExecutorPool::worker_loop, this);
+}
+
+ExecutorPool::~ExecutorPool() {
+    shutdown();
+}
+
+std::vector<std::string> ExecutorPool::class_names() const {
+    std::vector<std::string> names;
+    for (const auto& q : queues_) names.push_back(q.cls.name);
+    return names;
+}
+
+const PriorityClass* ExecutorPool::find_class(const std::string& name) const {
+    for (const auto& q : queues_) {
+        if (q.cls.name == name) return &q.cls;
+    }
+    return nullptr;
+}
+
+bool ExecutorPool::enqueue(const std::string& class_name, Job&& job) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it = std::find_if(queues_.begin(), queues_.end(), [&](const Queue& q) { return q.cls.name == class_name; });
+        if (it == queues_.end() || stopping_) {
+            std::cerr << "[executor_pool] rejected job for class '" << class_name << "'" << std::endl;
+            return false;
+        }
+        it->jobs.push_back(std::move(job));
+        rebalance_locked();
+    }
+    cv_.notify_one();
+    return true;
+}
+
+std::future<ExecResult> ExecutorPool::submit(const std::string& class_name, std::vector<std::string> args, ExecOptions opts) {
+    Job job{ std::move(args), std::move(opts), {}, {} };
+    auto fut = job.result.get_future();
+    std::promise<ExecResult> rejected;
+    if (!enqueue(class_name, std::move(job))) {
+        fut = rejected.get_future();
+        rejected.set_value(ExecResult());
+    }
+    return fut;
+}
+
+bool ExecutorPool::submit(const std::string& class_name, std::vector<std::string> args, ExecOptions opts,
+                          std::function<void(ExecResult&&)> on_done) {
+    return enqueue(class_name, Job{ std::move(args), std::move(opts), {}, std::move(on_done) });
+}
+
+size_t ExecutorPool::queued(const std::string& class_name) const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (const auto& q : queues_) {
+        if (q.cls.name == class_name) return q.jobs.size();
+    }
+    return 0;
+}
+
+size_t ExecutorPool::running() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return running_;
+}
+
+size_t ExecutorPool::frozen_locked() const {
+    return static_cast<size_t>(std::count_if(active_.begin(), active_.end(), [](const Active& a) { return a.control->frozen(); }));
+}
+
+size_t ExecutorPool::frozen() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return frozen_locked();
+}
+
+void ExecutorPool::rebalance_locked() {
+    size_t urgent = 0;
+    for (const auto& q : queues_) {
+        if (!q.cls.preemptible) urgent += q.jobs.size();
+    }
+    size_t active = running_ - frozen_locked();
+
+    if (urgent > 0) {
+        // Preempt the newest preemptible invocations, one per waiting job that lacks a slot
+        for (auto it = active_.rbegin(); it != active_.rend() && urgent > 0 && active >= limit_; ++it) {
+            if (!it->cls->preemptible || it->control->frozen()) continue;
+            if (!it->control->freeze()) continue;
+            std::cout << "[executor_pool] froze a '" << it->cls->name << "' invocation for waiting work" << std::endl;
+            --active;
+            --urgent;
+        }
+        return;
+    }
+
+    // Nothing urgent: resume frozen work, oldest first, while the limit has room
+    for (auto& a : active_) {
+        if (active >= limit_) break;
+        if (a.control->frozen() && a.control->thaw()) ++active;
+    }
+}
+
+size_t ExecutorPool::concurrency_limit() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return limit_;
+}
+
+void ExecutorPool::set_concurrency_limit(size_t limit) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        limit_ = std::clamp<size_t>(limit, 1, workers_.size());
+        rebalance_locked();
+    }
+    cv_.notify_all();
+}
+
+bool ExecutorPool::enable_adaptive_limit(const PressureFiles& files, AimdLimiter::Options opts,
+                                         const PressureMonitor::Options& monitor) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        opts.max_limit = std::min(opts.max_limit, workers_.size());
+        opts.initial = limit_;
+        aimd_ = std::make_unique<AimdLimiter>(opts);
+        limit_ = aimd_->limit();
+    }
+    return monitor_.start(files, monitor, [this](const PressureSample& sample) {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            bool waiting = std::any_of(queues_.begin(), queues_.end(), [](const Queue& q) { return !q.jobs.empty(); });
+            size_t before = limit_;
+            limit_ = aimd_->update(sample, waiting && running_ >= limit_);
+            last_sample_ = sample;
+            rebalance_locked();
+            if (limit_ != before) {
+                std::cout << "[executor_pool] concurrency limit " << before << " -> " << limit_
+                          << " (pressure " << sample.peak() << "%" << (sample.triggered ? ", trigger" : "") << ")" << std::endl;
+            }
+        }
+        cv_.notify_all();
+    });
+}
+
+PressureSample ExecutorPool::last_pressure() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return last_sample_;
+}
+
+void ExecutorPool::shutdown() {
+    monitor_.stop();
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+    workers_.clear();
+}
+
+void ExecutorPool::worker_loop() {
+    for (;;) {
+        Job job;
+        const PriorityClass* cls = nullptr;
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            auto pick = [&]() -> Queue* {
+                for (auto& q : queues_) {
+                    if (!q.jobs.empty()) return &q;
+                }
+                return nullptr;
+            };
+            Queue* q = nullptr;
+            cv_.wait(lk, [&]() {
+                q = pick();
+                return (q && running_ - frozen_locked() < limit_) || (!q && stopping_);
+            });
+            if (!q) return;
+            job = std::move(q->jobs.front());
+            q->jobs.pop_front();
+            cls = &q->cls;
+            ++running_;
+            job.opts.control = std::make_shared<InvocationControl>();
+            active_.push_back(Active{ cls, job.opts.control });
+        }
+
+        job.opts.timeout_sec = cls->timeout_sec;
+        ExecResult res = run_command_in_cgroup(job.args, cls->limits, job.opts);
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            --running_;
+            active_.erase(std::find_if(active_.begin(), active_.end(),
+                                       [&](const Active& a) { return a.control == job.opts.control; }));
+            rebalance_locked();
+        }
+        cv_.notify_all();
+        if (job.on_done) job.on_done(std::move(res));
+        else job.result.set_value(std::move(res));
+    }
+}
+
+static std::vector<PriorityClass> configured_priority_classes() {
+    std::vector<PriorityClass> classes = default_priority_classes();
+    if (access(PRIORITY_CLASSES_CONF, R_OK) == 0 && !load_priority_classes(PRIORITY_CLASSES_CONF, classes)) {
+        std::cerr << "[executor_pool] error: " << PRIORITY_CLASSES_CONF
+                  << " could not be parsed; using the built-in priority classes" << std::endl;
+    }
+    return classes;
+}
+
+ExecutorPool& executor_pool() {
+    // Twice the CPU count in workers as headroom; PSI decides how many run
+    static ExecutorPool pool(configured_priority_classes(), 2 * std::max(1u, std::thread::hardware_concurrency()));
+    static bool adaptive = [&]() {
+        AimdLimiter::Options opts;
+        opts.max_limit = 2 * std::max(1u, std::thread::hardware_concurrency());
+        pool.set_concurrency_limit(std::max(1u, std::thread::hardware_concurrency()));
+        return pool.enable_adaptive_limit(invocation_parent_pressure_files(), opts);
+    }();
+    (void)adaptive;
+    return pool;
+}
+
+} // namespace sandbox
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "executor.h"
+#include "pressure.h"
+
+namespace sandbox {
+
+// A named scheduling class. Classes earlier in the list are dispatched first;
+// `limits` (cpu.weight, io.weight, memory.high, ...) are applied to every
+// invocation cgroup of the class.
+struct PriorityClass {
+    std::string name;
+    CgroupLimits limits;
+    int timeout_sec = 30;
+    bool preemptible = false; // may be frozen while non-preemptible work is waiting
+};
+
+// interactive (cpu/io weight 1000), default (100), batch (10, memory.high 512M,
+// preemptible)
+std::vector<PriorityClass> default_priority_classes();
+
+// Load classes from a config file. Each non-empty line is
+//   <name> [cpu.weight=N] [io.weight=N] [memory.high=BYTES|max] [memory.max=..]
+//          [cpu.max=..] [pids.max=..] [timeout=SECONDS] [preemptible=0|1]
+// in priority order, highest first. Returns false on a parse error.
+bool load_priority_classes(const std::string& path, std::vector<PriorityClass>& classes);
+
+// Fixed set of worker threads running invocations from one FIFO queue per
+// priority class. A free worker always takes the oldest job of the highest
+// class with queued work, so interactive requests never wait behind queued
+// batch jobs; once running, the class's cpu.weight sets its CPU share.
+// At most concurrency_limit() invocations run at once. The limit is static
+// unless an adaptive limit is enabled, in which case PSI pressure of the
+// invocations' parent cgroup drives it through an AimdLimiter.
+// When work of a non-preemptible class is waiting and no slot is free, the
+// most recently started preemptible invocation is frozen (cgroup.freeze) and
+// its slot handed over. Frozen invocations are thawed, newest last, once no
+// such work is waiting and the limit has room again; their frozen time does
+// not count toward their timeout.
+class ExecutorPool {
+public:
+    // `workers` threads; the concurrency limit starts at `workers`
+    ExecutorPool(std::vector<PriorityClass> classes, size_t workers);
+    ~ExecutorPool();
+
+    // Non-copyable
+    ExecutorPool(const ExecutorPool&) = delete;
+    ExecutorPool& operator=(const ExecutorPool&) = delete;
+
+    // Class names in priority order
+    std::vector<std::string> class_names() const;
+
+    // nullptr if no class has this name
+    const PriorityClass* find_class(const std::string& name) const;
+
+    // Queue a command under `class_name`. The class supplies the cgroup limits
+    // and the timeout; capture, policy and placer come from `opts`. An unknown
+    // class resolves to a failed result.
+    std::future<ExecResult> submit(const std::string& class_name, std::vector<std::string> args, ExecOptions opts = {});
+
+    // As above, but `on_done` is invoked on the worker thread instead of
+    // fulfilling a future. Returns false (without calling it) for an unknown class
+    // or once the pool is stopping.
+    bool submit(const std::string& class_name, std::vector<std::string> args, ExecOptions opts,
+                std::function<void(ExecResult&&)> on_done);
+
+    // Jobs waiting in a class queue (not yet running)
+    size_t queued(const std::string& class_name) const;
+
+    // Invocations currently running
+    size_t running() const;
+
+    // Running invocations currently frozen (they do not hold a slot)
+    size_t frozen() const;
+
+    // Current cap on running (unfrozen) invocations (at most the number of workers)
+    size_t concurrency_limit() const;
+    void set_concurrency_limit(size_t limit);
+
+    // Drive the limit from PSI: sample `files` (and react to their triggers)
+    // and feed each sample to an AimdLimiter. opts.max_limit is capped at the
+    // number of workers.
+    bool enable_adaptive_limit(const PressureFiles& files, AimdLimiter::Options opts,
+                               const PressureMonitor::Options& monitor = {});
+
+    // Most recent PSI sample seen by the adaptive limiter
+    PressureSample last_pressure() const;
+
+    // Stop accepting work, finish queued jobs and join the workers
+    void shutdown();
+
+private:
+    struct Job {
+        std::vector<std::string> args;
+        ExecOptions opts;
+        std::promise<ExecResult> result;
+        std::function<void(ExecResult&&)> on_done; // replaces `result` when set
+    };
+    struct Queue {
+        PriorityClass cls;
+        std::deque<Job> jobs;
+    };
+    struct Active {
+        const PriorityClass* cls;
+        std::shared_ptr<InvocationControl> control;
+    };
+
+    bool enqueue(const std::string& class_name, Job&& job);
+    size_t frozen_locked() const;
+    void rebalance_locked(); // freeze/thaw preemptible work; requires mtx_
+    void worker_loop();
+
+    std::deque<Queue> queues_; // priority order (deque: Job is move-only)
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    size_t running_ = 0;
+    std::vector<Active> active_; // oldest first
+    size_t limit_ = 0;
+    std::unique_ptr<AimdLimiter> aimd_;
+    PressureSample last_sample_;
+    std::vector<std::thread> workers_;
+    PressureMonitor monitor_;
+};
+
+// Process-wide pool using config/priority_classes.conf (or the defaults)
+ExecutorPool& executor_pool();
+
+} // namespace sandbox
@@ -5,6 +5,9 @@
 #include <sstream>
 #include <random>
 #include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
 
 namespace sandbox {
 
@@ -18,7 +21,23 @@ static std::string make_unique_name() {
     return ss.str();
 }
 
-InvocationCgroup::InvocationCgroup(const CgroupLimits& limits) {
+// Enable `controller` in the root's cgroup.subtree_control. A failure means
+// limits of that controller are silently not enforced, so it is reported as
+// an error, once per controller rather than per invocation.
+static bool require_controller(const std::string& controller) {
+    if (enable_cgroup_controller(controller)) return true;
+    static std::mutex mtx;
+    static std::set<std::string> reported;
+    std::lock_guard<std::mutex> lk(mtx);
+    if (reported.insert(controller).second) {
+        std::cerr << "[invocation_cgroup] error: cannot enable the " << controller
+                  << " controller; its limits are not applied to invocations" << std::endl;
+    }
+    return false;
+}
+
+InvocationCgroup::InvocationCgroup(const CgroupLimits& limits, SpawnTrace* trace) {
+    auto t = SpawnTrace::Clock::now();
     if (!is_cgroup_v2_available()) {
         created_ = false;
         return;
@@ -30,10 +49,25 @@ InvocationCgroup::InvocationCgroup(const CgroupLimits& limits) {
         created_ = false;
         return;
     }
-    // Apply limits if provided
-    if (!limits.cpu_max.empty()) set_cgroup_cpu_max(p, limits.cpu_max);
+    if (trace) trace->mark(SpawnPhase::CgroupCreate, t);
+    t = SpawnTrace::Clock::now();
+
+    // Apply limits if provided. A controller's files only appear once it is
+    // enabled for the root's children.
     if (!limits.memory_max.empty()) set_cgroup_memory_max(p, limits.memory_max);
     if (!limits.pids_max.empty()) set_cgroup_pids_max(p, limits.pids_max);
+    if (!limits.memory_high.empty()) set_cgroup_memory_high(p, limits.memory_high);
+    if ((!limits.cpu_max.empty() || !limits.cpu_weight.empty()) && require_controller("cpu")) {
+        if (!limits.cpu_max.empty()) set_cgroup_cpu_max(p, limits.cpu_max);
+        if (!limits.cpu_weight.empty()) set_cgroup_cpu_weight(p, limits.cpu_weight);
+    }
+    if (!limits.io_weight.empty() && require_controller("io")) set_cgroup_io_weight(p, limits.io_weight);
+    if ((!limits.cpuset_cpus.empty() || !limits.cpuset_mems.empty()) && require_controller("cpuset")) {
+        if (!limits.cpuset_cpus.empty()) set_cgroup_cpuset_cpus(p, limits.cpuset_cpus);
+        if (!limits.cpuset_mems.empty()) set_cgroup_cpuset_mems(p, limits.cpuset_mems);
+    }
+
+    if (trace) trace->mark(SpawnPhase::CgroupLimits, t);
 
     path_ = p;
     created_ = true;
@@ -71,4 +105,64 @@ bool InvocationCgroup::add_pid(pid_t pid) {
     return add_pid_to_cgroup(path_, pid);
 }
 
+bool InvocationCgroup::kill_all() {
+    if (!created_) return false;
+    if (!kill_cgroup(path_)) return false;
+    // SIGKILL delivery is asynchronous; give the tasks a moment to exit
+    for (int i = 0; i < 20 && is_cgroup_populated(path_); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return !is_cgroup_populated(path_);
+}
+
+bool InvocationControl::freeze() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (path_.empty()) return false;
+    if (frozen_) return true;
+    if (!set_cgroup_freeze(path_, true)) return false;
+    frozen_ = true;
+    frozen_since_ = Clock::now();
+    return true;
+}
+
+bool InvocationControl::thaw() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (path_.empty()) return false;
+    if (!frozen_) return true;
+    if (!set_cgroup_freeze(path_, false)) return false;
+    frozen_ = false;
+    frozen_total_ += Clock::now() - frozen_since_;
+    return true;
+}
+
+bool InvocationControl::attached() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return !path_.empty();
+}
+
+bool InvocationControl::frozen() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return frozen_;
+}
+
+InvocationControl::Clock::duration InvocationControl::frozen_time() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return frozen_ ? frozen_total_ + (Clock::now() - frozen_since_) : frozen_total_;
+}
+
+void InvocationControl::attach(const std::string& cgroup_path) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    path_ = cgroup_path;
+}
+
+void InvocationControl::detach() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (frozen_) {
+        set_cgroup_freeze(path_, false);
+        frozen_ = false;
+        frozen_total_ += Clock::now() - frozen_since_;
+    }
+    path_.clear();
+}
+
 } // namespace sandbox
@@ -2,6 +2,9 @@
 
 #include <string>
 #include <optional>
+#include <chrono>
+#include <mutex>
+#include "spawn_trace.h"
 
 namespace sandbox {
 
@@ -9,13 +12,19 @@ struct CgroupLimits {
     std::string cpu_max;    // e.g., "100000 100000" or "max"
     std::string memory_max; // bytes or "max"
     std::string pids_max;   // integer or "max"
+    std::string cpu_weight;  // 1-10000 (default 100); empty leaves the default
+    std::string io_weight;   // 1-10000 (default 100); empty leaves the default
+    std::string memory_high; // throttling threshold in bytes or "max"
+    std::string cpuset_cpus; // CPU list, e.g. "2-5"; empty inherits all CPUs
+    std::string cpuset_mems; // NUMA node list, e.g. "0"; empty inherits all nodes
 };
 
 // RAII helper for per-invocation transient cgroups.
 // Creates a uniquely named cgroup and applies optional resource limits.
 class InvocationCgroup {
 public:
-    explicit InvocationCgroup(const CgroupLimits& limits);
+    // `trace`, if given, receives the CgroupCreate and CgroupLimits phases
+    explicit InvocationCgroup(const CgroupLimits& limits, SpawnTrace* trace = nullptr);
     ~InvocationCgroup();
 
     // Non-copyable
@@ -32,9 +41,49 @@ public:
     // Add a pid to this invocation cgroup (defaults to current process)
     bool add_pid(pid_t pid = 0);
 
+    // Kill every process left in the cgroup (e.g. grandchildren of a timed-out
+    // command) and wait briefly for it to drain so it can be removed.
+    bool kill_all();
+
 private:
     std::string path_;
     bool created_ = false;
 };
 
+// Thread-safe handle for pausing a running invocation. The executor attaches
+// the invocation's cgroup while the command runs; any thread may then freeze
+// or thaw it. Time spent frozen is accumulated so the executor can exclude it
+// from the command's timeout.
+class InvocationControl {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    InvocationControl() = default;
+
+    // Non-copyable
+    InvocationControl(const InvocationControl&) = delete;
+    InvocationControl& operator=(const InvocationControl&) = delete;
+
+    // Freeze/thaw the attached cgroup; false if nothing is attached or the write failed
+    bool freeze();
+    bool thaw();
+
+    bool attached() const;
+    bool frozen() const;
+    // Total time spent frozen, including the current freeze
+    Clock::duration frozen_time() const;
+
+    // Used by the executor: attach when the command starts, detach (thawing
+    // first) before the cgroup is removed
+    void attach(const std::string& cgroup_path);
+    void detach();
+
+private:
+    mutable std::mutex mtx_;
+    std::string path_;
+    bool frozen_ = false;
+    Clock::time_point frozen_since_;
+    Clock::duration frozen_total_{};
+};
+
 } // namespace sandbox
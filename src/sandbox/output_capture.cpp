@@ -0,0 +1,202 @@
+#include "output_capture.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <iostream>
+#include <utility>
+
+namespace sandbox {
+
+static bool pwrite_all(int fd, const char* data, size_t len, off_t off) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        off += n;
+    }
+    return true;
+}
+
+static bool pread_all(int fd, char* data, size_t len, off_t off) {
+    while (len > 0) {
+        ssize_t n = pread(fd, data, len, off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+        off += n;
+    }
+    return true;
+}
+
+OutputCapture::~OutputCapture() {
+    reset();
+}
+
+OutputCapture::OutputCapture(OutputCapture&& o) noexcept {
+    *this = std::move(o);
+}
+
+OutputCapture& OutputCapture::operator=(OutputCapture&& o) noexcept {
+    if (this != &o) {
+        reset();
+        opts_ = o.opts_;
+        memfd_ = std::exchange(o.memfd_, -1);
+        pipe_rd_ = std::exchange(o.pipe_rd_, -1);
+        pipe_wr_ = std::exchange(o.pipe_wr_, -1);
+        size_ = o.size_;
+        head_ = o.head_;
+        wrapped_ = o.wrapped_;
+        truncated_ = o.truncated_;
+    }
+    return *this;
+}
+
+void OutputCapture::reset() {
+    if (memfd_ >= 0) close(memfd_);
+    if (pipe_rd_ >= 0) close(pipe_rd_);
+    if (pipe_wr_ >= 0) close(pipe_wr_);
+    memfd_ = pipe_rd_ = pipe_wr_ = -1;
+    size_ = head_ = 0;
+    wrapped_ = truncated_ = false;
+}
+
+bool OutputCapture::open(const CaptureOptions& opts) {
+    reset();
+    opts_ = opts;
+    memfd_ = memfd_create("native_node_output", MFD_CLOEXEC);
+    if (memfd_ < 0) {
+        std::cerr << "[sandbox/capture] memfd_create failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (opts_.mode == CaptureMode::Handoff) return true;
+
+    int p[2];
+    if (pipe2(p, O_CLOEXEC) != 0) {
+        std::cerr << "[sandbox/capture] pipe2 failed: " << strerror(errno) << std::endl;
+        reset();
+        return false;
+    }
+    pipe_rd_ = p[0];
+    pipe_wr_ = p[1];
+    // Only the parent's end is non-blocking; the child sees an ordinary pipe
+    fcntl(pipe_rd_, F_SETFL, fcntl(pipe_rd_, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+int OutputCapture::child_fd() const {
+    return opts_.mode == CaptureMode::Handoff ? memfd_ : pipe_wr_;
+}
+
+void OutputCapture::close_child_end() {
+    if (pipe_wr_ >= 0) {
+        close(pipe_wr_);
+        pipe_wr_ = -1;
+    }
+}
+
+int OutputCapture::read_fd() const { return pipe_rd_; }
+
+bool OutputCapture::drain() {
+    if (pipe_rd_ < 0) return false;
+    char buf[65536];
+    for (;;) {
+        ssize_t n = read(pipe_rd_, buf, sizeof(buf));
+        if (n > 0) {
+            append(buf, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        // EOF or hard error: nothing more will arrive
+        close(pipe_rd_);
+        pipe_rd_ = -1;
+        return false;
+    }
+}
+
+void OutputCapture::append(const char* data, size_t len) {
+    const size_t limit = opts_.limit;
+    if (opts_.mode == CaptureMode::Capped) {
+        size_t room = size_ < limit ? limit - size_ : 0;
+        size_t take = len < room ? len : room;
+        if (take > 0 && pwrite_all(memfd_, data, take, static_cast<off_t>(size_))) size_ += take;
+        if (take < len) truncated_ = true;
+        return;
+    }
+
+    // Tail mode: the memfd is a ring of `limit` bytes starting at head_
+    if (limit == 0) {
+        if (len > 0) truncated_ = true;
+        return;
+    }
+    if (len >= limit) {
+        if (len > limit || size_ > 0) truncated_ = true;
+        data += len - limit;
+        len = limit;
+    }
+    size_t first = limit - head_;
+    if (first > len) first = len;
+    pwrite_all(memfd_, data, first, static_cast<off_t>(head_));
+    if (len > first) pwrite_all(memfd_, data + first, len - first, 0);
+    if (size_ + len > limit) truncated_ = true;
+    size_ = (size_ + len > limit) ? limit : size_ + len;
+    head_ = (head_ + len) % limit;
+    if (size_ == limit) wrapped_ = true;
+}
+
+void OutputCapture::finish() {
+    // A single non-blocking pass: a grandchild that still holds the pipe open
+    // must not stall the caller.
+    drain();
+    if (pipe_rd_ >= 0) {
+        close(pipe_rd_);
+        pipe_rd_ = -1;
+    }
+
+    if (opts_.mode == CaptureMode::Handoff) {
+        struct stat st;
+        if (memfd_ >= 0 && fstat(memfd_, &st) == 0) size_ = static_cast<size_t>(st.st_size);
+        return;
+    }
+
+    if (opts_.mode == CaptureMode::Tail && wrapped_ && head_ != 0) {
+        // Rotate so the oldest retained byte sits at offset 0
+        std::string ring(size_, '\0');
+        if (pread_all(memfd_, ring.data(), size_, 0)) {
+            pwrite_all(memfd_, ring.data() + head_, size_ - head_, 0);
+            pwrite_all(memfd_, ring.data(), head_, static_cast<off_t>(size_ - head_));
+        }
+        head_ = 0;
+    }
+    if (memfd_ >= 0 && ftruncate(memfd_, static_cast<off_t>(size_)) != 0) {
+        std::cerr << "[sandbox/capture] ftruncate failed: " << strerror(errno) << std::endl;
+    }
+}
+
+size_t OutputCapture::size() const { return size_; }
+
+bool OutputCapture::truncated() const { return truncated_; }
+
+CaptureMode OutputCapture::mode() const { return opts_.mode; }
+
+int OutputCapture::fd() const { return memfd_; }
+
+std::string OutputCapture::str() const {
+    std::string out(size_, '\0');
+    if (memfd_ < 0 || size_ == 0) return std::string();
+    if (!pread_all(memfd_, out.data(), size_, 0)) return std::string();
+    return out;
+}
+
+} // namespace sandbox
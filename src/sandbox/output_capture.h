@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <sys/types.h>
+
+namespace sandbox {
+
+enum class CaptureMode {
+    Capped,  // keep the first `limit` bytes, discard the rest
+    Tail,    // keep the last `limit` bytes (ring buffer)
+    Handoff, // child writes straight into the memfd; no copy and no byte cap
+};
+
+struct CaptureOptions {
+    CaptureMode mode = CaptureMode::Capped;
+    size_t limit = 1 << 20; // bytes retained in Capped/Tail mode
+};
+
+// memfd-backed capture of a child's stdout/stderr.
+// Capped and Tail modes hand the child a pipe and drain it into the memfd, so
+// retained output never exceeds `limit`. Handoff mode gives the child the memfd
+// itself; its pages are charged to the child's memory cgroup, and the fd can be
+// passed to sendfile() without copying the output through user space.
+class OutputCapture {
+public:
+    OutputCapture() = default;
+    ~OutputCapture();
+
+    // Non-copyable
+    OutputCapture(const OutputCapture&) = delete;
+    OutputCapture& operator=(const OutputCapture&) = delete;
+
+    // Moveable
+    OutputCapture(OutputCapture&&) noexcept;
+    OutputCapture& operator=(OutputCapture&&) noexcept;
+
+    // Create the memfd (and pipe, unless in Handoff mode). Returns true on success.
+    bool open(const CaptureOptions& opts);
+
+    // fd the child should dup2() onto stdout/stderr
+    int child_fd() const;
+    // Parent side: close the pipe write end once the child has been forked
+    void close_child_end();
+
+    // Pipe read end to poll for POLLIN, or -1 in Handoff mode
+    int read_fd() const;
+    // Read whatever is available without blocking; returns false once EOF is seen
+    bool drain();
+    // Drain remaining buffered output and lay the ring out linearly.
+    // Call after the child has been reaped.
+    void finish();
+
+    // Bytes retained in the memfd
+    size_t size() const;
+    // True if output was discarded because of the byte cap
+    bool truncated() const;
+    CaptureMode mode() const;
+
+    // memfd holding the retained output (offset 0 .. size())
+    int fd() const;
+    // Copy the retained output into a string
+    std::string str() const;
+
+private:
+    void append(const char* data, size_t len);
+    void reset();
+
+    CaptureOptions opts_;
+    int memfd_ = -1;
+    int pipe_rd_ = -1;
+    int pipe_wr_ = -1;
+    size_t size_ = 0;
+    size_t head_ = 0; // next write offset in Tail mode
+    bool wrapped_ = false;
+    bool truncated_ = false;
+};
+
+} // namespace sandbox
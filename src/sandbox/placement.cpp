@@ -0,0 +1,254 @@
+#include "placement.h"
+#include "cgroups.h"
+#include "common/key_value_config.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <set>
+#include <thread>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+namespace sandbox {
+
+static const std::string CPU_SYSFS = "/sys/devices/system/cpu";
+static const std::string NODE_SYSFS = "/sys/devices/system/node";
+static const char* PLACEMENT_CONF = "config/placement.conf";
+
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> ids;
+    std::istringstream ss(list);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        size_t dash = part.find('-');
+        try {
+            int lo = std::stoi(part.substr(0, dash));
+            int hi = dash == std::string::npos ? lo : std::stoi(part.substr(dash + 1));
+            for (int i = lo; i <= hi; ++i) ids.push_back(i);
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+    return ids;
+}
+
+std::string format_cpu_list(std::vector<int> ids) {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    std::string out;
+    for (size_t i = 0; i < ids.size();) {
+        size_t j = i;
+        while (j + 1 < ids.size() && ids[j + 1] == ids[j] + 1) ++j;
+        if (!out.empty()) out += ',';
+        out += std::to_string(ids[i]);
+        if (j > i) {
+            out += '-';
+            out += std::to_string(ids[j]);
+        }
+        i = j + 1;
+    }
+    return out;
+}
+
+CpuTopology CpuTopology::detect() {
+    CpuTopology topo;
+    std::vector<int> online = parse_cpu_list(read_cgroup_file(CPU_SYSFS + "/online"));
+    if (online.empty()) {
+        for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); ++i) online.push_back(static_cast<int>(i));
+    }
+
+    std::map<int, int> node_of;
+    if (DIR* d = opendir(NODE_SYSFS.c_str())) {
+        while (struct dirent* e = readdir(d)) {
+            std::string name = e->d_name;
+            if (name.rfind("node", 0) != 0 || name.size() == 4) continue;
+            int node = std::atoi(name.c_str() + 4);
+            for (int cpu : parse_cpu_list(read_cgroup_file(NODE_SYSFS + "/" + name + "/cpulist"))) node_of[cpu] = node;
+        }
+        closedir(d);
+    }
+
+    for (int id : online) {
+        Cpu cpu;
+        cpu.id = id;
+        // Identify the physical core by its lowest SMT sibling
+        auto siblings = parse_cpu_list(read_cgroup_file(CPU_SYSFS + "/cpu" + std::to_string(id) + "/topology/thread_siblings_list"));
+        cpu.core = siblings.empty() ? id : *std::min_element(siblings.begin(), siblings.end());
+        auto it = node_of.find(id);
+        cpu.node = it == node_of.end() ? 0 : it->second;
+        topo.cpus.push_back(cpu);
+    }
+    return topo;
+}
+
+CpuLease::~CpuLease() {
+    release();
+}
+
+CpuLease::CpuLease(CpuLease&& o) noexcept
+    : placer_(o.placer_), cpus_(std::move(o.cpus_)), nodes_(std::move(o.nodes_)) {
+    o.placer_ = nullptr;
+    o.cpus_.clear();
+}
+
+CpuLease& CpuLease::operator=(CpuLease&& o) noexcept {
+    if (this != &o) {
+        release();
+        placer_ = o.placer_;
+        cpus_ = std::move(o.cpus_);
+        nodes_ = std::move(o.nodes_);
+        o.placer_ = nullptr;
+        o.cpus_.clear();
+    }
+    return *this;
+}
+
+void CpuLease::apply_to(CgroupLimits& limits) const {
+    if (!valid()) return;
+    limits.cpuset_cpus = format_cpu_list(cpus_);
+    limits.cpuset_mems = format_cpu_list(nodes_);
+}
+
+void CpuLease::release() {
+    if (placer_ && !cpus_.empty()) placer_->release(cpus_);
+    placer_ = nullptr;
+    cpus_.clear();
+    nodes_.clear();
+}
+
+CpuPlacer::CpuPlacer(CpuTopology topo, size_t reactor_cpus) : topo_(std::move(topo)) {
+    std::sort(topo_.cpus.begin(), topo_.cpus.end(),
+              [](const CpuTopology::Cpu& a, const CpuTopology::Cpu& b) { return a.id < b.id; });
+
+    // Reserve whole cores, in CPU order, until enough reactor CPUs are covered
+    std::set<int> reserved_cores;
+    size_t reserved = 0;
+    for (const auto& cpu : topo_.cpus) {
+        if (reserved >= reactor_cpus) break;
+        if (reserved_cores.insert(cpu.core).second) {
+            for (const auto& sib : topo_.cpus) {
+                if (sib.core == cpu.core) ++reserved;
+            }
+        }
+    }
+    for (const auto& cpu : topo_.cpus) {
+        (reserved_cores.count(cpu.core) ? reactor_ : workers_).push_back(cpu.id);
+    }
+    // Too few CPUs to split: scripts and the reactor share everything
+    if (workers_.empty()) {
+        workers_ = reactor_;
+        reactor_.clear();
+    }
+    for (int cpu : workers_) load_[cpu] = 0;
+}
+
+CpuLease CpuPlacer::acquire(size_t count) {
+    CpuLease lease;
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (workers_.empty()) return lease;
+    count = std::clamp<size_t>(count, 1, workers_.size());
+
+    // Per-node and per-core load over worker CPUs
+    std::map<int, std::pair<size_t, size_t>> node_load; // node -> (load, workers)
+    std::map<int, size_t> core_load;
+    std::map<int, const CpuTopology::Cpu*> info;
+    for (const auto& cpu : topo_.cpus) {
+        auto it = load_.find(cpu.id);
+        if (it == load_.end()) continue;
+        info[cpu.id] = &cpu;
+        node_load[cpu.node].first += it->second;
+        node_load[cpu.node].second += 1;
+        core_load[cpu.core] += it->second;
+    }
+
+    // Least loaded node first (by load per CPU, then by size)
+    std::vector<int> nodes;
+    for (const auto& kv : node_load) nodes.push_back(kv.first);
+    std::stable_sort(nodes.begin(), nodes.end(), [&](int a, int b) {
+        const auto& la = node_load[a];
+        const auto& lb = node_load[b];
+        if (la.first * lb.second != lb.first * la.second) return la.first * lb.second < lb.first * la.second;
+        return la.second > lb.second;
+    });
+
+    // Within a node, prefer idle CPUs on idle cores
+    for (int node : nodes) {
+        std::vector<int> candidates;
+        for (int cpu : workers_) {
+            if (info[cpu]->node == node) candidates.push_back(cpu);
+        }
+        std::stable_sort(candidates.begin(), candidates.end(), [&](int a, int b) {
+            if (load_[a] != load_[b]) return load_[a] < load_[b];
+            return core_load[info[a]->core] < core_load[info[b]->core];
+        });
+        for (int cpu : candidates) {
+            if (lease.cpus_.size() == count) break;
+            lease.cpus_.push_back(cpu);
+            core_load[info[cpu]->core] += 1;
+        }
+        lease.nodes_.push_back(node);
+        if (lease.cpus_.size() == count) break;
+    }
+
+    for (int cpu : lease.cpus_) ++load_[cpu];
+    lease.placer_ = this;
+    return lease;
+}
+
+size_t CpuPlacer::load(int cpu) const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = load_.find(cpu);
+    return it == load_.end() ? 0 : it->second;
+}
+
+void CpuPlacer::release(const std::vector<int>& cpus) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (int cpu : cpus) {
+        auto it = load_.find(cpu);
+        if (it != load_.end() && it->second > 0) --it->second;
+    }
+}
+
+bool CpuPlacer::pin_to_reactor() const {
+    if (reactor_.empty()) return true;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : reactor_) CPU_SET(cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        std::cerr << "[sandbox/placement] failed to pin thread to reactor CPUs: " << strerror(rc) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_placement_config(const std::string& path, PlacementConfig& cfg) {
+    PlacementConfig parsed = cfg;
+    bool ok = common::read_key_value_config(path, "sandbox/placement", [&parsed](const std::string& key, const std::vector<std::string>& values) {
+        if (key != "reactor_cpus" || values.size() != 1) return false;
+        parsed.reactor_cpus = std::stoul(values[0]);
+        return true;
+    });
+    if (!ok) return false;
+    cfg = parsed;
+    return true;
+}
+
+PlacementConfig configured_placement() {
+    PlacementConfig cfg;
+    if (access(PLACEMENT_CONF, R_OK) == 0 && !load_placement_config(PLACEMENT_CONF, cfg)) {
+        std::cerr << "[sandbox/placement] using the default of " << cfg.reactor_cpus << " reactor CPUs" << std::endl;
+    }
+    return cfg;
+}
+
+CpuPlacer& cpu_placer() {
+    static CpuPlacer placer(CpuTopology::detect(), configured_placement().reactor_cpus);
+    return placer;
+}
+
+} // namespace sandbox
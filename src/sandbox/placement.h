@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstddef>
+#include "invocation_cgroup.h"
+
+namespace sandbox {
+
+// Parse a kernel CPU/node list ("0-3,8,10-11"); invalid entries are skipped
+std::vector<int> parse_cpu_list(const std::string& list);
+// Format ids as a kernel list, collapsing runs ("0-3,8")
+std::string format_cpu_list(std::vector<int> ids);
+
+// Online logical CPUs with their physical core and NUMA node
+struct CpuTopology {
+    struct Cpu {
+        int id = 0;
+        int core = 0; // CPUs sharing a core are SMT siblings
+        int node = 0;
+    };
+    std::vector<Cpu> cpus;
+
+    // Read /sys/devices/system/cpu and /sys/devices/system/node. Falls back to
+    // a single node when the NUMA directory is absent.
+    static CpuTopology detect();
+};
+
+class CpuPlacer;
+
+// CPUs (and their NUMA nodes) held by one invocation or batch. Releases its
+// share of the per-CPU load when destroyed.
+class CpuLease {
+public:
+    CpuLease() = default;
+    ~CpuLease();
+
+    // Non-copyable
+    CpuLease(const CpuLease&) = delete;
+    CpuLease& operator=(const CpuLease&) = delete;
+
+    // Moveable
+    CpuLease(CpuLease&&) noexcept;
+    CpuLease& operator=(CpuLease&&) noexcept;
+
+    bool valid() const { return !cpus_.empty(); }
+    const std::vector<int>& cpus() const { return cpus_; }
+    const std::vector<int>& nodes() const { return nodes_; }
+
+    // Fill cpuset_cpus/cpuset_mems of `limits` with this lease
+    void apply_to(CgroupLimits& limits) const;
+
+private:
+    friend class CpuPlacer;
+    void release();
+
+    CpuPlacer* placer_ = nullptr;
+    std::vector<int> cpus_;
+    std::vector<int> nodes_;
+};
+
+// Places invocations on CPUs away from the HTTP reactor threads.
+// The first `reactor_cpus` CPUs, rounded up to whole physical cores so
+// scripts never share an SMT sibling with the server, are reserved for the
+// reactor. Each lease picks the NUMA node with the lowest load per worker CPU,
+// then its least-loaded CPUs, and binds memory to that node. Load is the
+// number of leases currently holding a CPU.
+class CpuPlacer {
+public:
+    CpuPlacer(CpuTopology topo, size_t reactor_cpus);
+
+    // Non-copyable
+    CpuPlacer(const CpuPlacer&) = delete;
+    CpuPlacer& operator=(const CpuPlacer&) = delete;
+
+    const std::vector<int>& reactor_cpus() const { return reactor_; }
+    const std::vector<int>& worker_cpus() const { return workers_; }
+
+    // Lease `count` CPUs (at least one, at most all worker CPUs)
+    CpuLease acquire(size_t count = 1);
+
+    // Current number of leases holding `cpu`
+    size_t load(int cpu) const;
+
+    // Pin the calling thread to the reactor CPUs (no-op if none are reserved)
+    bool pin_to_reactor() const;
+
+private:
+    friend class CpuLease;
+    void release(const std::vector<int>& cpus);
+
+    CpuTopology topo_;
+    std::vector<int> reactor_;
+    std::vector<int> workers_;
+    mutable std::mutex mtx_;
+    std::map<int, size_t> load_; // worker cpu -> active leases
+};
+
+// Settings from config/placement.conf
+struct PlacementConfig {
+    size_t reactor_cpus = 2; // CPUs reserved for the HTTP reactor, before rounding up to cores
+};
+
+// Parse a placement config file into `cfg` (unchanged on error)
+bool load_placement_config(const std::string& path, PlacementConfig& cfg);
+// config/placement.conf if readable, defaults otherwise
+PlacementConfig configured_placement();
+
+// Process-wide placer over the detected topology, reserving
+// configured_placement().reactor_cpus for the reactor
+CpuPlacer& cpu_placer();
+
+} // namespace sandbox
@@ -0,0 +1,227 @@
+#include "policy.h"
+#include "ruleset.h"
+#include "seccomp.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/prctl.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+
+namespace sandbox {
+
+static const char* DEFAULT_LANDLOCK_POLICY = "config/landlock_policy.conf";
+static const char* DEFAULT_SECCOMP_WHITELIST = "config/syscalls.conf";
+static const char* SCRIPT_WORKER_LANDLOCK_POLICY = "config/script_worker.landlock.conf";
+static const char* SCRIPT_WORKER_SECCOMP_WHITELIST = "config/script_worker.syscalls.conf";
+
+static std::string existing_or_empty(const std::string& path) {
+    return access(path.c_str(), R_OK) == 0 ? path : std::string();
+}
+
+ScriptPolicyConfig default_policy_config() {
+    ScriptPolicyConfig cfg;
+    cfg.landlock_policy = existing_or_empty(DEFAULT_LANDLOCK_POLICY);
+    cfg.seccomp_whitelist = existing_or_empty(DEFAULT_SECCOMP_WHITELIST);
+    return cfg;
+}
+
+ScriptPolicyConfig script_worker_policy_config() {
+    ScriptPolicyConfig cfg;
+    cfg.landlock_policy = existing_or_empty(SCRIPT_WORKER_LANDLOCK_POLICY);
+    cfg.seccomp_whitelist = existing_or_empty(SCRIPT_WORKER_SECCOMP_WHITELIST);
+    return cfg;
+}
+
+ScriptPolicyConfig policy_config_for_script(const std::string& scripts_dir, const std::string& script_name) {
+    ScriptPolicyConfig cfg = default_policy_config();
+    std::string base = scripts_dir + "/" + script_name;
+    std::string ll = existing_or_empty(base + ".landlock.conf");
+    std::string sc = existing_or_empty(base + ".syscalls.conf");
+    if (!ll.empty()) cfg.landlock_policy = ll;
+    if (!sc.empty()) cfg.seccomp_whitelist = sc;
+    return cfg;
+}
+
+std::shared_ptr<const CompiledPolicy> CompiledPolicy::compile(const ScriptPolicyConfig& cfg) {
+    auto policy = std::make_shared<CompiledPolicy>();
+
+    if (!cfg.landlock_policy.empty()) {
+        RulesetBuilder rb;
+        if (!rb.load_policy(cfg.landlock_policy) || !rb.create_ruleset()) {
+            std::cerr << "[sandbox/policy] failed to build Landlock ruleset from " << cfg.landlock_policy << std::endl;
+            return nullptr;
+        }
+        policy->ruleset_fd_ = rb.release_fd();
+    }
+
+    if (!cfg.seccomp_whitelist.empty()) {
+        std::vector<std::string> syscalls;
+        if (!read_seccomp_whitelist(cfg.seccomp_whitelist, syscalls)) return nullptr;
+        // The executor's own execv() runs after the filter is installed
+        if (std::find(syscalls.begin(), syscalls.end(), "execve") == syscalls.end()) syscalls.push_back("execve");
+        if (!compile_seccomp_program(syscalls, policy->seccomp_)) {
+            std::cerr << "[sandbox/policy] failed to compile seccomp filter from " << cfg.seccomp_whitelist << std::endl;
+            return nullptr;
+        }
+    }
+
+    return policy;
+}
+
+CompiledPolicy::~CompiledPolicy() {
+    if (ruleset_fd_ >= 0) close(ruleset_fd_);
+}
+
+bool CompiledPolicy::apply_in_child() const {
+    // Both Landlock and unprivileged seccomp require no_new_privs
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) return false;
+    if (ruleset_fd_ >= 0 && !RulesetBuilder::restrict_self(ruleset_fd_)) return false;
+    if (!seccomp_.empty() && !install_seccomp_program(seccomp_)) return false;
+    return true;
+}
+
+static std::string cache_key(const ScriptPolicyConfig& cfg) {
+    return cfg.landlock_policy + "\n" + cfg.seccomp_whitelist;
+}
+
+PolicyCache::~PolicyCache() {
+    stop_watching();
+}
+
+std::shared_ptr<const CompiledPolicy> PolicyCache::get(const ScriptPolicyConfig& cfg) {
+    std::string key = cache_key(cfg);
+    auto snap = snapshot_.load(std::memory_order_acquire);
+    auto it = snap->find(key);
+    if (it != snap->end()) return it->second.policy;
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    snap = snapshot_.load(std::memory_order_acquire);
+    it = snap->find(key);
+    if (it != snap->end()) return it->second.policy;
+
+    auto policy = CompiledPolicy::compile(cfg);
+    if (!policy) return nullptr;
+    auto next = std::make_shared<Map>(*snap);
+    (*next)[key] = Entry{ cfg, policy };
+    snapshot_.store(std::move(next), std::memory_order_release);
+    if (inotify_fd_ >= 0) {
+        watch_file_dir(cfg.landlock_policy);
+        watch_file_dir(cfg.seccomp_whitelist);
+    }
+    return policy;
+}
+
+void PolicyCache::clear() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    snapshot_.store(std::make_shared<const Map>(), std::memory_order_release);
+}
+
+size_t PolicyCache::reload(const std::string& path) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto snap = snapshot_.load(std::memory_order_acquire);
+    std::shared_ptr<Map> next;
+    size_t replaced = 0;
+    for (const auto& kv : *snap) {
+        const Entry& e = kv.second;
+        if (e.cfg.landlock_policy != path && e.cfg.seccomp_whitelist != path) continue;
+        auto policy = CompiledPolicy::compile(e.cfg);
+        if (!policy) {
+            std::cerr << "[sandbox/policy] keeping previous policy; " << path << " failed to compile" << std::endl;
+            continue;
+        }
+        if (!next) next = std::make_shared<Map>(*snap);
+        (*next)[kv.first].policy = policy;
+        ++replaced;
+    }
+    if (next) {
+        snapshot_.store(std::move(next), std::memory_order_release);
+        std::cout << "[sandbox/policy] reloaded " << replaced << " policy(ies) after change to " << path << std::endl;
+    }
+    return replaced;
+}
+
+void PolicyCache::watch_file_dir(const std::string& file) {
+    if (file.empty()) return;
+    size_t slash = file.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : file.substr(0, slash);
+    for (const auto& kv : watched_dirs_) {
+        if (kv.second == dir) return;
+    }
+    // Watch the directory, not the file: editors replace files by rename
+    int wd = inotify_add_watch(inotify_fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+        std::cerr << "[sandbox/policy] inotify_add_watch failed for " << dir << ": " << strerror(errno) << std::endl;
+        return;
+    }
+    watched_dirs_[wd] = dir;
+}
+
+bool PolicyCache::start_watching() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (inotify_fd_ >= 0) return true;
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd_ < 0 || stop_fd_ < 0) {
+        std::cerr << "[sandbox/policy] failed to set up inotify: " << strerror(errno) << std::endl;
+        if (inotify_fd_ >= 0) close(inotify_fd_);
+        if (stop_fd_ >= 0) close(stop_fd_);
+        inotify_fd_ = stop_fd_ = -1;
+        return false;
+    }
+    for (const auto& kv : *snapshot_.load()) {
+        watch_file_dir(kv.second.cfg.landlock_policy);
+        watch_file_dir(kv.second.cfg.seccomp_whitelist);
+    }
+    watcher_ = std::thread(&PolicyCache::watch_loop, this);
+    return true;
+}
+
+void PolicyCache::stop_watching() {
+    if (!watcher_.joinable()) return;
+    uint64_t one = 1;
+    if (write(stop_fd_, &one, sizeof(one)) < 0) {
+        std::cerr << "[sandbox/policy] failed to signal watcher: " << strerror(errno) << std::endl;
+    }
+    watcher_.join();
+    std::lock_guard<std::mutex> lk(mtx_);
+    close(inotify_fd_);
+    close(stop_fd_);
+    inotify_fd_ = stop_fd_ = -1;
+    watched_dirs_.clear();
+}
+
+void PolicyCache::watch_loop() {
+    alignas(struct inotify_event) char buf[4096];
+    for (;;) {
+        struct pollfd pfds[2] = { { inotify_fd_, POLLIN, 0 }, { stop_fd_, POLLIN, 0 } };
+        if (poll(pfds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (pfds[1].revents & POLLIN) return;
+
+        ssize_t n = read(inotify_fd_, buf, sizeof(buf));
+        if (n <= 0) continue;
+        std::vector<std::string> changed;
+        for (char* p = buf; p < buf + n;) {
+            auto* ev = reinterpret_cast<struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->len == 0) continue;
+            std::lock_guard<std::mutex> lk(mtx_);
+            auto it = watched_dirs_.find(ev->wd);
+            if (it != watched_dirs_.end()) changed.push_back(it->second + "/" + ev->name);
+        }
+        for (const auto& path : changed) reload(path);
+    }
+}
+
+PolicyCache& policy_cache() {
+    static PolicyCache cache;
+    return cache;
+}
+
+} // namespace sandbox
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <linux/filter.h>
+
+namespace sandbox {
+
+// Policy files for one script. Empty paths disable that layer.
+struct ScriptPolicyConfig {
+    std::string landlock_policy;   // Landlock policy file (<path> <access> lines)
+    std::string seccomp_whitelist; // seccomp whitelist (one syscall per line)
+};
+
+// Resolve the policy files for a script: <scripts_dir>/<name>.landlock.conf and
+// <scripts_dir>/<name>.syscalls.conf override config/landlock_policy.conf and
+// config/syscalls.conf. Files that do not exist are left empty.
+ScriptPolicyConfig policy_config_for_script(const std::string& scripts_dir, const std::string& script_name);
+
+// Default process-level config (config/landlock_policy.conf, config/syscalls.conf)
+ScriptPolicyConfig default_policy_config();
+
+// In-process script workers: config/script_worker.landlock.conf (compiled
+// objects read-only, no access to script sources) and
+// config/script_worker.syscalls.conf
+ScriptPolicyConfig script_worker_policy_config();
+
+// A Landlock ruleset fd and a seccomp BPF program built once from a
+// ScriptPolicyConfig. Applying it costs one landlock_restrict_self() and one
+// prctl(PR_SET_SECCOMP); nothing is parsed or allocated in the child.
+class CompiledPolicy {
+public:
+    // Returns nullptr if a configured layer cannot be built
+    static std::shared_ptr<const CompiledPolicy> compile(const ScriptPolicyConfig& cfg);
+
+    CompiledPolicy() = default;
+    ~CompiledPolicy();
+
+    // Non-copyable
+    CompiledPolicy(const CompiledPolicy&) = delete;
+    CompiledPolicy& operator=(const CompiledPolicy&) = delete;
+
+    // Restrict the calling process. Intended for the child between fork() and execv().
+    bool apply_in_child() const;
+
+    bool has_landlock() const { return ruleset_fd_ >= 0; }
+    // Descriptor apply_in_child() needs (-1 if none); keep it open until then
+    int ruleset_fd() const { return ruleset_fd_; }
+    bool has_seccomp() const { return !seccomp_.empty(); }
+
+private:
+    int ruleset_fd_ = -1;
+    std::vector<sock_filter> seccomp_;
+};
+
+// Process-wide cache of compiled policies keyed by their config paths.
+// Lookups are a single atomic snapshot load. With watching enabled, policy
+// files are monitored via inotify; an edited file is recompiled once and the
+// new policy is swapped in, so later invocations use it without a restart.
+class PolicyCache {
+public:
+    PolicyCache() = default;
+    ~PolicyCache();
+
+    // Compile on first use; later calls return the cached policy
+    std::shared_ptr<const CompiledPolicy> get(const ScriptPolicyConfig& cfg);
+    // Drop all cached policies (in-flight holders keep theirs alive)
+    void clear();
+
+    // Recompile every cached policy that uses `path` and publish the result.
+    // A policy that fails to compile keeps its previous version. Returns the
+    // number of policies replaced.
+    size_t reload(const std::string& path);
+
+    // Start/stop the inotify watcher thread
+    bool start_watching();
+    void stop_watching();
+
+private:
+    struct Entry {
+        ScriptPolicyConfig cfg;
+        std::shared_ptr<const CompiledPolicy> policy;
+    };
+    using Map = std::unordered_map<std::string, Entry>;
+
+    void watch_file_dir(const std::string& file); // requires mtx_
+    void watch_loop();
+
+    std::atomic<std::shared_ptr<const Map>> snapshot_{ std::make_shared<const Map>() };
+    std::mutex mtx_; // serializes compilation and publication
+    int inotify_fd_ = -1;
+    int stop_fd_ = -1;
+    std::unordered_map<int, std::string> watched_dirs_; // inotify wd -> directory
+    std::thread watcher_;
+};
+
+PolicyCache& policy_cache();
+
+} // namespace sandbox
@@ -0,0 +1,171 @@
+#include "pressure.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+
+namespace sandbox {
+
+static const std::string CGROUP_ROOT = "/sys/fs/cgroup";
+
+bool parse_pressure(const std::string& text, PressureStats& stats) {
+    std::istringstream lines(text);
+    std::string line;
+    bool any = false;
+    while (std::getline(lines, line)) {
+        std::istringstream ss(line);
+        std::string kind, field;
+        ss >> kind;
+        PressureStats::Line* out = kind == "some" ? &stats.some : kind == "full" ? &stats.full : nullptr;
+        if (!out) continue;
+        while (ss >> field) {
+            size_t eq = field.find('=');
+            if (eq == std::string::npos) continue;
+            std::string key = field.substr(0, eq);
+            const char* value = field.c_str() + eq + 1;
+            if (key == "avg10") out->avg10 = std::strtod(value, nullptr);
+            else if (key == "avg60") out->avg60 = std::strtod(value, nullptr);
+            else if (key == "avg300") out->avg300 = std::strtod(value, nullptr);
+            else if (key == "total") out->total = std::strtoull(value, nullptr, 10);
+        }
+        any = true;
+    }
+    return any;
+}
+
+bool read_pressure(const std::string& path, PressureStats& stats) {
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) return false;
+    std::ostringstream ss;
+    ss << ifs.rdbuf();
+    return parse_pressure(ss.str(), stats);
+}
+
+PressureFiles cgroup_pressure_files(const std::string& cgroup_path) {
+    return { cgroup_path + "/cpu.pressure", cgroup_path + "/memory.pressure", cgroup_path + "/io.pressure" };
+}
+
+PressureFiles invocation_parent_pressure_files() {
+    struct stat st;
+    if (stat((CGROUP_ROOT + "/cpu.pressure").c_str(), &st) == 0) return cgroup_pressure_files(CGROUP_ROOT);
+    return { "/proc/pressure/cpu", "/proc/pressure/memory", "/proc/pressure/io" };
+}
+
+double PressureSample::peak() const {
+    return std::max({ cpu.some.avg10, memory.some.avg10, io.some.avg10 });
+}
+
+PressureMonitor::~PressureMonitor() {
+    stop();
+}
+
+bool PressureMonitor::start(const PressureFiles& files, const Options& opts, Callback cb) {
+    if (thread_.joinable()) return true;
+    files_ = files;
+    opts_ = opts;
+    cb_ = std::move(cb);
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd_ < 0) {
+        std::cerr << "[sandbox/pressure] eventfd failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // A trigger lives as long as its fd stays open; the NUL is part of the write
+    std::string trigger = "some " + std::to_string(opts.trigger_stall_us) + " " + std::to_string(opts.trigger_window_us);
+    for (const auto* path : { &files.cpu, &files.memory, &files.io }) {
+        int fd = open(path->c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) continue;
+        if (write(fd, trigger.c_str(), trigger.size() + 1) < 0) {
+            std::cerr << "[sandbox/pressure] PSI trigger unavailable for " << *path << ": " << strerror(errno)
+                      << "; sampling only" << std::endl;
+            close(fd);
+            continue;
+        }
+        trigger_fds_.push_back(fd);
+    }
+
+    thread_ = std::thread(&PressureMonitor::loop, this);
+    return true;
+}
+
+void PressureMonitor::stop() {
+    if (thread_.joinable()) {
+        uint64_t one = 1;
+        if (write(stop_fd_, &one, sizeof(one)) < 0) {
+            std::cerr << "[sandbox/pressure] failed to signal monitor: " << strerror(errno) << std::endl;
+        }
+        thread_.join();
+    }
+    for (int fd : trigger_fds_) close(fd);
+    trigger_fds_.clear();
+    if (stop_fd_ >= 0) close(stop_fd_);
+    stop_fd_ = -1;
+}
+
+void PressureMonitor::loop() {
+    std::vector<struct pollfd> pfds;
+    pfds.push_back({ stop_fd_, POLLIN, 0 });
+    for (int fd : trigger_fds_) pfds.push_back({ fd, POLLPRI, 0 });
+
+    auto next = std::chrono::steady_clock::now() + opts_.interval;
+    bool triggered = false;
+    for (;;) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(next - std::chrono::steady_clock::now()).count();
+        int rc = poll(pfds.data(), pfds.size(), static_cast<int>(std::max<long long>(left, 0)));
+        if (rc < 0 && errno != EINTR) {
+            std::cerr << "[sandbox/pressure] poll failed: " << strerror(errno) << std::endl;
+            return;
+        }
+        if (pfds[0].revents & POLLIN) return;
+        for (size_t i = 1; i < pfds.size(); ++i) {
+            if (pfds[i].revents & POLLERR) {
+                std::cerr << "[sandbox/pressure] PSI trigger source went away" << std::endl;
+                return;
+            }
+            if (pfds[i].revents & POLLPRI) triggered = true;
+        }
+
+        // Sample on every trigger (fast path) and on every interval tick
+        if (!triggered && std::chrono::steady_clock::now() < next) continue;
+        PressureSample sample;
+        read_pressure(files_.cpu, sample.cpu);
+        read_pressure(files_.memory, sample.memory);
+        read_pressure(files_.io, sample.io);
+        sample.triggered = triggered;
+        triggered = false;
+        cb_(sample);
+        next = std::chrono::steady_clock::now() + opts_.interval;
+    }
+}
+
+AimdLimiter::AimdLimiter(const Options& opts) : opts_(opts) {
+    opts_.min_limit = std::max<size_t>(opts_.min_limit, 1);
+    opts_.max_limit = std::max(opts_.max_limit, opts_.min_limit);
+    limit_ = std::clamp(opts_.initial, opts_.min_limit, opts_.max_limit);
+}
+
+size_t AimdLimiter::update(const PressureSample& sample, bool saturated, std::chrono::steady_clock::time_point now) {
+    double p = sample.peak();
+    if (sample.triggered || p > opts_.high) {
+        if (last_decrease_ == std::chrono::steady_clock::time_point{} || now - last_decrease_ >= opts_.hold) {
+            size_t next = static_cast<size_t>(std::floor(static_cast<double>(limit_) * opts_.decrease));
+            if (next >= limit_) next = limit_ - 1; // always back off by at least one
+            limit_ = std::max(opts_.min_limit, next);
+            last_decrease_ = now;
+        }
+    } else if (p < opts_.low && saturated && limit_ < opts_.max_limit) {
+        ++limit_;
+    }
+    return limit_;
+}
+
+} // namespace sandbox
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace sandbox {
+
+// One PSI resource file (cpu.pressure, memory.pressure, io.pressure or /proc/pressure/*)
+struct PressureStats {
+    struct Line {
+        double avg10 = 0, avg60 = 0, avg300 = 0; // percent of wall time stalled
+        uint64_t total = 0;                      // cumulative stall time (us)
+    };
+    Line some; // at least one task stalled
+    Line full; // all non-idle tasks stalled (always zero for cpu at the root)
+};
+
+// Parse the "some ..."/"full ..." lines of a PSI file
+bool parse_pressure(const std::string& text, PressureStats& stats);
+bool read_pressure(const std::string& path, PressureStats& stats);
+
+struct PressureFiles {
+    std::string cpu, memory, io;
+};
+
+// PSI files of a cgroup directory (<dir>/cpu.pressure, ...)
+PressureFiles cgroup_pressure_files(const std::string& cgroup_path);
+
+// PSI files covering the parent of all invocation cgroups: the cgroup root's
+// files if present, otherwise the system-wide /proc/pressure/*
+PressureFiles invocation_parent_pressure_files();
+
+struct PressureSample {
+    PressureStats cpu, memory, io;
+    bool triggered = false; // a PSI trigger fired since the previous sample
+
+    // Highest "some" avg10 across the three resources
+    double peak() const;
+};
+
+// Samples PSI files on a fixed interval and, where the kernel allows it,
+// registers PSI triggers ("some <stall_us> <window_us>") so that a stall
+// burst wakes the monitor immediately via POLLPRI instead of waiting for the
+// next interval. Each sample is handed to the callback on the monitor thread.
+class PressureMonitor {
+public:
+    using Callback = std::function<void(const PressureSample&)>;
+
+    struct Options {
+        std::chrono::milliseconds interval{ 1000 };
+        uint64_t trigger_stall_us = 200000;   // 200ms of stall ...
+        uint64_t trigger_window_us = 2000000; // ... within 2s (unprivileged: multiple of 2s)
+    };
+
+    PressureMonitor() = default;
+    ~PressureMonitor();
+
+    // Non-copyable
+    PressureMonitor(const PressureMonitor&) = delete;
+    PressureMonitor& operator=(const PressureMonitor&) = delete;
+
+    bool start(const PressureFiles& files, const Options& opts, Callback cb);
+    void stop();
+
+    bool has_triggers() const { return !trigger_fds_.empty(); }
+
+private:
+    void loop();
+
+    PressureFiles files_;
+    Options opts_;
+    Callback cb_;
+    std::vector<int> trigger_fds_;
+    int stop_fd_ = -1;
+    std::thread thread_;
+};
+
+// AIMD concurrency controller: each sample either grows the limit by one
+// (pressure below `low` while all slots are in use) or shrinks it
+// multiplicatively (pressure above `high`, or a PSI trigger fired), within
+// [min_limit, max_limit]. Decreases are spaced by at least one hold period so
+// the controller reacts to a stall once, not once per sample of its decay.
+class AimdLimiter {
+public:
+    struct Options {
+        size_t min_limit = 1;
+        size_t max_limit = 64;
+        size_t initial = 4;
+        double low = 10.0;  // percent stalled (avg10)
+        double high = 40.0; // percent stalled (avg10)
+        double decrease = 0.75;
+        std::chrono::milliseconds hold{ 5000 };
+    };
+
+    explicit AimdLimiter(const Options& opts);
+
+    // Feed one sample; `saturated` means every slot was busy with work queued.
+    // Returns the new limit.
+    size_t update(const PressureSample& sample, bool saturated,
+                  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    size_t limit() const { return limit_; }
+
+private:
+    Options opts_;
+    size_t limit_;
+    std::chrono::steady_clock::time_point last_decrease_{};
+};
+
+} // namespace sandbox
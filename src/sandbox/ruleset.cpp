@@ -9,6 +9,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/syscall.h>
+#include <sys/stat.h>
 #include <errno.h>
 #if !defined(SYS_landlock_create_ruleset)
 // SYS_landlock_create_ruleset may not be defined on older headers; define if missing
@@ -26,32 +27,65 @@
 #include <errno.h>
 #endif
 
-// If Landlock headers are not available at compile time, define minimal constants so
-// the code can still compile. Functional behavior will be disabled at runtime if
-// Landlock is not actually available.
-#if !defined(HAVE_LANDLOCK)
-#ifndef LANDLOCK_ACCESS_FS_READ_FILE
-#define LANDLOCK_ACCESS_FS_READ_FILE 0
-#endif
-#ifndef LANDLOCK_ACCESS_FS_WRITE_FILE
-#define LANDLOCK_ACCESS_FS_WRITE_FILE 0
-#endif
-#ifndef LANDLOCK_ACCESS_FS_EXECUTE
-#define LANDLOCK_ACCESS_FS_EXECUTE 0
-#endif
-#ifndef LANDLOCK_ACCESS_FS_READ_DIR
-#define LANDLOCK_ACCESS_FS_READ_DIR 0
-#endif
-#ifndef LANDLOCK_ACCESS_FS_REMOVE_FILE
-#define LANDLOCK_ACCESS_FS_REMOVE_FILE 0
-#endif
-#ifndef LANDLOCK_RULE_PATH_BENEATH
-#define LANDLOCK_RULE_PATH_BENEATH 0
-#endif
+#if defined(HAVE_LANDLOCK) && !defined(LANDLOCK_CREATE_RULESET_VERSION)
+#define LANDLOCK_CREATE_RULESET_VERSION (1U << 0)
 #endif
 
 namespace sandbox {
 
+int landlock_abi_version() {
+#if defined(HAVE_LANDLOCK)
+    long abi = syscall(SYS_landlock_create_ruleset, nullptr, 0, LANDLOCK_CREATE_RULESET_VERSION);
+    return abi < 0 ? 0 : static_cast<int>(abi);
+#else
+    return 0;
+#endif
+}
+
+uint64_t landlock_supported_access(int abi) {
+    using namespace landlock_access;
+    if (abi < 1) return 0;
+    uint64_t access = EXECUTE | WRITE_FILE | READ_FILE | READ_DIR | REMOVE_DIR | REMOVE_FILE |
+                      MAKE_CHAR | MAKE_DIR | MAKE_REG | MAKE_SOCK | MAKE_FIFO | MAKE_BLOCK | MAKE_SYM;
+    if (abi >= 2) access |= REFER;
+    if (abi >= 3) access |= TRUNCATE;
+    if (abi >= 5) access |= IOCTL_DEV;
+    return access;
+}
+
+bool parse_landlock_access(const std::string& spec, uint64_t& access) {
+    using namespace landlock_access;
+    static const struct { const char* name; uint64_t bits; } names[] = {
+        { "ro", READ_ONLY }, { "rw", READ_WRITE },
+        { "rx", READ_ONLY | EXECUTE }, { "rwx", READ_WRITE | EXECUTE },
+        { "execute", EXECUTE }, { "write_file", WRITE_FILE }, { "read_file", READ_FILE },
+        { "read_dir", READ_DIR }, { "remove_dir", REMOVE_DIR }, { "remove_file", REMOVE_FILE },
+        { "make_char", MAKE_CHAR }, { "make_dir", MAKE_DIR }, { "make_reg", MAKE_REG },
+        { "make_sock", MAKE_SOCK }, { "make_fifo", MAKE_FIFO }, { "make_block", MAKE_BLOCK },
+        { "make_sym", MAKE_SYM }, { "refer", REFER }, { "truncate", TRUNCATE },
+        { "ioctl_dev", IOCTL_DEV },
+    };
+
+    access = 0;
+    size_t pos = 0;
+    while (pos <= spec.size()) {
+        size_t comma = spec.find(',', pos);
+        std::string tok = spec.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        bool found = false;
+        for (const auto& n : names) {
+            if (tok == n.name) {
+                access |= n.bits;
+                found = true;
+                break;
+            }
+        }
+        if (!found) return false;
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    return access != 0;
+}
+
 RulesetBuilder::RulesetBuilder() = default;
 
 RulesetBuilder::~RulesetBuilder() {
@@ -62,12 +96,11 @@ RulesetBuilder::~RulesetBuilder() {
 }
 
 void RulesetBuilder::add_path(const std::string& path) {
-    paths_.push_back(path);
+    rules_.push_back({ path, landlock_access::READ_ONLY });
 }
 
 void RulesetBuilder::add_path_with_access(const std::string& path, uint64_t access_flags) {
-    // Store as a serialized string: path||' '||access
-    paths_.push_back(path + " " + std::to_string(access_flags));
+    rules_.push_back({ path, access_flags });
 }
 
 bool RulesetBuilder::load_policy(const std::string& policy_file) {
@@ -79,32 +112,34 @@ bool RulesetBuilder::load_policy(const std::string& policy_file) {
     char* line = nullptr;
     size_t len = 0;
     ssize_t read;
+    bool ok = true;
     while ((read = getline(&line, &len, f)) != -1) {
-        // Trim newline
-        while (read > 0 && (line[read-1] == '\n' || line[read-1] == '\r')) {
-            line[--read] = '\0';
-        }
-        std::string s(line);
-        // Skip comments and empty lines
-        if (s.empty() || s[0] == '#') continue;
-        // Expect: <path> <ro|rw>
+        std::string s(line, static_cast<size_t>(read));
+        // Strip trailing comments and whitespace
+        size_t hash = s.find(" #");
+        if (hash != std::string::npos) s.erase(hash);
+        size_t end = s.find_last_not_of(" \t\r\n");
+        s.erase(end == std::string::npos ? 0 : end + 1);
+        size_t start = s.find_first_not_of(" \t");
+        if (start == std::string::npos || s[start] == '#') continue;
+        s.erase(0, start);
+
+        // Expect: <path> <access spec>; a bare path is read-only
         size_t sp = s.find_first_of(" \t");
         std::string path = s.substr(0, sp);
-        std::string flag = (sp == std::string::npos) ? "ro" : s.substr(sp+1);
-        // Normalize flag
-        if (flag.find("rw") != std::string::npos) {
-            uint64_t access = LANDLOCK_ACCESS_FS_READ_FILE | LANDLOCK_ACCESS_FS_WRITE_FILE |
-                LANDLOCK_ACCESS_FS_READ_DIR | LANDLOCK_ACCESS_FS_REMOVE_FILE;
-            add_path_with_access(path, access);
-        } else {
-            // default to read-only
-            uint64_t access = LANDLOCK_ACCESS_FS_READ_FILE | LANDLOCK_ACCESS_FS_READ_DIR;
-            add_path_with_access(path, access);
+        std::string spec = "ro";
+        if (sp != std::string::npos) spec = s.substr(s.find_first_not_of(" \t", sp));
+        uint64_t access = 0;
+        if (!parse_landlock_access(spec, access)) {
+            std::cerr << "[sandbox/ruleset] invalid access '" << spec << "' for " << path << " in " << policy_file << std::endl;
+            ok = false;
+            break;
         }
+        add_path_with_access(path, access);
     }
     if (line) free(line);
     fclose(f);
-    return true;
+    return ok;
 }
 
 bool RulesetBuilder::create_ruleset() {
@@ -112,19 +147,17 @@ bool RulesetBuilder::create_ruleset() {
     std::cerr << "[sandbox/ruleset] Landlock not supported on non-Linux platforms" << std::endl;
     return false;
 #endif
-    if (!is_landlock_available()) {
+    int abi = landlock_abi_version();
+    if (abi < 1) {
         std::cerr << "[sandbox/ruleset] Landlock not available on this kernel" << std::endl;
         return false;
     }
 
 #if defined(HAVE_LANDLOCK)
-    // Create a ruleset that handles common FS accesses. This is a minimal skeleton.
+    // Handle every right this kernel can enforce; rights a rule does not grant are denied
+    const uint64_t handled = landlock_supported_access(abi);
     struct landlock_ruleset_attr attr = {};
-    attr.handled_access_fs = LANDLOCK_ACCESS_FS_READ_FILE |
-                              LANDLOCK_ACCESS_FS_WRITE_FILE |
-                              LANDLOCK_ACCESS_FS_EXECUTE |
-                              LANDLOCK_ACCESS_FS_READ_DIR |
-                              LANDLOCK_ACCESS_FS_REMOVE_FILE;
+    attr.handled_access_fs = handled;
 
     // Create ruleset via syscall to avoid depending on glibc wrappers
     long fd = syscall(SYS_landlock_create_ruleset, &attr, sizeof(attr), 0);
@@ -132,48 +165,44 @@ bool RulesetBuilder::create_ruleset() {
         std::cerr << "[sandbox/ruleset] failed to create ruleset: " << strerror(errno) << std::endl;
         return false;
     }
-
+    if (ruleset_fd_ >= 0) close(ruleset_fd_);
     ruleset_fd_ = static_cast<int>(fd);
-#else
-    std::cerr << "[sandbox/ruleset] Landlock headers not available at compile time; cannot create ruleset" << std::endl;
-    return false;
-#endif
 
-#if defined(HAVE_LANDLOCK)
-    // If there are per-path entries, add them to the ruleset
-    for (const auto& entry : paths_) {
-        // entry is either "path" or "path access" where access is numeric
-        size_t sp = entry.find_first_of(' ');
-        std::string path = (sp == std::string::npos) ? entry : entry.substr(0, sp);
-        uint64_t access = 0;
-        if (sp != std::string::npos) {
-            access = static_cast<uint64_t>(std::stoull(entry.substr(sp+1)));
-        } else {
-            access = LANDLOCK_ACCESS_FS_READ_FILE | LANDLOCK_ACCESS_FS_READ_DIR;
-        }
+    for (const auto& rule : rules_) {
+        // Rights newer than the running ABI are dropped (best-effort compatibility)
+        uint64_t access = rule.access & handled;
+        if (access == 0) continue;
 
         // Open path with O_PATH to get fd
-        int path_fd = open(path.c_str(), O_PATH | O_CLOEXEC);
+        int path_fd = open(rule.path.c_str(), O_PATH | O_CLOEXEC);
         if (path_fd < 0) {
-            std::cerr << "[sandbox/ruleset] failed to open path " << path << " : " << strerror(errno) << std::endl;
+            std::cerr << "[sandbox/ruleset] failed to open path " << rule.path << " : " << strerror(errno) << std::endl;
             continue;
         }
 
+        // Directory-only rights cannot be granted on a regular file
+        struct stat st;
+        if (fstat(path_fd, &st) == 0 && !S_ISDIR(st.st_mode)) {
+            access &= landlock_access::EXECUTE | landlock_access::WRITE_FILE | landlock_access::READ_FILE |
+                      landlock_access::TRUNCATE | landlock_access::IOCTL_DEV;
+        }
+
         struct landlock_path_beneath_attr pb = {};
         pb.allowed_access = access;
         pb.parent_fd = path_fd;
 
         long r = syscall(SYS_landlock_add_rule, ruleset_fd_, LANDLOCK_RULE_PATH_BENEATH, &pb, 0);
         if (r != 0) {
-            std::cerr << "[sandbox/ruleset] failed to add rule for " << path << " : " << strerror(errno) << std::endl;
+            std::cerr << "[sandbox/ruleset] failed to add rule for " << rule.path << " : " << strerror(errno) << std::endl;
         }
 
         close(path_fd);
     }
+    return true;
 #else
-    (void)paths_; // silence unused when HAVE_LANDLOCK is not defined
+    std::cerr << "[sandbox/ruleset] Landlock headers not available at compile time; cannot create ruleset" << std::endl;
+    return false;
 #endif
-    return true;
 }
 
 bool RulesetBuilder::apply() {
@@ -202,4 +231,20 @@ bool RulesetBuilder::apply() {
     return true;
 }
 
+bool RulesetBuilder::restrict_self(int ruleset_fd) {
+#if defined(HAVE_LANDLOCK)
+    if (ruleset_fd < 0) return false;
+    return syscall(SYS_landlock_restrict_self, ruleset_fd, 0) == 0;
+#else
+    (void)ruleset_fd;
+    return false;
+#endif
+}
+
+int RulesetBuilder::release_fd() {
+    int fd = ruleset_fd_;
+    ruleset_fd_ = -1;
+    return fd;
+}
+
 } // namespace sandbox
@@ -2,35 +2,89 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 
 namespace sandbox {
 
-// Minimal Landlock RulesetBuilder skeleton.
-// This provides a small, testable API that attempts to create a Landlock ruleset
-// and apply it to the current process. Full rule addition is left for later.
+// Landlock filesystem access rights (values of LANDLOCK_ACCESS_FS_*). Defined
+// here so newer rights are usable with older kernel headers.
+namespace landlock_access {
+constexpr uint64_t EXECUTE     = 1ULL << 0;
+constexpr uint64_t WRITE_FILE  = 1ULL << 1;
+constexpr uint64_t READ_FILE   = 1ULL << 2;
+constexpr uint64_t READ_DIR    = 1ULL << 3;
+constexpr uint64_t REMOVE_DIR  = 1ULL << 4;
+constexpr uint64_t REMOVE_FILE = 1ULL << 5;
+constexpr uint64_t MAKE_CHAR   = 1ULL << 6;
+constexpr uint64_t MAKE_DIR    = 1ULL << 7;
+constexpr uint64_t MAKE_REG    = 1ULL << 8;
+constexpr uint64_t MAKE_SOCK   = 1ULL << 9;
+constexpr uint64_t MAKE_FIFO   = 1ULL << 10;
+constexpr uint64_t MAKE_BLOCK  = 1ULL << 11;
+constexpr uint64_t MAKE_SYM    = 1ULL << 12;
+constexpr uint64_t REFER       = 1ULL << 13; // ABI 2
+constexpr uint64_t TRUNCATE    = 1ULL << 14; // ABI 3
+constexpr uint64_t IOCTL_DEV   = 1ULL << 15; // ABI 5
+
+constexpr uint64_t READ_ONLY = READ_FILE | READ_DIR;
+constexpr uint64_t READ_WRITE = READ_ONLY | WRITE_FILE | REMOVE_DIR | REMOVE_FILE | MAKE_CHAR |
+                                MAKE_DIR | MAKE_REG | MAKE_SOCK | MAKE_FIFO | MAKE_BLOCK |
+                                MAKE_SYM | REFER | TRUNCATE;
+} // namespace landlock_access
+
+// Highest Landlock ABI version supported by the running kernel (0 if none)
+int landlock_abi_version();
+
+// Access rights the given ABI version can enforce
+uint64_t landlock_supported_access(int abi);
+
+// Parse an access spec: "ro", "rw", "rx", "rwx", or a comma-separated list of
+// right names (execute, write_file, read_file, read_dir, remove_dir, remove_file,
+// make_char, make_dir, make_reg, make_sock, make_fifo, make_block, make_sym,
+// refer, truncate, ioctl_dev). Returns false on an unknown name.
+bool parse_landlock_access(const std::string& spec, uint64_t& access);
+
+// A single path-beneath rule
+struct LandlockRule {
+    std::string path;
+    uint64_t access = landlock_access::READ_ONLY;
+};
+
+// Landlock RulesetBuilder.
+// Collects typed path rules, creates a ruleset fd that handles every right the
+// running kernel's ABI supports, and applies it to the current process.
 class RulesetBuilder {
 public:
     RulesetBuilder();
     ~RulesetBuilder();
 
-    // Add a path intended to be allowed (placeholder for future per-path rules)
+    // Allow read-only access beneath a path
     void add_path(const std::string& path);
-    // Add a path with explicit access flags (LANDLOCK_ACCESS_FS_* flags)
+    // Add a path with explicit access rights (landlock_access::* flags)
     void add_path_with_access(const std::string& path, uint64_t access_flags);
 
-    // Load a simple policy file (each non-empty line: <path> <ro|rw>)
-    // Returns true on successful parse (does not create/apply ruleset)
+    // Load a policy file (each non-empty line: <path> <access spec>, see
+    // parse_landlock_access). Returns true on successful parse (does not create/apply ruleset)
     bool load_policy(const std::string& policy_file);
 
+    const std::vector<LandlockRule>& rules() const { return rules_; }
+
     // Create the ruleset (returns true on success)
     bool create_ruleset();
 
     // Apply the ruleset to the current process (returns true on success)
     bool apply();
 
+    // Transfer ownership of the created ruleset fd to the caller (-1 if none)
+    int release_fd();
+
+    // Restrict the calling thread with an existing ruleset fd (one landlock_restrict_self).
+    // Does not allocate or log; safe to call in a forked child.
+    static bool restrict_self(int ruleset_fd);
+
 private:
     int ruleset_fd_ = -1;
-    std::vector<std::string> paths_;
+    std::vector<LandlockRule> rules_;
 };
 
 } // namespace sandbox
@@ -3,71 +3,57 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include "seccomp.h"
+#include "policy.h"
 #include "ruleset.h"
-#include <sys/stat.h>
 
 namespace sandbox {
 
 bool apply_default_policy() {
-    std::cout << "[sandbox] applying default Landlock/seccomp policy (requires kernel >= 5.13)" << std::endl;
+    std::cout << "[sandbox] precompiling default Landlock/seccomp policy (requires kernel >= 5.13)" << std::endl;
     if (!is_landlock_available()) {
         std::cerr << "[sandbox] Landlock not available on this kernel; aborting (Landlock required)" << std::endl;
         return false;
     }
-    // Try to load a simple policy file (config/landlock_policy.conf). If missing, create an empty ruleset.
-    sandbox::RulesetBuilder rb;
-    const char* policy_path = "config/landlock_policy.conf";
-    struct stat st;
-    if (stat(policy_path, &st) == 0) {
-        std::cout << "[sandbox] loading Landlock policy from: " << policy_path << std::endl;
-        if (!rb.load_policy(policy_path)) {
-            std::cerr << "[sandbox] failed to load Landlock policy" << std::endl;
-            return false;
-        }
-    } else {
-        std::cout << "[sandbox] no Landlock policy file found at '" << policy_path << "'; proceeding with default minimal ruleset" << std::endl;
+    // Policies are applied per invocation in the executor's child; here we only
+    // build the default one so a broken config is reported at startup.
+    ScriptPolicyConfig cfg = default_policy_config();
+    if (cfg.landlock_policy.empty()) {
+        std::cout << "[sandbox] no Landlock policy file found; invocations get no Landlock ruleset" << std::endl;
     }
-
-    if (!rb.create_ruleset()) {
-        std::cerr << "[sandbox] failed to create Landlock ruleset" << std::endl;
-        return false;
+    if (cfg.seccomp_whitelist.empty()) {
+        std::cout << "[sandbox] no seccomp whitelist found; invocations get no seccomp filter" << std::endl;
     }
 
-    if (!rb.apply()) {
-        std::cerr << "[sandbox] failed to apply Landlock ruleset" << std::endl;
+    auto policy = policy_cache().get(cfg);
+    if (!policy) {
+        std::cerr << "[sandbox] failed to compile default policy" << std::endl;
         return false;
     }
 
-    std::cout << "[sandbox] Landlock ruleset applied" << std::endl;
-    // Apply seccomp whitelist if present
-    const char* seccomp_conf = "config/syscalls.conf";
-    if (access(seccomp_conf, R_OK) == 0) {
-        std::cout << "[sandbox] loading seccomp whitelist from: " << seccomp_conf << std::endl;
-        if (!load_seccomp_whitelist(seccomp_conf)) {
-            std::cerr << "[sandbox] failed to apply seccomp whitelist" << std::endl;
-            return false;
-        }
-    } else {
-        std::cout << "[sandbox] no seccomp whitelist found at '" << seccomp_conf << "'; skipping seccomp setup" << std::endl;
-    }
+    std::cout << "[sandbox] default policy compiled (landlock=" << policy->has_landlock()
+              << ", seccomp=" << policy->has_seccomp() << ")" << std::endl;
+    return true;
+}
 
+bool watch_policy_files() {
+    // Pick up policy edits without a restart
+    if (!policy_cache().start_watching()) {
+        std::cerr << "[sandbox] policy hot reload unavailable; edits need a restart" << std::endl;
+        return false;
+    }
     return true;
 }
 
 void revoke_policy() {
     std::cout << "[sandbox] revoke policy" << std::endl;
+    policy_cache().stop_watching();
+    policy_cache().clear();
 }
 
 bool is_landlock_available() {
 #if defined(__linux__)
-    // Minimal detection: check for presence of /sys/kernel/security/landlock (kernel 5.13+)
-    FILE* f = fopen("/sys/kernel/security/landlock", "r");
-    if (f) {
-        fclose(f);
-        return true;
-    }
-    return false;
+    // Ask the kernel for its Landlock ABI version (5.13+); securityfs need not be mounted
+    return landlock_abi_version() > 0;
 #else
     return false;
 #endif
@@ -3,6 +3,10 @@
 namespace sandbox {
 
 bool apply_default_policy();
+// Recompile policies when their files are edited, on a background thread.
+// Call after engine::initialize(): the script workers are forked from a
+// single-threaded process.
+bool watch_policy_files();
 void revoke_policy();
 bool is_landlock_available();
 
@@ -6,58 +6,115 @@
 #include <string>
 
 #if defined(__linux__)
+#include <sys/prctl.h>
+#include <linux/seccomp.h>
+#include <errno.h>
 #ifdef USE_LIBSECCOMP
 #include <seccomp.h>
-#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 #endif
 
 namespace sandbox {
 
-bool load_seccomp_whitelist(const std::string& whitelist_file) {
-#if !defined(__linux__)
-    std::cerr << "[sandbox/seccomp] seccomp not supported on non-Linux platforms" << std::endl;
-    return false;
-#endif
-
+bool read_seccomp_whitelist(const std::string& whitelist_file, std::vector<std::string>& syscalls) {
     std::ifstream ifs(whitelist_file);
     if (!ifs.is_open()) {
         std::cerr << "[sandbox/seccomp] could not open whitelist file: " << whitelist_file << std::endl;
         return false;
     }
 
-    std::vector<std::string> syscalls;
     std::string line;
     while (std::getline(ifs, line)) {
         // Trim whitespace
         size_t start = line.find_first_not_of(" \t\r\n");
         if (start == std::string::npos) continue;
         if (line[start] == '#') continue;
-        size_t end = line.find_last_not_of(" \t\r\n");
-        std::string token = line.substr(start, end - start + 1);
+        // Name ends at whitespace; anything after it (e.g. "# 1234 calls") is a comment
+        size_t end = line.find_first_of(" \t\r\n#", start);
+        std::string token = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
         syscalls.push_back(token);
     }
+    return true;
+}
 
 #ifdef USE_LIBSECCOMP
+// Whitelists at least this long are laid out as a binary tree (libseccomp >= 2.5)
+// so the lookup depth stays logarithmic; shorter ones stay a linear chain in
+// file order, which is cheapest when the hot syscalls come first.
+static const size_t BINARY_TREE_THRESHOLD = 32;
+
+// Build (but do not load) a default-deny filter allowing the given syscalls
+static scmp_filter_ctx build_whitelist_ctx(const std::vector<std::string>& syscalls) {
     scmp_filter_ctx ctx = seccomp_init(SCMP_ACT_ERRNO(EPERM));
     if (!ctx) {
         std::cerr << "[sandbox/seccomp] failed to init seccomp ctx" << std::endl;
-        return false;
+        return nullptr;
+    }
+
+#if SCMP_VER_MAJOR > 2 || (SCMP_VER_MAJOR == 2 && SCMP_VER_MINOR >= 5)
+    if (syscalls.size() >= BINARY_TREE_THRESHOLD) {
+        if (seccomp_attr_set(ctx, SCMP_FLTATR_CTL_OPTIMIZE, 2) < 0) {
+            std::cerr << "[sandbox/seccomp] binary tree optimization unavailable; using linear filter" << std::endl;
+        }
     }
+#endif
 
-    for (const auto& s : syscalls) {
+    for (size_t i = 0; i < syscalls.size(); ++i) {
+        const auto& s = syscalls[i];
         int nr = seccomp_syscall_resolve_name(s.c_str());
         if (nr < 0) {
             std::cerr << "[sandbox/seccomp] unknown syscall name: " << s << std::endl;
             seccomp_release(ctx);
-            return false;
+            return nullptr;
         }
         if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, nr, 0) < 0) {
             std::cerr << "[sandbox/seccomp] failed to add rule for: " << s << std::endl;
             seccomp_release(ctx);
-            return false;
+            return nullptr;
         }
+        // Higher priority is tested earlier; keep file (frequency) order
+        seccomp_syscall_priority(ctx, nr, static_cast<uint8_t>(i < 255 ? 255 - i : 0));
+    }
+    return ctx;
+}
+
+// Export a filter as raw BPF through an anonymous memfd
+static bool export_ctx(scmp_filter_ctx ctx, std::vector<sock_filter>& program) {
+    int fd = memfd_create("native_node_bpf", MFD_CLOEXEC);
+    if (fd < 0) return false;
+    int rc = seccomp_export_bpf(ctx, fd);
+    struct stat st;
+    if (rc < 0 || fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size % sizeof(sock_filter) != 0) {
+        std::cerr << "[sandbox/seccomp] seccomp_export_bpf failed" << std::endl;
+        close(fd);
+        return false;
+    }
+    program.resize(static_cast<size_t>(st.st_size) / sizeof(sock_filter));
+    ssize_t n = pread(fd, program.data(), static_cast<size_t>(st.st_size), 0);
+    close(fd);
+    if (n != st.st_size) {
+        program.clear();
+        return false;
     }
+    return true;
+}
+#endif
+
+bool load_seccomp_whitelist(const std::string& whitelist_file) {
+#if !defined(__linux__)
+    std::cerr << "[sandbox/seccomp] seccomp not supported on non-Linux platforms" << std::endl;
+    return false;
+#endif
+
+    std::vector<std::string> syscalls;
+    if (!read_seccomp_whitelist(whitelist_file, syscalls)) return false;
+
+#ifdef USE_LIBSECCOMP
+    scmp_filter_ctx ctx = build_whitelist_ctx(syscalls);
+    if (!ctx) return false;
 
     if (seccomp_load(ctx) < 0) {
         std::cerr << "[sandbox/seccomp] seccomp_load failed" << std::endl;
@@ -74,4 +131,49 @@ bool load_seccomp_whitelist(const std::string& whitelist_file) {
 #endif
 }
 
+bool compile_seccomp_program(const std::vector<std::string>& syscalls, std::vector<sock_filter>& program) {
+#ifdef USE_LIBSECCOMP
+    scmp_filter_ctx ctx = build_whitelist_ctx(syscalls);
+    if (!ctx) return false;
+    bool ok = export_ctx(ctx, program);
+    seccomp_release(ctx);
+    return ok;
+#else
+    (void)syscalls;
+    (void)program;
+    std::cerr << "[sandbox/seccomp] libseccomp not available at compile time; cannot compile seccomp filter" << std::endl;
+    return false;
+#endif
+}
+
+bool compile_seccomp_trace_program(std::vector<sock_filter>& program) {
+#ifdef USE_LIBSECCOMP
+    scmp_filter_ctx ctx = seccomp_init(SCMP_ACT_TRACE(0));
+    if (!ctx) {
+        std::cerr << "[sandbox/seccomp] failed to init seccomp ctx" << std::endl;
+        return false;
+    }
+    bool ok = export_ctx(ctx, program);
+    seccomp_release(ctx);
+    return ok;
+#else
+    (void)program;
+    std::cerr << "[sandbox/seccomp] libseccomp not available at compile time; cannot compile seccomp filter" << std::endl;
+    return false;
+#endif
+}
+
+bool install_seccomp_program(const std::vector<sock_filter>& program) {
+#if defined(__linux__)
+    if (program.empty()) return false;
+    struct sock_fprog fprog;
+    fprog.len = static_cast<unsigned short>(program.size());
+    fprog.filter = const_cast<sock_filter*>(program.data());
+    return prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &fprog) == 0;
+#else
+    (void)program;
+    return false;
+#endif
+}
+
 } // namespace sandbox
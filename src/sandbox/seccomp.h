@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <linux/filter.h>
 
 namespace sandbox {
 
@@ -8,4 +10,20 @@ namespace sandbox {
 // Returns true on success (filter installed) or false on failure.
 bool load_seccomp_whitelist(const std::string& whitelist_file);
 
+// Parse a whitelist file into syscall names (comments and blank lines skipped).
+// Order is preserved: earlier entries are placed earlier in the filter.
+bool read_seccomp_whitelist(const std::string& whitelist_file, std::vector<std::string>& syscalls);
+
+// Build a filter allowing `syscalls` and export it as a raw BPF program
+// (seccomp_export_bpf) so it can be installed later without libseccomp.
+bool compile_seccomp_program(const std::vector<std::string>& syscalls, std::vector<sock_filter>& program);
+
+// Build a permissive filter that reports every syscall to a ptrace tracer
+// (SCMP_ACT_TRACE). Used by the syscall profiler.
+bool compile_seccomp_trace_program(std::vector<sock_filter>& program);
+
+// Install a precompiled BPF program on the calling thread with a single prctl().
+// Requires no_new_privs (or CAP_SYS_ADMIN). Does not allocate; safe after fork().
+bool install_seccomp_program(const std::vector<sock_filter>& program);
+
 } // namespace sandbox
@@ -0,0 +1,119 @@
+#include "spawn_trace.h"
+#include <algorithm>
+#include <sstream>
+
+namespace sandbox {
+
+const char* spawn_phase_name(SpawnPhase phase) {
+    switch (phase) {
+    case SpawnPhase::CgroupCreate: return "cgroup_create";
+    case SpawnPhase::CgroupLimits: return "cgroup_limits";
+    case SpawnPhase::CaptureSetup: return "capture_setup";
+    case SpawnPhase::Fork: return "fork";
+    case SpawnPhase::Exec: return "exec";
+    case SpawnPhase::Run: return "run";
+    case SpawnPhase::Collect: return "collect";
+    case SpawnPhase::Teardown: return "teardown";
+    case SpawnPhase::Count: break;
+    }
+    return "unknown";
+}
+
+uint64_t SpawnTrace::total_ns() const {
+    Clock::time_point first{}, last{};
+    for (const auto& s : spans) {
+        if (!s.recorded()) continue;
+        if (first == Clock::time_point{} || s.begin < first) first = s.begin;
+        if (s.end > last) last = s.end;
+    }
+    if (first == Clock::time_point{}) return 0;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(last - first).count());
+}
+
+void SpawnHistograms::record(const SpawnTrace& trace) {
+    for (size_t i = 0; i < SpawnTrace::PHASES; ++i) {
+        if (trace.spans[i].recorded()) hist_[i].record(trace.spans[i].ns());
+    }
+    uint64_t total = trace.total_ns();
+    if (total > 0) hist_[SpawnTrace::PHASES].record(total);
+}
+
+uint64_t SpawnHistograms::count(SpawnPhase phase) const {
+    return hist_[static_cast<size_t>(phase)].count();
+}
+
+void SpawnHistograms::render_prometheus(std::ostream& out) const {
+    out << "# HELP native_node_spawn_phase_seconds Time spent in each executor phase per invocation.\n"
+        << "# TYPE native_node_spawn_phase_seconds histogram\n";
+    for (size_t i = 0; i <= SpawnTrace::PHASES; ++i) {
+        const char* phase = i == SpawnTrace::PHASES ? "total" : spawn_phase_name(static_cast<SpawnPhase>(i));
+        hist_[i].render_prometheus(out, "native_node_spawn_phase_seconds", std::string("phase=\"") + phase + "\"");
+    }
+}
+
+SpawnTraceRing::SpawnTraceRing(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+void SpawnTraceRing::push(const std::string& name, pid_t pid, const SpawnTrace& trace) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (entries_.size() < capacity_) {
+        entries_.push_back(Entry{ name, pid, trace });
+        return;
+    }
+    entries_[next_] = Entry{ name, pid, trace };
+    next_ = (next_ + 1) % capacity_;
+}
+
+size_t SpawnTraceRing::size() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return entries_.size();
+}
+
+// Minimal JSON string escaping for command names
+static std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += ' ';
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string SpawnTraceRing::to_json() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    std::ostringstream out;
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (size_t n = 0; n < entries_.size(); ++n) {
+        const Entry& e = entries_[(next_ + n) % entries_.size()]; // oldest first
+        for (size_t i = 0; i < SpawnTrace::PHASES; ++i) {
+            const auto& s = e.trace.spans[i];
+            if (!s.recorded()) continue;
+            auto ts = std::chrono::duration_cast<std::chrono::nanoseconds>(s.begin.time_since_epoch()).count();
+            out << (first ? "" : ",") << "{\"name\":\"" << spawn_phase_name(static_cast<SpawnPhase>(i))
+                << "\",\"cat\":\"spawn\",\"ph\":\"X\",\"ts\":" << static_cast<double>(ts) / 1e3
+                << ",\"dur\":" << static_cast<double>(s.ns()) / 1e3 << ",\"pid\":1,\"tid\":" << e.pid
+                << ",\"args\":{\"command\":\"" << json_escape(e.name) << "\"}}";
+            first = false;
+        }
+    }
+    out << "],\"displayTimeUnit\":\"ns\"}";
+    return out.str();
+}
+
+SpawnHistograms& spawn_histograms() {
+    static SpawnHistograms h;
+    return h;
+}
+
+SpawnTraceRing& spawn_trace_ring() {
+    static SpawnTraceRing ring;
+    return ring;
+}
+
+} // namespace sandbox
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "common/latency_histogram.h"
+
+namespace sandbox {
+
+// Phases of one invocation, in execution order
+enum class SpawnPhase {
+    CgroupCreate, // mkdir of the invocation cgroup
+    CgroupLimits, // writing controller files
+    CaptureSetup, // memfd/pipe creation
+    Fork,         // fork() in the parent
+    Exec,         // fork return until execv() succeeded (includes policy install)
+    Run,          // exec until exit was observed
+    Collect,      // reaping and draining the output capture
+    Teardown,     // killing leftovers and removing the cgroup
+    Count
+};
+
+const char* spawn_phase_name(SpawnPhase phase);
+
+// High-resolution per-phase timestamps of one invocation
+struct SpawnTrace {
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t PHASES = static_cast<size_t>(SpawnPhase::Count);
+
+    struct Span {
+        Clock::time_point begin{}, end{};
+        bool recorded() const { return end != Clock::time_point{}; }
+        uint64_t ns() const { return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()); }
+    };
+
+    std::array<Span, PHASES> spans{};
+
+    void mark(SpawnPhase phase, Clock::time_point begin, Clock::time_point end = Clock::now()) {
+        spans[static_cast<size_t>(phase)] = Span{ begin, end };
+    }
+    const Span& span(SpawnPhase phase) const { return spans[static_cast<size_t>(phase)]; }
+
+    // First recorded begin to last recorded end (0 if nothing was recorded)
+    uint64_t total_ns() const;
+};
+
+// Per-phase latency histograms (common::LatencyHistogram buckets). Lock-free
+// to record.
+class SpawnHistograms {
+public:
+    void record(const SpawnTrace& trace);
+
+    // Prometheus histogram "native_node_spawn_phase_seconds{phase=...}"
+    void render_prometheus(std::ostream& out) const;
+
+    uint64_t count(SpawnPhase phase) const;
+
+private:
+    std::array<common::LatencyHistogram, SpawnTrace::PHASES + 1> hist_{}; // last: total
+};
+
+// Bounded ring of recent traces, exported as Chrome trace-event JSON
+// (chrome://tracing, Perfetto): one complete ("X") event per phase.
+class SpawnTraceRing {
+public:
+    explicit SpawnTraceRing(size_t capacity = 256);
+
+    void push(const std::string& name, pid_t pid, const SpawnTrace& trace);
+    std::string to_json() const;
+    size_t size() const;
+
+private:
+    struct Entry {
+        std::string name;
+        pid_t pid = 0;
+        SpawnTrace trace;
+    };
+    mutable std::mutex mtx_;
+    std::vector<Entry> entries_;
+    size_t capacity_;
+    size_t next_ = 0;
+};
+
+// Process-wide sinks fed by the executor
+SpawnHistograms& spawn_histograms();
+SpawnTraceRing& spawn_trace_ring();
+
+} // namespace sandbox
@@ -0,0 +1,187 @@
+#include "syscall_profile.h"
+#include "seccomp.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+
+#ifdef USE_LIBSECCOMP
+#include <seccomp.h>
+#endif
+
+namespace sandbox {
+
+#if defined(__linux__) && defined(USE_LIBSECCOMP)
+static std::string syscall_name(uint64_t nr) {
+    char* name = seccomp_syscall_resolve_num_arch(SCMP_ARCH_NATIVE, static_cast<int>(nr));
+    if (!name) return std::string();
+    std::string s(name);
+    free(name);
+    return s;
+}
+#endif
+
+bool profile_syscalls(const std::vector<std::string>& args, SyscallCounts& counts, int timeout_sec) {
+#if defined(__linux__) && defined(USE_LIBSECCOMP)
+    if (args.empty()) return false;
+
+    // SCMP_ACT_LOG only reaches the audit log, so trace every syscall instead
+    std::vector<sock_filter> program;
+    if (!compile_seccomp_trace_program(program)) return false;
+
+    std::vector<char*> argv;
+    for (const auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "[sandbox/profile] fork failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (pid == 0) {
+        // Own process group so the watchdog can kill the whole tree
+        setpgid(0, 0);
+        if (ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) != 0) _exit(126);
+        raise(SIGSTOP);
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) _exit(126);
+        if (!install_seccomp_program(program)) _exit(126);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, __WALL) != pid || !WIFSTOPPED(status)) {
+        std::cerr << "[sandbox/profile] child did not stop for tracing" << std::endl;
+        return false;
+    }
+    long opts = PTRACE_O_TRACESECCOMP | PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK |
+                PTRACE_O_TRACECLONE | PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL;
+    if (ptrace(PTRACE_SETOPTIONS, pid, nullptr, reinterpret_cast<void*>(opts)) != 0) {
+        std::cerr << "[sandbox/profile] PTRACE_SETOPTIONS failed: " << strerror(errno) << std::endl;
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+        return false;
+    }
+    ptrace(PTRACE_CONT, pid, nullptr, nullptr);
+
+    // Watchdog: kill the traced process group once the timeout elapses
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool done = false;
+    std::thread watchdog([&]() {
+        std::unique_lock<std::mutex> lk(mtx);
+        if (!cv.wait_for(lk, std::chrono::seconds(timeout_sec), [&]() { return done; })) {
+            std::cerr << "[sandbox/profile] timeout; killing traced processes" << std::endl;
+            kill(-pid, SIGKILL);
+        }
+    });
+
+    std::unordered_map<uint64_t, uint64_t> by_nr;
+    std::set<pid_t> tracees = { pid };
+    // New children stop once with SIGSTOP; that stop may arrive before or after
+    // the parent's fork event and must not be delivered.
+    std::set<pid_t> awaiting_stop, stopped_early;
+    while (!tracees.empty()) {
+        pid_t w = waitpid(-1, &status, __WALL);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            tracees.erase(w);
+            continue;
+        }
+        if (!WIFSTOPPED(status)) continue;
+
+        int sig = WSTOPSIG(status);
+        int event = status >> 16;
+        int deliver = 0;
+        if (event == PTRACE_EVENT_SECCOMP) {
+            struct __ptrace_syscall_info info;
+            if (ptrace(PTRACE_GET_SYSCALL_INFO, w, reinterpret_cast<void*>(sizeof(info)), &info) > 0 &&
+                info.op == PTRACE_SYSCALL_INFO_SECCOMP) {
+                ++by_nr[info.seccomp.nr];
+            }
+        } else if (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK || event == PTRACE_EVENT_CLONE) {
+            unsigned long child = 0;
+            ptrace(PTRACE_GETEVENTMSG, w, nullptr, &child);
+            pid_t c = static_cast<pid_t>(child);
+            tracees.insert(c);
+            if (!stopped_early.erase(c)) awaiting_stop.insert(c);
+        } else if (event == 0 && sig == SIGSTOP && awaiting_stop.erase(w)) {
+            // Initial stop of an auto-attached child
+        } else if (event == 0 && sig == SIGSTOP && !tracees.count(w)) {
+            // Initial stop reported before the parent's fork event
+            tracees.insert(w);
+            stopped_early.insert(w);
+        } else if (event == 0) {
+            deliver = sig;
+        }
+        ptrace(PTRACE_CONT, w, nullptr, reinterpret_cast<void*>(static_cast<long>(deliver)));
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        done = true;
+    }
+    cv.notify_one();
+    watchdog.join();
+
+    for (const auto& kv : by_nr) {
+        std::string name = syscall_name(kv.first);
+        if (name.empty()) {
+            std::cerr << "[sandbox/profile] unknown syscall number: " << kv.first << std::endl;
+            continue;
+        }
+        counts[name] += kv.second;
+    }
+    return !counts.empty();
+#else
+    (void)args;
+    (void)counts;
+    (void)timeout_sec;
+    std::cerr << "[sandbox/profile] libseccomp not available at compile time; cannot profile syscalls" << std::endl;
+    return false;
+#endif
+}
+
+bool write_profiled_whitelist(const std::string& path, const SyscallCounts& counts,
+                              const std::vector<std::string>& extra) {
+    std::vector<std::pair<std::string, uint64_t>> ordered(counts.begin(), counts.end());
+    std::stable_sort(ordered.begin(), ordered.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    std::ofstream ofs(path);
+    if (!ofs.is_open()) {
+        std::cerr << "[sandbox/profile] could not open output file: " << path << std::endl;
+        return false;
+    }
+    ofs << "# seccomp whitelist generated by native_node --profile-syscalls\n";
+    ofs << "# Ordered by observed frequency (hottest first); review before use.\n";
+    for (const auto& kv : ordered) {
+        ofs << kv.first << "  # " << kv.second << " calls\n";
+    }
+    for (const auto& name : extra) {
+        if (counts.find(name) == counts.end()) ofs << name << "  # not observed\n";
+    }
+    return !ofs.fail();
+}
+
+} // namespace sandbox
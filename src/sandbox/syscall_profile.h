@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+namespace sandbox {
+
+// Syscall name -> number of times it was made
+using SyscallCounts = std::map<std::string, uint64_t>;
+
+// Run a command (args[0] executable) under a permissive SCMP_ACT_TRACE filter,
+// following forks, and count every syscall it and its children make. The
+// command is killed after timeout_sec. Returns false if it could not be traced.
+// Uses ptrace; intended for offline profiling, not the request path.
+bool profile_syscalls(const std::vector<std::string>& args, SyscallCounts& counts, int timeout_sec = 30);
+
+// Write a seccomp whitelist ordered by descending frequency so that the hot
+// syscalls are tested first by load_seccomp_whitelist(). `extra` names (e.g.
+// from an existing whitelist) are appended if they were not observed.
+bool write_profiled_whitelist(const std::string& path, const SyscallCounts& counts,
+                              const std::vector<std::string>& extra = {});
+
+} // namespace sandbox
@@ -0,0 +1,272 @@
+#include "html_service.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace services {
+
+namespace fs = std::filesystem;
+
+TemplateValue& TemplateValue::set(const std::string& key, TemplateValue value) {
+    for (auto& f : fields_) {
+        if (f.first == key) {
+            f.second = std::move(value);
+            return *this;
+        }
+    }
+    fields_.emplace_back(key, std::move(value));
+    return *this;
+}
+
+TemplateValue& TemplateValue::push(TemplateValue value) {
+    items_.push_back(std::move(value));
+    return *this;
+}
+
+const TemplateValue* TemplateValue::field(std::string_view key) const {
+    for (const auto& f : fields_) {
+        if (f.first == key) return &f.second;
+    }
+    return nullptr;
+}
+
+bool TemplateValue::truthy() const {
+    if (!items_.empty() || !fields_.empty()) return true;
+    return !text_.empty() && text_ != "0" && text_ != "false";
+}
+
+// Loop variables visible at a point of rendering, innermost first
+struct HtmlTemplate::Scope {
+    const std::string& name;
+    const TemplateValue& value;
+    const Scope* outer;
+};
+
+// Bounded writer over the caller's buffer; keeps counting past the end
+class HtmlTemplate::Writer {
+public:
+    Writer(char* out, size_t cap) : out_(out), cap_(cap) {}
+
+    void write(const char* s, size_t n) {
+        if (len_ < cap_) memcpy(out_ + len_, s, std::min(n, cap_ - len_));
+        len_ += n;
+    }
+
+    void write_escaped(const std::string& s) {
+        size_t plain = 0;
+        for (size_t i = 0; i < s.size(); ++i) {
+            const char* rep = nullptr;
+            switch (s[i]) {
+            case '&': rep = "&amp;"; break;
+            case '<': rep = "&lt;"; break;
+            case '>': rep = "&gt;"; break;
+            case '"': rep = "&quot;"; break;
+            case '\'': rep = "&#39;"; break;
+            default: continue;
+            }
+            write(s.data() + plain, i - plain);
+            write(rep, strlen(rep));
+            plain = i + 1;
+        }
+        write(s.data() + plain, s.size() - plain);
+    }
+
+    size_t length() const { return len_; }
+
+private:
+    char* out_;
+    size_t cap_;
+    size_t len_ = 0;
+};
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+    while (!s.empty() && isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+    return s;
+}
+
+static bool parse_path(std::string_view expr, std::vector<std::string>& path) {
+    path.clear();
+    while (true) {
+        size_t dot = expr.find('.');
+        std::string_view part = expr.substr(0, dot);
+        if (part.empty()) return false;
+        for (char c : part) {
+            if (!isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+        }
+        path.emplace_back(part);
+        if (dot == std::string_view::npos) return true;
+        expr.remove_prefix(dot + 1);
+    }
+}
+
+std::shared_ptr<const HtmlTemplate> HtmlTemplate::parse(std::string source, std::string* error) {
+    std::shared_ptr<HtmlTemplate> t(new HtmlTemplate());
+    t->source_ = std::move(source);
+    const std::string& src = t->source_;
+    std::vector<size_t> open; // indices of For/If/Else awaiting their end
+    auto fail = [&](size_t pos, const std::string& what) -> std::shared_ptr<const HtmlTemplate> {
+        if (error) {
+            size_t line = 1 + std::count(src.begin(), src.begin() + std::min(pos, src.size()), '\n');
+            *error = "line " + std::to_string(line) + ": " + what;
+        }
+        return nullptr;
+    };
+
+    size_t pos = 0;
+    while (pos < src.size()) {
+        size_t tag = src.find("<?", pos);
+        size_t text_end = tag == std::string::npos ? src.size() : tag;
+        if (text_end > pos) {
+            Op op{ Op::Text };
+            op.offset = static_cast<uint32_t>(pos);
+            op.length = static_cast<uint32_t>(text_end - pos);
+            t->ops_.push_back(std::move(op));
+        }
+        if (tag == std::string::npos) break;
+        size_t close = src.find("?>", tag + 2);
+        if (close == std::string::npos) return fail(tag, "unterminated <?");
+        std::string_view body(src.data() + tag + 2, close - tag - 2);
+        pos = close + 2;
+
+        Op op{ Op::Print };
+        if (body.substr(0, 2) == "!=") {
+            op.kind = Op::PrintRaw;
+            body.remove_prefix(2);
+        } else if (body.substr(0, 1) == "=") {
+            body.remove_prefix(1);
+        } else {
+            body = trim(body);
+            std::string_view word = body.substr(0, body.find(' '));
+            std::string_view rest = trim(body.substr(word.size()));
+            if (word == "for") {
+                size_t in = rest.find(" in ");
+                if (in == std::string_view::npos) return fail(tag, "expected 'for <name> in <list>'");
+                op.kind = Op::For;
+                op.var = std::string(trim(rest.substr(0, in)));
+                rest = trim(rest.substr(in + 4));
+                std::vector<std::string> var_path;
+                if (!parse_path(op.var, var_path) || var_path.size() != 1) return fail(tag, "invalid loop variable");
+            } else if (word == "if") {
+                op.kind = Op::If;
+            } else if (word == "else" && rest.empty()) {
+                if (open.empty() || t->ops_[open.back()].kind != Op::If) return fail(tag, "else without if");
+                t->ops_[open.back()].jump = static_cast<uint32_t>(t->ops_.size());
+                open.back() = t->ops_.size();
+                t->ops_.push_back(Op{ Op::Else });
+                continue;
+            } else if (word == "end" && rest.empty()) {
+                if (open.empty()) return fail(tag, "end without for/if");
+                t->ops_[open.back()].jump = static_cast<uint32_t>(t->ops_.size());
+                open.pop_back();
+                t->ops_.push_back(Op{ Op::End });
+                continue;
+            } else {
+                return fail(tag, "unknown scriptlet '" + std::string(body) + "'");
+            }
+            body = rest;
+            open.push_back(t->ops_.size());
+        }
+        if (!parse_path(trim(body), op.path)) return fail(tag, "invalid expression '" + std::string(trim(body)) + "'");
+        t->ops_.push_back(std::move(op));
+    }
+    if (!open.empty()) return fail(src.size(), "missing <? end ?>");
+    return t;
+}
+
+const TemplateValue* HtmlTemplate::lookup(const std::vector<std::string>& path, const TemplateValue& data,
+                                          const Scope* scope) const {
+    const TemplateValue* v = nullptr;
+    for (const Scope* s = scope; s && !v; s = s->outer) {
+        if (s->name == path[0]) v = &s->value;
+    }
+    if (!v) v = data.field(path[0]);
+    for (size_t i = 1; v && i < path.size(); ++i) v = v->field(path[i]);
+    return v;
+}
+
+void HtmlTemplate::run(size_t begin, size_t end, const TemplateValue& data, const Scope* scope, Writer& w) const {
+    for (size_t i = begin; i < end; ++i) {
+        const Op& op = ops_[i];
+        switch (op.kind) {
+        case Op::Text:
+            w.write(source_.data() + op.offset, op.length);
+            break;
+        case Op::Print:
+        case Op::PrintRaw:
+            if (const TemplateValue* v = lookup(op.path, data, scope)) {
+                if (op.kind == Op::Print) w.write_escaped(v->text());
+                else w.write(v->text().data(), v->text().size());
+            }
+            break;
+        case Op::For:
+            if (const TemplateValue* list = lookup(op.path, data, scope)) {
+                for (const auto& item : list->items()) {
+                    Scope inner{ op.var, item, scope };
+                    run(i + 1, op.jump, data, &inner, w);
+                }
+            }
+            i = op.jump; // the End
+            break;
+        case Op::If: {
+            const TemplateValue* v = lookup(op.path, data, scope);
+            if (v && v->truthy()) {
+                // Run the then-branch, then skip past a matching else-branch
+                run(i + 1, op.jump, data, scope, w);
+                i = ops_[op.jump].kind == Op::Else ? ops_[op.jump].jump : op.jump;
+            } else {
+                i = op.jump; // Else (falls through into it) or End
+            }
+            break;
+        }
+        case Op::Else: // never reached: If jumps over it
+        case Op::End:
+            break;
+        }
+    }
+}
+
+size_t HtmlTemplate::render(const TemplateValue& data, char* out, size_t cap) const {
+    Writer w(out, cap);
+    run(0, ops_.size(), data, nullptr, w);
+    return w.length();
+}
+
+std::shared_ptr<const HtmlTemplate> TemplateCache::get(const std::string& path) {
+    std::error_code ec;
+    auto mtime = fs::last_write_time(path, ec);
+    if (ec) return nullptr;
+    int64_t mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+    uint64_t size = fs::file_size(path, ec);
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    Entry& e = entries_[path];
+    if (e.tmpl && e.mtime_ns == mtime_ns && e.size == size) return e.tmpl;
+
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs.is_open()) return nullptr;
+    std::ostringstream ss;
+    ss << ifs.rdbuf();
+    std::string error;
+    auto tmpl = HtmlTemplate::parse(ss.str(), &error);
+    ++parses_;
+    if (!tmpl) {
+        std::cerr << "[services/html] " << path << ": " << error << std::endl;
+        entries_.erase(path);
+        return nullptr;
+    }
+    e = Entry{ mtime_ns, size, tmpl };
+    return tmpl;
+}
+
+TemplateCache& template_cache() {
+    static TemplateCache cache;
+    return cache;
+}
+
+} // namespace services
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace services {
+
+// Data handed to a template: a text value, a record of named fields, a list
+// of values, or a mix (a record can also be iterated over its list items).
+class TemplateValue {
+public:
+    TemplateValue() = default;
+    TemplateValue(std::string text) : text_(std::move(text)) {}
+    TemplateValue(const char* text) : text_(text) {}
+
+    // Set a field of a record (replaces an existing one)
+    TemplateValue& set(const std::string& key, TemplateValue value);
+    // Append an item to the list
+    TemplateValue& push(TemplateValue value);
+
+    const TemplateValue* field(std::string_view key) const;
+    const std::string& text() const { return text_; }
+    const std::vector<TemplateValue>& items() const { return items_; }
+    // False for empty text with no fields or items, "0" and "false"
+    bool truthy() const;
+
+private:
+    std::string text_;
+    std::vector<std::pair<std::string, TemplateValue>> fields_;
+    std::vector<TemplateValue> items_;
+};
+
+// A template parsed once into a flat instruction list. Static text is kept
+// as spans of the source; rendering only copies it and the looked-up values
+// into the output. Scriptlets, in the style of Apps Script's HtmlService:
+//   <?= a.b ?>               value, HTML-escaped
+//   <?!= a.b ?>              value, unescaped
+//   <? for row in rows ?>    repeat for each item of a list
+//   <? if a.b ?> <? else ?>  on truthiness of a value
+//   <? end ?>                closes for/if
+class HtmlTemplate {
+public:
+    // nullptr (with `error` set) on a syntax error
+    static std::shared_ptr<const HtmlTemplate> parse(std::string source, std::string* error = nullptr);
+
+    // Render into out[0, cap) like snprintf: returns the full length, which
+    // is larger than cap if the output did not fit (nothing past cap is written)
+    size_t render(const TemplateValue& data, char* out, size_t cap) const;
+
+    size_t instructions() const { return ops_.size(); }
+
+private:
+    struct Op {
+        enum Kind : uint8_t { Text, Print, PrintRaw, For, If, Else, End } kind;
+        explicit Op(Kind k) : kind(k) {}
+        uint32_t offset = 0, length = 0; // Text: span of source_
+        uint32_t jump = 0;               // For/If/Else: index of the matching Else/End
+        std::string var;                 // For: loop variable
+        std::vector<std::string> path;   // Print/PrintRaw/For/If: dotted lookup
+    };
+    struct Scope;
+    class Writer;
+
+    HtmlTemplate() = default;
+    void run(size_t begin, size_t end, const TemplateValue& data, const Scope* scope, Writer& w) const;
+    const TemplateValue* lookup(const std::vector<std::string>& path, const TemplateValue& data, const Scope* scope) const;
+
+    std::string source_;
+    std::vector<Op> ops_;
+};
+
+// Parsed templates by file path. A template is parsed on first use and
+// again only after its file's mtime or size changes.
+class TemplateCache {
+public:
+    TemplateCache() = default;
+
+    // Non-copyable
+    TemplateCache(const TemplateCache&) = delete;
+    TemplateCache& operator=(const TemplateCache&) = delete;
+
+    // nullptr if the file cannot be read or does not parse
+    std::shared_ptr<const HtmlTemplate> get(const std::string& path);
+
+    uint64_t parses() const { return parses_; }
+
+private:
+    struct Entry {
+        int64_t mtime_ns = 0;
+        uint64_t size = 0;
+        std::shared_ptr<const HtmlTemplate> tmpl;
+    };
+    std::mutex mtx_;
+    std::unordered_map<std::string, Entry> entries_;
+    uint64_t parses_ = 0;
+};
+
+// Process-wide template cache
+TemplateCache& template_cache();
+
+} // namespace services
@@ -0,0 +1,292 @@
+#include "property_store.h"
+#include "sqlite_pool.h"
+#include "sqlite_writer.h"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
+namespace services {
+
+const char* property_scope_name(PropertyScope scope) {
+    switch (scope) {
+    case PropertyScope::Script: return "script";
+    case PropertyScope::User: return "user";
+    case PropertyScope::Global: return "global";
+    }
+    return "unknown";
+}
+
+static int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static bool live(int64_t expires_at, int64_t now) {
+    return expires_at == 0 || expires_at > now;
+}
+
+// Scope, then the owner length-prefixed so no owner/key split is ambiguous
+static std::string property_id(PropertyScope scope, const std::string& owner, const std::string& key) {
+    std::string id(1, static_cast<char>('0' + static_cast<int>(scope)));
+    id += std::to_string(owner.size());
+    id += ':';
+    id += owner;
+    id += key;
+    return id;
+}
+
+PropertyStore::PropertyStore(PropertyStoreOptions opts) : opts_(opts) {
+    size_t n = std::max<size_t>(opts_.shards, 1);
+    for (size_t i = 0; i < n; ++i) shards_.push_back(std::make_unique<Shard>());
+}
+
+PropertyStore::~PropertyStore() {
+    stop();
+}
+
+PropertyStore::Shard& PropertyStore::shard_for(const std::string& id) const {
+    return *shards_[std::hash<std::string>{}(id) % shards_.size()];
+}
+
+bool PropertyStore::get(PropertyScope scope, const std::string& owner, const std::string& key, std::string& value) const {
+    std::string id = property_id(scope, owner, key);
+    const Shard& shard = shard_for(id);
+    std::shared_lock<std::shared_mutex> lk(shard.mtx);
+    auto it = shard.map.find(id);
+    // Only properties with a TTL pay for reading the clock
+    if (it == shard.map.end() || (it->second.expires_at != 0 && it->second.expires_at <= now_ms())) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    value = it->second.value;
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Called with the shard locked exclusively, so the dirty entry always
+// matches the map whatever order concurrent writers get there in
+void PropertyStore::mark_dirty(Shard& shard, const std::string& id, Change change) {
+    auto res = shard.dirty.insert_or_assign(id, std::move(change));
+    if (res.second && dirty_count_.fetch_add(1, std::memory_order_relaxed) + 1 == opts_.flush_batch) {
+        cv_.notify_one();
+    }
+}
+
+void PropertyStore::set(PropertyScope scope, const std::string& owner, const std::string& key, std::string value,
+                        std::chrono::milliseconds ttl) {
+    std::string id = property_id(scope, owner, key);
+    Entry entry{ std::move(value), ttl.count() > 0 ? now_ms() + ttl.count() : 0 };
+    Shard& shard = shard_for(id);
+    std::unique_lock<std::shared_mutex> lk(shard.mtx);
+    if (writer_) mark_dirty(shard, id, Change{ scope, owner, key, false, entry });
+    shard.map[id] = std::move(entry);
+}
+
+bool PropertyStore::remove(PropertyScope scope, const std::string& owner, const std::string& key) {
+    std::string id = property_id(scope, owner, key);
+    Shard& shard = shard_for(id);
+    std::unique_lock<std::shared_mutex> lk(shard.mtx);
+    auto it = shard.map.find(id);
+    if (it == shard.map.end()) return false;
+    bool was_live = live(it->second.expires_at, now_ms());
+    shard.map.erase(it);
+    if (writer_) mark_dirty(shard, id, Change{ scope, owner, key, true, {} });
+    return was_live;
+}
+
+std::vector<std::pair<std::string, std::string>> PropertyStore::list(PropertyScope scope, const std::string& owner) const {
+    std::string prefix = property_id(scope, owner, "");
+    int64_t now = now_ms();
+    std::vector<std::pair<std::string, std::string>> out;
+    for (const auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lk(shard->mtx);
+        for (const auto& kv : shard->map) {
+            if (kv.first.compare(0, prefix.size(), prefix) == 0 && live(kv.second.expires_at, now)) {
+                out.emplace_back(kv.first.substr(prefix.size()), kv.second.value);
+            }
+        }
+    }
+    return out;
+}
+
+size_t PropertyStore::size() const {
+    size_t n = 0;
+    for (const auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lk(shard->mtx);
+        n += shard->map.size();
+    }
+    return n;
+}
+
+// Expired entries are invisible already; this only reclaims their memory.
+// The database drops its copies on the next flush.
+void PropertyStore::sweep() {
+    int64_t now = now_ms();
+    for (auto& shard : shards_) {
+        std::unique_lock<std::shared_mutex> lk(shard->mtx);
+        for (auto it = shard->map.begin(); it != shard->map.end();) {
+            if (live(it->second.expires_at, now)) ++it;
+            else it = shard->map.erase(it);
+        }
+    }
+}
+
+void PropertyStore::run() {
+    auto last_sweep = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lk(mtx_);
+    while (!stopping_) {
+        cv_.wait_for(lk, std::chrono::milliseconds(opts_.flush_interval_ms), [this] {
+            return stopping_ || dirty_count_.load(std::memory_order_relaxed) >= opts_.flush_batch;
+        });
+        if (stopping_) break;
+        lk.unlock();
+        if (dirty_count_.load(std::memory_order_relaxed) > 0) flush();
+        if (std::chrono::steady_clock::now() - last_sweep >= std::chrono::milliseconds(opts_.sweep_interval_ms)) {
+            sweep();
+            last_sweep = std::chrono::steady_clock::now();
+        }
+        lk.lock();
+    }
+}
+
+void PropertyStore::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!running_) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    if (writer_) flush();
+    std::lock_guard<std::mutex> lk(mtx_);
+    running_ = false;
+}
+
+#if defined(HAVE_SQLITE3)
+
+static const char* CREATE_TABLE =
+    "CREATE TABLE IF NOT EXISTS properties("
+    "scope INTEGER NOT NULL, owner TEXT NOT NULL, key TEXT NOT NULL, value TEXT NOT NULL, "
+    "expires_at INTEGER NOT NULL DEFAULT 0, PRIMARY KEY(scope, owner, key)) WITHOUT ROWID;";
+// Lets each flush's sweep of expired rows skip the ones without a TTL
+static const char* CREATE_EXPIRY_INDEX =
+    "CREATE INDEX IF NOT EXISTS properties_expires_at ON properties(expires_at) WHERE expires_at != 0;";
+
+bool PropertyStore::start(SQLiteWriter* writer, SQLiteConnectionPool* readers) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (running_) return true;
+    if (writer && !(writer->execute(CREATE_TABLE).get() && writer->execute(CREATE_EXPIRY_INDEX).get())) {
+        std::cerr << "[services/properties] failed to create the properties table" << std::endl;
+        return false;
+    }
+    size_t loaded = 0;
+    if (writer && readers) {
+        auto conn = readers->acquire();
+        auto stmt = conn.prepare("SELECT scope, owner, key, value, expires_at FROM properties WHERE expires_at = 0 OR expires_at > ?;");
+        if (!stmt) return false;
+        sqlite3_bind_int64(stmt.get(), 1, now_ms());
+        int rc;
+        while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+            auto text = [&stmt](int col) {
+                const char* s = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), col));
+                return std::string(s ? s : "", static_cast<size_t>(sqlite3_column_bytes(stmt.get(), col)));
+            };
+            std::string id = property_id(static_cast<PropertyScope>(sqlite3_column_int(stmt.get(), 0)), text(1), text(2));
+            shard_for(id).map[id] = Entry{ text(3), sqlite3_column_int64(stmt.get(), 4) };
+            ++loaded;
+        }
+        if (rc != SQLITE_DONE) {
+            std::cerr << "[services/properties] warm load failed: " << sqlite3_errmsg(conn.get()) << std::endl;
+            return false;
+        }
+    }
+    writer_ = writer;
+    running_ = true;
+    stopping_ = false;
+    if (writer_) thread_ = std::thread(&PropertyStore::run, this);
+    std::cout << "[services/properties] " << (writer_ ? "loaded " + std::to_string(loaded) + " properties" : "in memory only")
+              << " (" << shards_.size() << " shards)" << std::endl;
+    return true;
+}
+
+bool PropertyStore::flush() {
+    std::lock_guard<std::mutex> flush_lk(flush_mtx_);
+    if (!writer_) return true;
+    auto changes = std::make_shared<std::vector<Change>>();
+    for (auto& shard : shards_) {
+        std::unordered_map<std::string, Change> dirty;
+        {
+            std::unique_lock<std::shared_mutex> lk(shard->mtx);
+            dirty.swap(shard->dirty);
+        }
+        for (auto& kv : dirty) changes->push_back(std::move(kv.second));
+    }
+    dirty_count_.fetch_sub(changes->size(), std::memory_order_relaxed);
+    if (changes->empty()) return true;
+
+    int64_t now = now_ms();
+    bool ok = writer_->submit([changes, now](sqlite3* db) {
+        sqlite3_stmt* put = nullptr;
+        sqlite3_stmt* del = nullptr;
+        bool ok = sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO properties(scope, owner, key, value, expires_at) VALUES(?, ?, ?, ?, ?);",
+                                     -1, &put, nullptr) == SQLITE_OK &&
+                  sqlite3_prepare_v2(db, "DELETE FROM properties WHERE scope = ? AND owner = ? AND key = ?;", -1, &del, nullptr) == SQLITE_OK;
+        for (size_t i = 0; ok && i < changes->size(); ++i) {
+            const Change& c = (*changes)[i];
+            sqlite3_stmt* stmt = c.erase ? del : put;
+            sqlite3_bind_int(stmt, 1, static_cast<int>(c.scope));
+            sqlite3_bind_text(stmt, 2, c.owner.data(), static_cast<int>(c.owner.size()), SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 3, c.key.data(), static_cast<int>(c.key.size()), SQLITE_STATIC);
+            if (!c.erase) {
+                sqlite3_bind_text(stmt, 4, c.entry.value.data(), static_cast<int>(c.entry.value.size()), SQLITE_STATIC);
+                sqlite3_bind_int64(stmt, 5, c.entry.expires_at);
+            }
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_reset(stmt);
+        }
+        if (ok) {
+            // Expired rows would only be filtered out by the next warm load.
+            // The predicate matches the partial index, so this is a range scan.
+            sqlite3_stmt* expire = nullptr;
+            ok = sqlite3_prepare_v2(db, "DELETE FROM properties WHERE expires_at != 0 AND expires_at <= ?;", -1, &expire, nullptr) == SQLITE_OK;
+            if (ok) {
+                sqlite3_bind_int64(expire, 1, now);
+                ok = sqlite3_step(expire) == SQLITE_DONE;
+            }
+            sqlite3_finalize(expire);
+        }
+        sqlite3_finalize(put);
+        sqlite3_finalize(del);
+        return ok;
+    }).get();
+    if (ok) {
+        flushes_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Put the changes back unless the key has changed again since
+    std::cerr << "[services/properties] flush of " << changes->size() << " properties failed; will retry" << std::endl;
+    for (auto& c : *changes) {
+        std::string id = property_id(c.scope, c.owner, c.key);
+        Shard& shard = shard_for(id);
+        std::unique_lock<std::shared_mutex> lk(shard.mtx);
+        if (!shard.dirty.count(id)) mark_dirty(shard, id, std::move(c));
+    }
+    return false;
+}
+
+#else
+
+bool PropertyStore::start(SQLiteWriter* /*writer*/, SQLiteConnectionPool* /*readers*/) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    running_ = true;
+    std::cout << "[services/properties] in memory only (" << shards_.size() << " shards)" << std::endl;
+    return true;
+}
+
+bool PropertyStore::flush() {
+    return true;
+}
+
+#endif
+
+} // namespace services
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace services {
+
+class SQLiteConnectionPool;
+class SQLiteWriter;
+
+// Who a property belongs to: one script, one user, or everyone
+enum class PropertyScope : int { Script = 0, User = 1, Global = 2 };
+const char* property_scope_name(PropertyScope scope);
+
+struct PropertyStoreOptions {
+    size_t shards = 64;
+    int flush_interval_ms = 100;   // write-behind delay
+    size_t flush_batch = 4096;     // flush early once this many keys are dirty
+    int sweep_interval_ms = 60000; // drop expired properties from memory this often
+};
+
+// Script/user/global key-value properties served from memory. Keys hash to
+// shards, each a map behind its own reader-writer lock, so reads of
+// different keys never contend and a hit never touches the database.
+//
+// Changes are persisted write-behind: each shard remembers the latest
+// change per key, and a flusher thread hands everything dirty to the
+// SQLiteWriter as one transaction every flush_interval_ms (or sooner once
+// flush_batch keys are dirty). A burst of writes to the same or different
+// keys therefore costs a few transactions, and a key written many times in
+// between is written once. start() warm-loads every unexpired property.
+class PropertyStore {
+public:
+    explicit PropertyStore(PropertyStoreOptions opts = {});
+    ~PropertyStore();
+
+    // Non-copyable
+    PropertyStore(const PropertyStore&) = delete;
+    PropertyStore& operator=(const PropertyStore&) = delete;
+
+    // Create the table through `writer`, load it through `readers` and start
+    // flushing. Either may be nullptr: properties then live in memory only.
+    bool start(SQLiteWriter* writer, SQLiteConnectionPool* readers);
+    // Flush what is dirty, then stop
+    void stop();
+
+    // Value of an unexpired property
+    bool get(PropertyScope scope, const std::string& owner, const std::string& key, std::string& value) const;
+    // ttl 0: never expires
+    void set(PropertyScope scope, const std::string& owner, const std::string& key, std::string value,
+             std::chrono::milliseconds ttl = std::chrono::milliseconds(0));
+    // False if there was no such property
+    bool remove(PropertyScope scope, const std::string& owner, const std::string& key);
+    // Every unexpired property of one owner, unordered
+    std::vector<std::pair<std::string, std::string>> list(PropertyScope scope, const std::string& owner) const;
+
+    // Persist everything dirty now; false if the transaction failed (the
+    // changes stay dirty and are retried)
+    bool flush();
+
+    size_t size() const;
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    uint64_t flushes() const { return flushes_.load(std::memory_order_relaxed); } // transactions written
+
+private:
+    struct Entry {
+        std::string value;
+        int64_t expires_at = 0; // ms since the epoch, 0 = never
+    };
+    // Latest unpersisted change of one key
+    struct Change {
+        PropertyScope scope;
+        std::string owner, key;
+        bool erase = false;
+        Entry entry;
+    };
+    struct Shard {
+        mutable std::shared_mutex mtx;
+        std::unordered_map<std::string, Entry> map;     // by composite key
+        std::unordered_map<std::string, Change> dirty; // by composite key
+    };
+
+    Shard& shard_for(const std::string& id) const;
+    void mark_dirty(Shard& shard, const std::string& id, Change change);
+    void sweep();
+    void run();
+
+    PropertyStoreOptions opts_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    SQLiteWriter* writer_ = nullptr;
+    std::mutex flush_mtx_; // one flush at a time
+    std::atomic<size_t> dirty_count_{ 0 };
+    mutable std::atomic<uint64_t> hits_{ 0 };
+    mutable std::atomic<uint64_t> misses_{ 0 };
+    std::atomic<uint64_t> flushes_{ 0 };
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool running_ = false;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace services
@@ -0,0 +1,182 @@
+#include "query_cache.h"
+#include <algorithm>
+#include <cctype>
+#include <strings.h>
+
+namespace services {
+
+// SQL names are case-insensitive
+static std::string table_name(const std::string& t) {
+    std::string out = t;
+    for (char& c : out) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return out;
+}
+
+QueryCache::QueryCache(size_t budget_bytes, size_t max_entry_bytes)
+    : budget_bytes_(budget_bytes), max_entry_bytes_(std::min(max_entry_bytes, budget_bytes)) {}
+
+std::string QueryCache::key(const std::string& sql, const std::vector<std::string>& params) {
+    std::string out;
+    out.reserve(sql.size() + 16);
+    char quote = 0;
+    bool space = false;
+    for (size_t i = 0; i < sql.size(); ++i) {
+        char c = sql[i];
+        if (quote) {
+            out += c;
+            if (c == quote) quote = 0;
+            continue;
+        }
+        // Comments count as whitespace; an unterminated one runs to the end
+        if (c == '-' && i + 1 < sql.size() && sql[i + 1] == '-') {
+            i = sql.find('\n', i);
+            if (i == std::string::npos) break;
+            space = true;
+            continue;
+        }
+        if (c == '/' && i + 1 < sql.size() && sql[i + 1] == '*') {
+            i = sql.find("*/", i + 2);
+            if (i == std::string::npos) break;
+            ++i;
+            space = true;
+            continue;
+        }
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            space = true;
+            continue;
+        }
+        if (space && !out.empty()) out += ' ';
+        space = false;
+        if (c == '\'' || c == '"' || c == '`') quote = c;
+        else if (c == '[') quote = ']';
+        out += c;
+    }
+    while (!out.empty() && (out.back() == ';' || out.back() == ' ')) out.pop_back();
+    // Parameters length-prefixed, so no two parameter lists collide
+    for (const auto& p : params) {
+        out += '\0';
+        out += std::to_string(p.size());
+        out += ':';
+        out += p;
+    }
+    return out;
+}
+
+std::shared_ptr<const std::string> QueryCache::get(const std::string& key) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++misses_;
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    ++hits_;
+    return it->second->result;
+}
+
+uint64_t QueryCache::begin() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return generation_;
+}
+
+bool QueryCache::put(const std::string& key, const std::vector<std::string>& tables, std::string result, uint64_t stamp) {
+    if (result.size() > max_entry_bytes_) return false;
+    std::vector<std::string> names;
+    for (const auto& t : tables) names.push_back(table_name(t));
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (all_changed_at_ > stamp) return false;
+    for (const auto& t : names) {
+        auto changed = changed_at_.find(t);
+        if (changed != changed_at_.end() && changed->second > stamp) return false;
+    }
+    auto existing = index_.find(key);
+    if (existing != index_.end()) erase(existing->second);
+
+    bytes_ += result.size() + key.size();
+    for (const auto& t : names) by_table_[t].insert(key);
+    lru_.push_front(Entry{ key, std::make_shared<const std::string>(std::move(result)), std::move(names) });
+    index_[key] = lru_.begin();
+    while (bytes_ > budget_bytes_ && !lru_.empty()) erase(std::prev(lru_.end()));
+    return true;
+}
+
+void QueryCache::erase(EntryList::iterator it) {
+    for (const auto& t : it->tables) {
+        auto keys = by_table_.find(t);
+        if (keys == by_table_.end()) continue;
+        keys->second.erase(it->key);
+        if (keys->second.empty()) by_table_.erase(keys);
+    }
+    bytes_ -= it->result->size() + it->key.size();
+    index_.erase(it->key);
+    lru_.erase(it);
+}
+
+void QueryCache::invalidate(const std::vector<std::string>& tables) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    ++generation_;
+    for (const auto& changed : tables) {
+        std::string t = table_name(changed);
+        if (t == ALL_TABLES) {
+            all_changed_at_ = generation_;
+            invalidations_ += lru_.size();
+            lru_.clear();
+            index_.clear();
+            by_table_.clear();
+            bytes_ = 0;
+            return;
+        }
+        changed_at_[t] = generation_;
+        auto keys = by_table_.find(t);
+        if (keys == by_table_.end()) continue;
+        std::vector<std::string> doomed(keys->second.begin(), keys->second.end());
+        for (const auto& k : doomed) {
+            auto it = index_.find(k);
+            if (it == index_.end()) continue;
+            erase(it->second);
+            ++invalidations_;
+        }
+    }
+}
+
+size_t QueryCache::bytes() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return bytes_;
+}
+
+size_t QueryCache::size() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return lru_.size();
+}
+
+uint64_t QueryCache::hits() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return hits_;
+}
+
+uint64_t QueryCache::misses() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return misses_;
+}
+
+uint64_t QueryCache::invalidations() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return invalidations_;
+}
+
+// Functions whose result depends on more than the tables read
+static bool volatile_function(const std::string& name) {
+    static const char* VOLATILE[] = { "random", "randomblob", "date", "time", "datetime", "julianday", "strftime",
+                                      "unixepoch", "current_date", "current_time", "current_timestamp", "changes",
+                                      "total_changes", "last_insert_rowid", "sqlite_offset" };
+    for (const char* v : VOLATILE) {
+        if (strcasecmp(name.c_str(), v) == 0) return true;
+    }
+    return false;
+}
+
+bool cacheable_query(const ReadQueryInfo& info) {
+    return std::none_of(info.functions.begin(), info.functions.end(), volatile_function);
+}
+
+} // namespace services
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "sqlite_query_guard.h"
+
+namespace services {
+
+// Encoded results of read queries, kept within a byte budget (least
+// recently used out first) and dropped per table: each entry remembers the
+// tables its query read, and invalidate() removes every entry that read a
+// changed table. The SQLiteWriter reports those after each commit.
+//
+// A fill races with writes: a query may still be reading a snapshot from
+// before a commit when that commit's invalidation arrives. Take a stamp with
+// begin() before running the query and pass it to put(); the result is only
+// kept if none of its tables changed in between.
+class QueryCache {
+public:
+    // Stands for every table (schema changes)
+    static constexpr const char* ALL_TABLES = "*";
+
+    QueryCache(size_t budget_bytes, size_t max_entry_bytes);
+
+    // Non-copyable
+    QueryCache(const QueryCache&) = delete;
+    QueryCache& operator=(const QueryCache&) = delete;
+
+    // Cache key: the SQL with comments and whitespace outside literals
+    // collapsed and any trailing ';' dropped, then the bound parameters (and
+    // anything else the encoding depends on)
+    static std::string key(const std::string& sql, const std::vector<std::string>& params);
+
+    std::shared_ptr<const std::string> get(const std::string& key);
+    uint64_t begin() const;
+    // False if the result is too large or a table changed since `stamp`
+    bool put(const std::string& key, const std::vector<std::string>& tables, std::string result, uint64_t stamp);
+    void invalidate(const std::vector<std::string>& tables);
+
+    size_t max_entry_bytes() const { return max_entry_bytes_; }
+    size_t bytes() const;
+    size_t size() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+    uint64_t invalidations() const; // entries dropped because a table changed
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const std::string> result;
+        std::vector<std::string> tables;
+    };
+    using EntryList = std::list<Entry>;
+
+    void erase(EntryList::iterator it);
+
+    size_t budget_bytes_;
+    size_t max_entry_bytes_;
+    mutable std::mutex mtx_;
+    EntryList lru_; // most recently used first
+    std::unordered_map<std::string, EntryList::iterator> index_;
+    std::unordered_map<std::string, std::unordered_set<std::string>> by_table_; // table -> keys
+    std::unordered_map<std::string, uint64_t> changed_at_;                      // table -> generation
+    uint64_t generation_ = 0;
+    uint64_t all_changed_at_ = 0;
+    size_t bytes_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t invalidations_ = 0;
+};
+
+// Whether a query vetted by ReadQueryGuard may be cached under the tables it
+// reads: false if its result depends on more than those (random(), the
+// current time, ...)
+bool cacheable_query(const ReadQueryInfo& info);
+
+} // namespace services
@@ -1,9 +1,20 @@
 #include "services.h"
 #include <iostream>
 #include <atomic>
+#include "property_store.h"
+#include "query_cache.h"
+#include "sqlite_checkpointer.h"
+#include "sqlite_config.h"
 #include "sqlite_pool.h"
+#include "sqlite_query_guard.h"
+#include "sqlite_writer.h"
 
 static std::unique_ptr<services::SQLiteConnectionPool> g_sqlite_pool;
+static std::unique_ptr<services::SQLiteWriter> g_sqlite_writer;
+static std::unique_ptr<services::SQLiteCheckpointer> g_sqlite_checkpointer;
+static std::unique_ptr<services::PropertyStore> g_property_store;
+static std::unique_ptr<services::QueryCache> g_query_cache;
+static std::unique_ptr<services::ReadQueryGuard> g_query_guard;
 
 namespace services {
 
@@ -11,28 +22,99 @@ static std::atomic<bool> g_initialized{false};
 
 
 bool initialize() {
-    std::cout << "[services] initializing (SQLite, MailApp, PropertyStore stubs)" << std::endl;
-    // Initialize SQLite connection pool (WAL mode) if available
+    std::cout << "[services] initializing (SQLite, PropertyStore, MailApp stub)" << std::endl;
+    // SQLite: one writer thread (creates the database, WAL mode) and a pool
+    // of read-only connections, if available
 #ifdef HAVE_SQLITE3
-    g_sqlite_pool = std::make_unique<services::SQLiteConnectionPool>("./data/native_node.db", 4);
+    SQLiteConfig cfg = configured_sqlite();
+    SQLiteWriterOptions wopts;
+    wopts.synchronous = cfg.synchronous;
+    wopts.max_batch = cfg.max_batch;
+    wopts.busy_timeout_ms = cfg.busy_timeout_ms;
+    wopts.cache_size = cfg.cache_size;
+    if (cfg.checkpoint_interval_ms > 0) {
+        // Checkpoints move off the writer's commit path onto their own thread
+        CheckpointPolicy policy;
+        policy.interval_ms = cfg.checkpoint_interval_ms;
+        policy.passive_bytes = cfg.checkpoint_bytes;
+        policy.limit_bytes = cfg.wal_limit_bytes;
+        policy.busy_timeout_ms = cfg.busy_timeout_ms;
+        g_sqlite_checkpointer = std::make_unique<services::SQLiteCheckpointer>(cfg.db_path, policy);
+        SQLiteCheckpointer* checkpointer = g_sqlite_checkpointer.get();
+        wopts.on_wal_commit = [checkpointer](int pages) { checkpointer->notify(pages); };
+    }
+    if (cfg.query_cache_bytes > 0) {
+        g_query_cache = std::make_unique<services::QueryCache>(cfg.query_cache_bytes, cfg.query_cache_entry_bytes);
+    }
+    // Commits drop the cached results of the tables they touched, and schema
+    // changes the guard's remembered verdicts (it opens once the pool is up)
+    g_query_guard = std::make_unique<services::ReadQueryGuard>(cfg.db_path);
+    QueryCache* cache = g_query_cache.get();
+    ReadQueryGuard* guard = g_query_guard.get();
+    wopts.on_tables_changed = [cache, guard](const std::vector<std::string>& tables) {
+        if (cache) cache->invalidate(tables);
+        guard->invalidate(tables);
+    };
+    g_sqlite_writer = std::make_unique<services::SQLiteWriter>(cfg.db_path, wopts);
+    if (!g_sqlite_writer->start()) {
+        std::cerr << "[services] failed to start the SQLite writer" << std::endl;
+        return false;
+    }
+    if (g_sqlite_checkpointer && !g_sqlite_checkpointer->start()) {
+        std::cerr << "[services] failed to start the SQLite checkpointer" << std::endl;
+        return false;
+    }
+    SQLitePoolOptions ropts;
+    ropts.read_only = true;
+    ropts.mmap_size = cfg.mmap_size;
+    ropts.cache_size = cfg.cache_size;
+    ropts.busy_timeout_ms = cfg.busy_timeout_ms;
+    g_sqlite_pool = std::make_unique<services::SQLiteConnectionPool>(cfg.db_path, cfg.readers, ropts);
     if (!g_sqlite_pool->initialize()) {
         std::cerr << "[services] failed to initialize SQLite pool" << std::endl;
         return false;
     }
+    if (!g_query_guard->open()) {
+        std::cerr << "[services] failed to open the SQLite query guard" << std::endl;
+        return false;
+    }
 #else
     std::cout << "[services] SQLite3 headers not found; skipping SQLite pool initialization" << std::endl;
 #endif
 
+    // Properties: warm-loaded from and written behind to SQLite when it is up
+    g_property_store = std::make_unique<services::PropertyStore>();
+    if (!g_property_store->start(g_sqlite_writer.get(), g_sqlite_pool.get())) {
+        std::cerr << "[services] failed to load properties" << std::endl;
+        return false;
+    }
+
     g_initialized = true;
     return true;
 }
 
 void shutdown() {
     std::cout << "[services] shutdown" << std::endl;
+    // Flushes through the writer, so it goes first
+    if (g_property_store) {
+        g_property_store->stop();
+        g_property_store.reset();
+    }
     if (g_sqlite_pool) {
         g_sqlite_pool->shutdown();
         g_sqlite_pool.reset();
     }
+    if (g_sqlite_writer) {
+        g_sqlite_writer->stop();
+        g_sqlite_writer.reset();
+    }
+    if (g_sqlite_checkpointer) {
+        g_sqlite_checkpointer->stop();
+        g_sqlite_checkpointer.reset();
+    }
+    // Both are reported to by the writer, so they go after it
+    g_query_guard.reset();
+    g_query_cache.reset();
     g_initialized = false;
 }
 
@@ -40,4 +122,28 @@ bool is_initialized() {
     return g_initialized.load();
 }
 
+SQLiteConnectionPool* sqlite_readers() {
+    return g_sqlite_pool.get();
+}
+
+SQLiteWriter* sqlite_writer() {
+    return g_sqlite_writer.get();
+}
+
+SQLiteCheckpointer* sqlite_checkpointer() {
+    return g_sqlite_checkpointer.get();
+}
+
+PropertyStore* property_store() {
+    return g_property_store.get();
+}
+
+QueryCache* query_cache() {
+    return g_query_cache.get();
+}
+
+ReadQueryGuard* query_guard() {
+    return g_query_guard.get();
+}
+
 } // namespace services
@@ -4,8 +4,28 @@
 
 namespace services {
 
+class SQLiteConnectionPool;
+class SQLiteWriter;
+class SQLiteCheckpointer;
+class PropertyStore;
+class QueryCache;
+class ReadQueryGuard;
+
 bool initialize();
 void shutdown();
 bool is_initialized();
 
+// Read-only connections and the single writer of the configured database
+// (nullptr before initialize() or without SQLite)
+SQLiteConnectionPool* sqlite_readers();
+SQLiteWriter* sqlite_writer();
+// Background WAL checkpointer (nullptr when SQLite checkpoints inline)
+SQLiteCheckpointer* sqlite_checkpointer();
+// Script/user/global properties (nullptr before initialize())
+PropertyStore* property_store();
+// Cached /api/query results (nullptr when disabled in config/sqlite.conf)
+QueryCache* query_cache();
+// Vets /api/query SQL before it reaches a reader (nullptr without SQLite)
+ReadQueryGuard* query_guard();
+
 } // namespace services
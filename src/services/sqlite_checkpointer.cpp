@@ -0,0 +1,170 @@
+#include "sqlite_checkpointer.h"
+
+namespace services {
+
+const char* checkpoint_mode_name(CheckpointMode mode) {
+    switch (mode) {
+    case CheckpointMode::Passive: return "passive";
+    case CheckpointMode::Truncate: return "truncate";
+    }
+    return "unknown";
+}
+
+} // namespace services
+
+// Only compile the real implementation when SQLite3 headers are available
+#if defined(HAVE_SQLITE3)
+#include <sys/stat.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace services {
+
+SQLiteCheckpointer::SQLiteCheckpointer(std::string db_path, CheckpointPolicy policy)
+    : db_path_(std::move(db_path)), policy_(policy) {}
+
+SQLiteCheckpointer::~SQLiteCheckpointer() {
+    stop();
+}
+
+bool SQLiteCheckpointer::start() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (running_) return true;
+    int rc = sqlite3_open_v2(db_path_.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "[sqlite_checkpointer] failed to open db: " << sqlite3_errstr(rc) << std::endl;
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+    // Reading the journal mode opens the WAL on this connection; until then
+    // checkpoints are silent no-ops
+    std::string mode;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, "PRAGMA journal_mode;", -1, &stmt, nullptr) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        mode = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    if (sqlite3_prepare_v2(db_, "PRAGMA page_size;", -1, &stmt, nullptr) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        page_size_ = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    if (mode != "wal") {
+        std::cerr << "[sqlite_checkpointer] " << db_path_ << " is not in WAL mode" << std::endl;
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+    running_ = true;
+    stopping_ = false;
+    thread_ = std::thread(&SQLiteCheckpointer::run, this);
+    std::cout << "[sqlite_checkpointer] started (passive at " << policy_.passive_bytes << " bytes or every "
+              << policy_.interval_ms << " ms, truncate past " << policy_.limit_bytes << " bytes)" << std::endl;
+    return true;
+}
+
+void SQLiteCheckpointer::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!running_) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+    std::lock_guard<std::mutex> lk(mtx_);
+    std::lock_guard<std::mutex> db_lk(db_mtx_);
+    sqlite3_close(db_);
+    db_ = nullptr;
+    running_ = false;
+}
+
+void SQLiteCheckpointer::notify(int wal_pages) {
+    wal_pages_.store(wal_pages, std::memory_order_relaxed);
+    if (wal_pages * page_size_ >= policy_.passive_bytes && !kick_.exchange(true)) cv_.notify_one();
+}
+
+int64_t SQLiteCheckpointer::stat_wal() const {
+    struct stat st;
+    if (stat((db_path_ + "-wal").c_str(), &st) != 0) return 0;
+    return static_cast<int64_t>(st.st_size);
+}
+
+bool SQLiteCheckpointer::checkpoint(CheckpointMode mode) {
+    std::lock_guard<std::mutex> lk(db_mtx_);
+    if (!db_) return false;
+    int sqlite_mode = mode == CheckpointMode::Truncate ? SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_PASSIVE;
+    // Only TRUNCATE invokes the busy handler; PASSIVE never waits
+    sqlite3_busy_timeout(db_, mode == CheckpointMode::Truncate ? policy_.busy_timeout_ms : 0);
+    int log = 0, done = 0;
+    auto start = std::chrono::steady_clock::now();
+    int rc = sqlite3_wal_checkpoint_v2(db_, nullptr, sqlite_mode, &log, &done);
+    uint64_t ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+    hist_[static_cast<size_t>(mode)].record(ns);
+    wal_bytes_.store(stat_wal(), std::memory_order_relaxed);
+
+    if (rc != SQLITE_OK) {
+        if (rc != SQLITE_BUSY) std::cerr << "[sqlite_checkpointer] " << checkpoint_mode_name(mode) << ": " << sqlite3_errmsg(db_) << std::endl;
+        return false;
+    }
+    // Everything is back in the database: nothing to do until the next commit
+    // (which restarts the WAL and reports again)
+    if (log >= 0 && done >= log) {
+        int pages = wal_pages_.load(std::memory_order_relaxed);
+        if (pages <= log) wal_pages_.compare_exchange_strong(pages, 0, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void SQLiteCheckpointer::run() {
+    using std::chrono::milliseconds;
+    auto last = std::chrono::steady_clock::now();
+    // A TRUNCATE that times out on a reader stalls the writer for the whole
+    // busy timeout, so retries back off while readers keep the WAL pinned
+    auto next_escalation = last;
+    int backoff_ms = policy_.interval_ms;
+    std::unique_lock<std::mutex> lk(mtx_);
+    while (!stopping_) {
+        cv_.wait_for(lk, milliseconds(policy_.interval_ms), [this] { return stopping_ || kick_.load(); });
+        if (stopping_) break;
+        kick_ = false;
+        lk.unlock();
+
+        int64_t pending = wal_pages_.load(std::memory_order_relaxed) * page_size_;
+        int64_t file = stat_wal();
+        wal_bytes_.store(file, std::memory_order_relaxed);
+        auto now = std::chrono::steady_clock::now();
+        if ((pending >= policy_.limit_bytes || file >= policy_.limit_bytes) && now >= next_escalation) {
+            bool ok = checkpoint(CheckpointMode::Truncate);
+            backoff_ms = ok ? policy_.interval_ms : std::min(backoff_ms * 2, 60000);
+            next_escalation = std::chrono::steady_clock::now() + milliseconds(backoff_ms);
+            last = now;
+        } else if (pending >= policy_.passive_bytes || (pending > 0 && now - last >= milliseconds(policy_.interval_ms))) {
+            checkpoint(CheckpointMode::Passive);
+            last = now;
+        }
+
+        lk.lock();
+    }
+}
+
+uint64_t SQLiteCheckpointer::count(CheckpointMode mode) const {
+    return hist_[static_cast<size_t>(mode)].count();
+}
+
+void SQLiteCheckpointer::render_prometheus(std::ostream& out) const {
+    out << "# HELP native_node_sqlite_wal_bytes Size of the SQLite write-ahead log file.\n"
+        << "# TYPE native_node_sqlite_wal_bytes gauge\n"
+        << "native_node_sqlite_wal_bytes " << wal_bytes() << "\n"
+        << "# HELP native_node_sqlite_checkpoint_seconds Duration of background WAL checkpoints.\n"
+        << "# TYPE native_node_sqlite_checkpoint_seconds histogram\n";
+    for (size_t i = 0; i < hist_.size(); ++i) {
+        const char* mode = checkpoint_mode_name(static_cast<CheckpointMode>(i));
+        hist_[i].render_prometheus(out, "native_node_sqlite_checkpoint_seconds", std::string("mode=\"") + mode + "\"");
+    }
+}
+
+} // namespace services
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include "common/latency_histogram.h"
+
+namespace services {
+
+// When the background checkpointer runs
+struct CheckpointPolicy {
+    int interval_ms = 1000;               // PASSIVE at least this often while the WAL has frames
+    int64_t passive_bytes = 4LL << 20;    // PASSIVE as soon as the WAL holds this much
+    int64_t limit_bytes = 64LL << 20;     // beyond this, TRUNCATE (waits out readers, shrinks the file)
+    int busy_timeout_ms = 5000;           // how long an escalated checkpoint waits for readers
+};
+
+enum class CheckpointMode { Passive, Truncate };
+const char* checkpoint_mode_name(CheckpointMode mode);
+
+} // namespace services
+
+#if defined(HAVE_SQLITE3)
+#include <sqlite3.h>
+
+namespace services {
+
+// Moves WAL frames back into the database on its own thread and connection,
+// so no committing writer pays for a checkpoint inline. The writer reports
+// the WAL size after each commit through notify() (its wal hook, which also
+// turns SQLite's inline auto-checkpoint off). Routine checkpoints are
+// PASSIVE and never block anyone; when readers keep the WAL from being
+// reset and it passes the hard limit, the checkpointer escalates to
+// TRUNCATE, which waits for readers and shrinks the file.
+class SQLiteCheckpointer {
+public:
+    SQLiteCheckpointer(std::string db_path, CheckpointPolicy policy = {});
+    ~SQLiteCheckpointer();
+
+    // Non-copyable
+    SQLiteCheckpointer(const SQLiteCheckpointer&) = delete;
+    SQLiteCheckpointer& operator=(const SQLiteCheckpointer&) = delete;
+
+    // The database must already exist in WAL mode
+    bool start();
+    void stop();
+
+    // Pages in the WAL after a commit; callable from any thread, cheap
+    void notify(int wal_pages);
+    // Run one checkpoint now on the calling thread (false on error or busy)
+    bool checkpoint(CheckpointMode mode);
+
+    // Size of the -wal file at the last check
+    int64_t wal_bytes() const { return wal_bytes_.load(std::memory_order_relaxed); }
+    uint64_t count(CheckpointMode mode) const;
+
+    // Prometheus gauge "native_node_sqlite_wal_bytes" and histogram
+    // "native_node_sqlite_checkpoint_seconds{mode=...}"
+    void render_prometheus(std::ostream& out) const;
+
+private:
+    void run();
+    int64_t stat_wal() const;
+
+    std::string db_path_;
+    CheckpointPolicy policy_;
+    std::mutex db_mtx_; // the connection: background thread vs checkpoint() callers
+    sqlite3* db_ = nullptr;
+    int64_t page_size_ = 4096;
+    std::atomic<int> wal_pages_{ 0 };
+    std::atomic<bool> kick_{ false }; // WAL passed passive_bytes since the last wakeup
+    std::atomic<int64_t> wal_bytes_{ 0 };
+    std::array<common::LatencyHistogram, 2> hist_{};
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool running_ = false;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace services
+#else
+namespace services {
+// Stubbed fallback when SQLite3 development headers are not available
+class SQLiteCheckpointer {
+public:
+    explicit SQLiteCheckpointer(std::string /*db_path*/, CheckpointPolicy /*policy*/ = {}) {}
+    bool start() { return false; }
+    void stop() {}
+    void notify(int /*wal_pages*/) {}
+    bool checkpoint(CheckpointMode /*mode*/) { return false; }
+    int64_t wal_bytes() const { return 0; }
+    uint64_t count(CheckpointMode /*mode*/) const { return 0; }
+    void render_prometheus(std::ostream& /*out*/) const {}
+};
+} // namespace services
+#endif
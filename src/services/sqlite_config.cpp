@@ -0,0 +1,44 @@
+#include "sqlite_config.h"
+#include "common/key_value_config.h"
+#include <unistd.h>
+
+namespace services {
+
+static const char* SQLITE_CONF = "config/sqlite.conf";
+
+bool load_sqlite_config(const std::string& path, SQLiteConfig& cfg) {
+    SQLiteConfig parsed = cfg;
+    bool ok = common::read_key_value_config(path, "services/sqlite", [&parsed](const std::string& key, const std::vector<std::string>& values) {
+        if (values.size() != 1) return false;
+        const std::string& value = values[0];
+        if (key == "db_path") parsed.db_path = value;
+        else if (key == "readers") parsed.readers = std::stoul(value);
+        else if (key == "mmap_size") parsed.mmap_size = std::stoll(value);
+        else if (key == "cache_size") parsed.cache_size = std::stoll(value);
+        else if (key == "max_batch") parsed.max_batch = std::stoul(value);
+        else if (key == "busy_timeout_ms") parsed.busy_timeout_ms = std::stoi(value);
+        else if (key == "checkpoint_interval_ms") parsed.checkpoint_interval_ms = std::stoi(value);
+        else if (key == "checkpoint_bytes") parsed.checkpoint_bytes = std::stoll(value);
+        else if (key == "wal_limit_bytes") parsed.wal_limit_bytes = std::stoll(value);
+        else if (key == "query_cache_bytes") parsed.query_cache_bytes = std::stoul(value);
+        else if (key == "query_cache_entry_bytes") parsed.query_cache_entry_bytes = std::stoul(value);
+        else if (key == "synchronous") {
+            if (value != "OFF" && value != "NORMAL" && value != "FULL" && value != "EXTRA") return false;
+            parsed.synchronous = value;
+        } else return false;
+        return true;
+    });
+    if (!ok) return false;
+    if (parsed.readers == 0) parsed.readers = 1;
+    if (parsed.max_batch == 0) parsed.max_batch = 1;
+    cfg = std::move(parsed);
+    return true;
+}
+
+SQLiteConfig configured_sqlite() {
+    SQLiteConfig cfg;
+    if (access(SQLITE_CONF, R_OK) == 0) load_sqlite_config(SQLITE_CONF, cfg);
+    return cfg;
+}
+
+} // namespace services
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace services {
+
+// Settings from config/sqlite.conf
+struct SQLiteConfig {
+    std::string db_path = "./data/native_node.db";
+    size_t readers = 4;
+    int64_t mmap_size = 256LL << 20;
+    int64_t cache_size = -16384; // PRAGMA cache_size: negative is KiB
+    std::string synchronous = "NORMAL";
+    size_t max_batch = 256;
+    int busy_timeout_ms = 5000;
+    int checkpoint_interval_ms = 1000; // 0 = no checkpointer, SQLite checkpoints inline
+    int64_t checkpoint_bytes = 4LL << 20;
+    int64_t wal_limit_bytes = 64LL << 20;
+    size_t query_cache_bytes = 32 << 20; // 0 = no query result cache
+    size_t query_cache_entry_bytes = 1 << 20;
+};
+
+// Parse a SQLite config file into `cfg` (unchanged on error)
+bool load_sqlite_config(const std::string& path, SQLiteConfig& cfg);
+
+// config/sqlite.conf if readable, defaults otherwise
+SQLiteConfig configured_sqlite();
+
+} // namespace services
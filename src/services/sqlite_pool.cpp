@@ -7,8 +7,17 @@
 
 namespace services {
 
-SQLiteConnectionPool::SQLiteConnectionPool(const std::string& db_path, size_t pool_size)
-    : db_path_(db_path), pool_size_(pool_size) {}
+static std::atomic<uint64_t> g_next_pool_id{ 1 };
+
+// The slot this thread used last, for the pool with that id
+struct AffinityHint {
+    uint64_t pool = 0;
+    uint32_t slot = 0;
+};
+static thread_local AffinityHint t_hint;
+
+SQLiteConnectionPool::SQLiteConnectionPool(const std::string& db_path, size_t pool_size, SQLitePoolOptions opts)
+    : db_path_(db_path), pool_size_(pool_size), opts_(opts), id_(g_next_pool_id++) {}
 
 SQLiteConnectionPool::~SQLiteConnectionPool() {
     shutdown();
@@ -18,82 +27,205 @@ bool SQLiteConnectionPool::initialize() {
     std::lock_guard<std::mutex> lk(mtx_);
     if (initialized_) return true;
 
-    conns_.resize(pool_size_, nullptr);
-    in_use_.assign(pool_size_, false);
-
+    std::vector<std::unique_ptr<Slot>> slots;
+    auto close_all = [&slots]() {
+        for (auto& s : slots) if (s->conn) sqlite3_close(s->conn);
+    };
     for (size_t i = 0; i < pool_size_; ++i) {
         sqlite3* db = nullptr;
-        int rc = sqlite3_open(db_path_.c_str(), &db);
+        int flags = opts_.read_only ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+        int rc = sqlite3_open_v2(db_path_.c_str(), &db, flags | SQLITE_OPEN_NOMUTEX, nullptr);
         if (rc != SQLITE_OK) {
             std::cerr << "[sqlite_pool] failed to open db: " << sqlite3_errstr(rc) << std::endl;
-            // close previously opened
-            for (auto c : conns_) if (c) sqlite3_close(c);
+            sqlite3_close(db);
+            close_all();
             return false;
         }
+        if (opts_.busy_timeout_ms > 0) sqlite3_busy_timeout(db, opts_.busy_timeout_ms);
 
-        // Enable WAL mode
+        // Enable WAL mode, then the tuning pragmas
+        std::string pragmas = opts_.read_only ? "" : "PRAGMA journal_mode=WAL;";
+        if (!opts_.auto_checkpoint) pragmas += "PRAGMA wal_autocheckpoint=0;";
+        if (opts_.mmap_size) pragmas += "PRAGMA mmap_size=" + std::to_string(opts_.mmap_size) + ";";
+        if (opts_.cache_size) pragmas += "PRAGMA cache_size=" + std::to_string(opts_.cache_size) + ";";
         char* errmsg = nullptr;
-        rc = sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, &errmsg);
+        rc = sqlite3_exec(db, pragmas.c_str(), nullptr, nullptr, &errmsg);
         if (rc != SQLITE_OK) {
-            std::cerr << "[sqlite_pool] failed to set WAL mode: " << (errmsg ? errmsg : "") << std::endl;
+            std::cerr << "[sqlite_pool] failed to configure connection: " << (errmsg ? errmsg : "") << std::endl;
             if (errmsg) sqlite3_free(errmsg);
             sqlite3_close(db);
-            for (auto c : conns_) if (c) sqlite3_close(c);
+            close_all();
             return false;
         }
 
-        conns_[i] = db;
+        slots.push_back(std::make_unique<Slot>());
+        slots.back()->conn = db;
+        slots.back()->statements = std::make_unique<StatementCache>(db, opts_.statement_cache);
     }
 
+    slots_ = std::move(slots);
+    head_ = 0;
+    for (uint32_t i = 0; i < slots_.size(); ++i) {
+        slots_[i]->in_stack = true;
+        push(i);
+    }
     initialized_ = true;
-    std::cout << "[sqlite_pool] initialized with " << pool_size_ << " connections (WAL enabled)" << std::endl;
+    std::cout << "[sqlite_pool] initialized with " << pool_size_ << (opts_.read_only ? " read-only" : "")
+              << " connections (WAL enabled)" << std::endl;
     return true;
 }
 
 void SQLiteConnectionPool::shutdown() {
     std::lock_guard<std::mutex> lk(mtx_);
-    for (auto c : conns_) {
-        if (c) sqlite3_close(c);
+    for (auto& s : slots_) {
+        s->statements.reset(); // finalize before closing
+        if (s->conn) sqlite3_close(s->conn);
     }
-    conns_.clear();
-    in_use_.clear();
+    slots_.clear();
+    head_ = 0;
     initialized_ = false;
 }
 
-sqlite3* SQLiteConnectionPool::acquire() {
-    std::unique_lock<std::mutex> lk(mtx_);
-    cv_.wait(lk, [this]() {
-        for (bool b : in_use_) if (!b) return true; return false;
-    });
-    for (size_t i = 0; i < conns_.size(); ++i) {
-        if (!in_use_[i]) {
-            in_use_[i] = true;
-            return conns_[i];
+void SQLiteConnectionPool::push(uint32_t slot) {
+    Slot& s = *slots_[slot];
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    for (;;) {
+        s.next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        uint64_t next = ((head >> 32) + 1) << 32 | (slot + 1);
+        // seq_cst: see release()
+        if (head_.compare_exchange_weak(head, next, std::memory_order_seq_cst, std::memory_order_relaxed)) return;
+    }
+}
+
+bool SQLiteConnectionPool::pop(uint32_t& slot) {
+    // seq_cst: see release()
+    uint64_t head = head_.load(std::memory_order_seq_cst);
+    for (;;) {
+        uint32_t top = static_cast<uint32_t>(head);
+        if (top == 0) return false;
+        // A stale `next` read is harmless: the tag makes the CAS fail
+        uint32_t below = slots_[top - 1]->next.load(std::memory_order_relaxed);
+        uint64_t next = ((head >> 32) + 1) << 32 | below;
+        if (head_.compare_exchange_weak(head, next, std::memory_order_seq_cst, std::memory_order_seq_cst)) {
+            slot = top - 1;
+            return true;
         }
     }
-    return nullptr; // should not reach
 }
 
-void SQLiteConnectionPool::release(sqlite3* conn) {
-    std::lock_guard<std::mutex> lk(mtx_);
-    for (size_t i = 0; i < conns_.size(); ++i) {
-        if (conns_[i] == conn) {
-            in_use_[i] = false;
-            cv_.notify_one();
-            return;
+// A slot is taken by flipping `busy`. It may still be on the stack (taken
+// through the affinity hint); whoever pops it then finds it busy and drops
+// it, and its next release pushes it again. `in_stack` keeps each slot on
+// the stack at most once.
+bool SQLiteConnectionPool::try_acquire(uint32_t& slot) {
+    if (t_hint.pool == id_ && t_hint.slot < slots_.size()) {
+        bool expected = false;
+        if (slots_[t_hint.slot]->busy.compare_exchange_strong(expected, true)) {
+            affinity_hits_.fetch_add(1, std::memory_order_relaxed);
+            slot = t_hint.slot;
+            return true;
+        }
+    }
+    uint32_t popped;
+    while (pop(popped)) {
+        Slot& s = *slots_[popped];
+        s.in_stack.store(false);
+        bool expected = false;
+        if (s.busy.compare_exchange_strong(expected, true)) {
+            t_hint = AffinityHint{ id_, popped };
+            slot = popped;
+            return true;
         }
     }
+    return false;
 }
 
-// SQLiteConnHandle
-SQLiteConnHandle::SQLiteConnHandle(SQLiteConnectionPool& pool, sqlite3* conn)
-    : pool_(pool), conn_(conn) {}
+SQLiteConnHandle SQLiteConnectionPool::acquire(std::chrono::milliseconds timeout) {
+    uint32_t slot;
+    if (try_acquire(slot)) return SQLiteConnHandle(this, slots_[slot]->conn, slot);
+
+    // Exhausted: wait for a release
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lk(mtx_);
+    waiters_.fetch_add(1, std::memory_order_seq_cst); // before the pop below; see release()
+    bool got = false;
+    while (!(got = try_acquire(slot))) {
+        if (timeout.count() < 0) {
+            cv_.wait(lk);
+        } else if (cv_.wait_until(lk, deadline) == std::cv_status::timeout) {
+            got = try_acquire(slot);
+            break;
+        }
+    }
+    --waiters_;
+    if (!got) return {};
+    return SQLiteConnHandle(this, slots_[slot]->conn, slot);
+}
+
+uint64_t SQLiteConnectionPool::statement_hits() const {
+    uint64_t n = 0;
+    for (auto& s : slots_) n += s->statements->hits();
+    return n;
+}
+
+uint64_t SQLiteConnectionPool::statement_misses() const {
+    uint64_t n = 0;
+    for (auto& s : slots_) n += s->statements->misses();
+    return n;
+}
 
+void SQLiteConnectionPool::release(uint32_t slot) {
+    Slot& s = *slots_[slot];
+    s.busy.store(false);
+    bool expected = false;
+    if (s.in_stack.compare_exchange_strong(expected, true)) push(slot);
+    // A waiter increments waiters_ and then reads head_; we wrote head_ and
+    // now read waiters_. Both pairs are seq_cst, so at least one side sees
+    // the other: either the waiter pops this slot or we wake it. With
+    // release/acquire both could read the old values and the waiter would
+    // sleep until its timeout with a free connection on the stack.
+    if (waiters_.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        cv_.notify_one();
+    }
+}
+
+// SQLiteConnHandle
 SQLiteConnHandle::~SQLiteConnHandle() {
-    if (conn_) pool_.release(conn_);
+    release();
 }
 
-sqlite3* SQLiteConnHandle::get() { return conn_; }
+SQLiteConnHandle::SQLiteConnHandle(SQLiteConnHandle&& other) noexcept
+    : pool_(other.pool_), conn_(other.conn_), slot_(other.slot_) {
+    other.pool_ = nullptr;
+    other.conn_ = nullptr;
+}
+
+SQLiteConnHandle& SQLiteConnHandle::operator=(SQLiteConnHandle&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        conn_ = other.conn_;
+        slot_ = other.slot_;
+        other.pool_ = nullptr;
+        other.conn_ = nullptr;
+    }
+    return *this;
+}
+
+CachedStatement SQLiteConnHandle::prepare(const std::string& sql) {
+    if (!pool_ || !conn_) return {};
+    return pool_->slots_[slot_]->statements->prepare(sql);
+}
+
+void SQLiteConnHandle::release() {
+    // A BEGIN left open would pin this reader to an old snapshot and keep
+    // the WAL from being reset for whoever acquires it next
+    if (conn_ && !sqlite3_get_autocommit(conn_)) sqlite3_exec(conn_, "ROLLBACK", nullptr, nullptr, nullptr);
+    if (pool_ && conn_) pool_->release(slot_);
+    pool_ = nullptr;
+    conn_ = nullptr;
+}
 
 } // namespace services
 #endif
@@ -3,68 +3,155 @@
 #include <string>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <vector>
+
+namespace services {
+
+// Per-connection tuning of a pool
+struct SQLitePoolOptions {
+    bool read_only = false;  // SQLITE_OPEN_READONLY; the database must exist and is not switched to WAL
+    int64_t mmap_size = 0;   // PRAGMA mmap_size (0 = leave default)
+    int64_t cache_size = 0;  // PRAGMA cache_size (0 = leave default, negative = KiB)
+    int busy_timeout_ms = 0; // sqlite3_busy_timeout (0 = fail on a lock immediately)
+    size_t statement_cache = 64; // prepared statements kept per connection (0 = none)
+    bool auto_checkpoint = true; // false: PRAGMA wal_autocheckpoint=0, a SQLiteCheckpointer does it
+};
+
+} // namespace services
+
 #if defined(HAVE_SQLITE3)
 #include <sqlite3.h>
+#include "sqlite_statement_cache.h"
 
 namespace services {
 
-// A simple fixed-size SQLite connection pool that opens multiple connections
-// to the same database file and sets WAL mode on each connection.
+class SQLiteConnectionPool;
+
+// RAII handle that returns its connection to the pool on destruction.
+// Empty (false) when acquire() timed out.
+class SQLiteConnHandle {
+public:
+    SQLiteConnHandle() = default;
+    ~SQLiteConnHandle();
+
+    // Moveable
+    SQLiteConnHandle(SQLiteConnHandle&& other) noexcept;
+    SQLiteConnHandle& operator=(SQLiteConnHandle&& other) noexcept;
+
+    sqlite3* get() const { return conn_; }
+    explicit operator bool() const { return conn_ != nullptr; }
+    // Prepared statement for `sql` from this connection's cache; release it
+    // before the handle
+    CachedStatement prepare(const std::string& sql);
+    // Return the connection now
+    void release();
+
+private:
+    friend class SQLiteConnectionPool;
+    SQLiteConnHandle(SQLiteConnectionPool* pool, sqlite3* conn, uint32_t slot) : pool_(pool), conn_(conn), slot_(slot) {}
+
+    SQLiteConnectionPool* pool_ = nullptr;
+    sqlite3* conn_ = nullptr;
+    uint32_t slot_ = 0;
+};
+
+// A fixed-size SQLite connection pool that opens multiple connections to the
+// same database file and sets WAL mode on each connection (read-only pools
+// expect a writer to have done that).
+//
+// Free connections sit on a lock-free stack of slot indices (tagged against
+// ABA), so acquire and release are O(1) and take no lock unless the pool is
+// exhausted and a caller has to wait. Each thread first tries the slot it
+// used last, which usually hands it back the same connection with its
+// statement cache still warm and keeps it off the shared stack head.
 class SQLiteConnectionPool {
 public:
-    explicit SQLiteConnectionPool(const std::string& db_path, size_t pool_size = 4);
+    explicit SQLiteConnectionPool(const std::string& db_path, size_t pool_size = 4, SQLitePoolOptions opts = {});
     ~SQLiteConnectionPool();
 
+    // Non-copyable
+    SQLiteConnectionPool(const SQLiteConnectionPool&) = delete;
+    SQLiteConnectionPool& operator=(const SQLiteConnectionPool&) = delete;
+
     // Initialize the pool (open connections and set PRAGMA journal_mode=WAL)
     bool initialize();
+    // Close every connection; no handle may be outstanding
     void shutdown();
 
-    // Acquire a sqlite3* connection from the pool. Blocks until available.
-    sqlite3* acquire();
-    // Release a connection back to the pool
-    void release(sqlite3* conn);
+    // Acquire a connection, waiting up to `timeout` (negative: forever) for
+    // one to be released. The handle is empty on timeout.
+    SQLiteConnHandle acquire(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+    size_t size() const { return slots_.size(); }
+    // Acquisitions served by the calling thread's previous connection
+    uint64_t affinity_hits() const { return affinity_hits_.load(std::memory_order_relaxed); }
+    // Statement cache lookups across all connections
+    uint64_t statement_hits() const;
+    uint64_t statement_misses() const;
 
 private:
+    friend class SQLiteConnHandle;
+
+    struct Slot {
+        sqlite3* conn = nullptr;
+        std::unique_ptr<StatementCache> statements;
+        std::atomic<bool> busy{ false };
+        std::atomic<bool> in_stack{ false };
+        std::atomic<uint32_t> next{ 0 }; // index + 1 of the slot below on the stack, 0 = bottom
+    };
+
+    bool try_acquire(uint32_t& slot);
+    bool pop(uint32_t& slot);
+    void push(uint32_t slot);
+    void release(uint32_t slot);
+
     std::string db_path_;
     size_t pool_size_;
-    std::vector<sqlite3*> conns_;
-    std::vector<bool> in_use_;
+    SQLitePoolOptions opts_;
+    uint64_t id_; // distinguishes pools in the per-thread affinity hint
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::atomic<uint64_t> head_{ 0 }; // ABA tag << 32 | top slot index + 1
+    std::atomic<uint64_t> affinity_hits_{ 0 };
+
+    // Slow path only: callers waiting for an exhausted pool
     std::mutex mtx_;
     std::condition_variable cv_;
+    std::atomic<size_t> waiters_{ 0 };
     bool initialized_ = false;
 };
 
-// RAII handle that returns connection to pool on destruction
-class SQLiteConnHandle {
-public:
-    SQLiteConnHandle(SQLiteConnectionPool& pool, sqlite3* conn);
-    ~SQLiteConnHandle();
-    sqlite3* get();
-private:
-    SQLiteConnectionPool& pool_;
-    sqlite3* conn_ = nullptr;
-};
-
 } // namespace services
 #else
 namespace services {
 // Stubbed fallback when SQLite3 development headers are not available
+class CachedStatement {
+public:
+    void* get() const { return nullptr; }
+    explicit operator bool() const { return false; }
+    void release() {}
+};
+class SQLiteConnHandle {
+public:
+    void* get() const { return nullptr; }
+    explicit operator bool() const { return false; }
+    CachedStatement prepare(const std::string& /*sql*/) { return {}; }
+    void release() {}
+};
 class SQLiteConnectionPool {
 public:
-    explicit SQLiteConnectionPool(const std::string& /*db_path*/, size_t /*pool_size*/ = 4) {}
+    explicit SQLiteConnectionPool(const std::string& /*db_path*/, size_t /*pool_size*/ = 4, SQLitePoolOptions /*opts*/ = {}) {}
     ~SQLiteConnectionPool() {}
     bool initialize() { return false; }
     void shutdown() {}
-    void* acquire() { return nullptr; }
-    void release(void* /*conn*/) {}
-};
-class SQLiteConnHandle {
-public:
-    SQLiteConnHandle(SQLiteConnectionPool& /*pool*/, void* /*conn*/) {}
-    ~SQLiteConnHandle() {}
-    void* get() { return nullptr; }
+    SQLiteConnHandle acquire(std::chrono::milliseconds /*timeout*/ = std::chrono::milliseconds(-1)) { return {}; }
+    size_t size() const { return 0; }
+    uint64_t affinity_hits() const { return 0; }
+    uint64_t statement_hits() const { return 0; }
+    uint64_t statement_misses() const { return 0; }
 };
 } // namespace services
 #endif
@@ -0,0 +1,113 @@
+// Only compile the real implementation when SQLite3 headers are available
+#if defined(HAVE_SQLITE3)
+#include "sqlite_query_guard.h"
+#include "query_cache.h"
+#include <algorithm>
+#include <iostream>
+
+namespace services {
+
+ReadQueryGuard::ReadQueryGuard(std::string db_path) : db_path_(std::move(db_path)) {}
+
+ReadQueryGuard::~ReadQueryGuard() {
+    sqlite3_close(db_);
+}
+
+bool ReadQueryGuard::open() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (db_) return true;
+    int rc = sqlite3_open_v2(db_path_.c_str(), &db_, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "[sqlite_query_guard] failed to open db: " << sqlite3_errstr(rc) << std::endl;
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+    sqlite3_set_authorizer(db_, authorize, this);
+    return true;
+}
+
+static void add_once(std::vector<std::string>& names, const char* name) {
+    if (std::find(names.begin(), names.end(), name) == names.end()) names.emplace_back(name);
+}
+
+int ReadQueryGuard::authorize(void* arg, int action, const char* a1, const char* a2, const char*, const char*) {
+    Scan* scan = static_cast<ReadQueryGuard*>(arg)->scan_;
+    if (!scan) return SQLITE_OK;
+    switch (action) {
+    case SQLITE_TRANSACTION: scan->denied = "transaction control is not allowed"; return SQLITE_DENY;
+    case SQLITE_SAVEPOINT: scan->denied = "savepoints are not allowed"; return SQLITE_DENY;
+    case SQLITE_ATTACH:
+    case SQLITE_DETACH: scan->denied = "ATTACH and DETACH are not allowed"; return SQLITE_DENY;
+    case SQLITE_PRAGMA: scan->denied = "PRAGMA is not allowed"; return SQLITE_DENY;
+    case SQLITE_READ:
+        if (a1) add_once(scan->info.tables, a1);
+        break;
+    case SQLITE_FUNCTION:
+        if (a2) add_once(scan->info.functions, a2);
+        break;
+    }
+    return SQLITE_OK;
+}
+
+bool ReadQueryGuard::check(const std::string& sql, std::string& error, ReadQueryInfo* info) {
+    std::string key = QueryCache::key(sql, {});
+    {
+        std::shared_lock<std::shared_mutex> lk(verdicts_mtx_);
+        auto it = accepted_.find(key);
+        if (it != accepted_.end()) {
+            if (info) *info = it->second;
+            return true;
+        }
+    }
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (!db_) {
+        error = "database not available";
+        return false;
+    }
+    prepares_.fetch_add(1, std::memory_order_relaxed);
+    // Preparing alone never notices schema changes made by the writer (a new
+    // table, a dropped view); stepping a read does, and reloads the schema
+    sqlite3_exec(db_, "SELECT 1 FROM sqlite_master LIMIT 1;", nullptr, nullptr, nullptr);
+    Scan scan;
+    scan_ = &scan;
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_stmt* next = nullptr;
+    const char* tail = nullptr;
+    const char* end = sql.data() + sql.size();
+    int rc = sqlite3_prepare_v2(db_, sql.data(), static_cast<int>(sql.size()), &stmt, &tail);
+    // Only whitespace and comments may follow: they prepare to no statement
+    if (rc == SQLITE_OK && stmt && tail && tail < end) {
+        rc = sqlite3_prepare_v2(db_, tail, static_cast<int>(end - tail), &next, nullptr);
+    }
+    scan_ = nullptr;
+
+    bool ok = false;
+    if (scan.denied) error = scan.denied;
+    else if (rc != SQLITE_OK) error = sqlite3_errmsg(db_);
+    else if (!stmt) error = "empty statement";
+    else if (next) error = "only one statement is allowed";
+    else if (!sqlite3_stmt_readonly(stmt) || sqlite3_column_count(stmt) == 0) error = "only SELECT statements are allowed";
+    else ok = true;
+    sqlite3_finalize(stmt);
+    sqlite3_finalize(next);
+    if (!ok) return false;
+    // Rejections are not remembered: a missing table may be created later
+    {
+        std::unique_lock<std::shared_mutex> vlk(verdicts_mtx_);
+        if (accepted_.size() >= MAX_VERDICTS) accepted_.clear();
+        accepted_[key] = scan.info;
+    }
+    if (info) *info = std::move(scan.info);
+    return true;
+}
+
+void ReadQueryGuard::invalidate(const std::vector<std::string>& tables) {
+    if (std::find(tables.begin(), tables.end(), QueryCache::ALL_TABLES) == tables.end()) return;
+    std::unique_lock<std::shared_mutex> lk(verdicts_mtx_);
+    accepted_.clear();
+}
+
+} // namespace services
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace services {
+
+// What a statement accepted by ReadQueryGuard reads
+struct ReadQueryInfo {
+    std::vector<std::string> tables;    // tables and views, each once
+    std::vector<std::string> functions; // SQL functions called, each once
+};
+
+} // namespace services
+
+#if defined(HAVE_SQLITE3)
+#include <sqlite3.h>
+
+namespace services {
+
+// Vets SQL from untrusted callers before it runs on a pooled reader. Each
+// statement is prepared once on a private read-only connection that has an
+// authorizer installed for good. The pool's connections have no authorizer,
+// so their cached statements are never expired by it.
+//
+// Accepted: exactly one read-only statement that returns rows (SELECT or
+// WITH), with nothing after it but whitespace and comments. Rejected:
+// transaction control (BEGIN, SAVEPOINT), which would leave a reader pinned
+// to an old snapshot. Also rejected are ATTACH/DETACH, which would open
+// arbitrary files, and PRAGMA.
+//
+// Accepted statements are remembered under their QueryCache::key, so a
+// repeated query (however it is spaced or commented) is not prepared again
+// here. The verdicts are dropped when the schema changes: report changed
+// tables through invalidate(), as the SQLiteWriter does for the query cache.
+class ReadQueryGuard {
+public:
+    explicit ReadQueryGuard(std::string db_path);
+    ~ReadQueryGuard();
+
+    // Non-copyable
+    ReadQueryGuard(const ReadQueryGuard&) = delete;
+    ReadQueryGuard& operator=(const ReadQueryGuard&) = delete;
+
+    bool open();
+    // False with `error` set if `sql` is not accepted
+    bool check(const std::string& sql, std::string& error, ReadQueryInfo* info = nullptr);
+
+    // Forget every verdict if `tables` holds QueryCache::ALL_TABLES
+    void invalidate(const std::vector<std::string>& tables);
+
+    // Statements prepared on the guard connection (cache misses)
+    uint64_t prepares() const { return prepares_.load(std::memory_order_relaxed); }
+
+private:
+    struct Scan {
+        ReadQueryInfo info;
+        const char* denied = nullptr;
+    };
+    static int authorize(void* arg, int action, const char* a1, const char* a2, const char* a3, const char* a4);
+
+    std::string db_path_;
+    std::mutex mtx_;
+    sqlite3* db_ = nullptr;
+    Scan* scan_ = nullptr; // the check in progress
+    std::atomic<uint64_t> prepares_{ 0 };
+
+    static constexpr size_t MAX_VERDICTS = 4096;
+    std::shared_mutex verdicts_mtx_;
+    std::unordered_map<std::string, ReadQueryInfo> accepted_; // QueryCache::key -> what it reads
+};
+
+} // namespace services
+#else
+namespace services {
+// Stubbed fallback when SQLite3 development headers are not available
+class ReadQueryGuard {
+public:
+    explicit ReadQueryGuard(std::string /*db_path*/) {}
+    bool open() { return false; }
+    bool check(const std::string& /*sql*/, std::string& error, ReadQueryInfo* /*info*/ = nullptr) {
+        error = "database not available";
+        return false;
+    }
+    void invalidate(const std::vector<std::string>& /*tables*/) {}
+    uint64_t prepares() const { return 0; }
+};
+} // namespace services
+#endif
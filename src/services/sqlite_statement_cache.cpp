@@ -0,0 +1,81 @@
+// Only compile the real implementation when SQLite3 headers are available
+#if defined(HAVE_SQLITE3)
+#include "sqlite_statement_cache.h"
+#include <iostream>
+
+namespace services {
+
+CachedStatement StatementCache::prepare(const std::string& sql) {
+    auto it = index_.find(sql);
+    if (it != index_.end()) {
+        sqlite3_stmt* stmt = it->second->second;
+        lru_.erase(it->second);
+        index_.erase(it);
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return CachedStatement(this, sql, stmt);
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    sqlite3_stmt* stmt = nullptr;
+    // PERSISTENT: the statement is expected to live long
+    int rc = sqlite3_prepare_v3(db_, sql.data(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "[sqlite_pool] prepare failed: " << sqlite3_errmsg(db_) << std::endl;
+        sqlite3_finalize(stmt);
+        return {};
+    }
+    return CachedStatement(this, sql, stmt);
+}
+
+void StatementCache::give_back(std::string sql, sqlite3_stmt* stmt) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    if (capacity_ == 0 || index_.count(sql)) {
+        sqlite3_finalize(stmt);
+        return;
+    }
+    lru_.emplace_front(std::move(sql), stmt);
+    index_[lru_.front().first] = lru_.begin();
+    if (lru_.size() > capacity_) {
+        index_.erase(lru_.back().first);
+        sqlite3_finalize(lru_.back().second);
+        lru_.pop_back();
+    }
+}
+
+void StatementCache::clear() {
+    for (auto& e : lru_) sqlite3_finalize(e.second);
+    lru_.clear();
+    index_.clear();
+}
+
+// CachedStatement
+CachedStatement::~CachedStatement() {
+    release();
+}
+
+CachedStatement::CachedStatement(CachedStatement&& other) noexcept
+    : cache_(other.cache_), sql_(std::move(other.sql_)), stmt_(other.stmt_) {
+    other.cache_ = nullptr;
+    other.stmt_ = nullptr;
+}
+
+CachedStatement& CachedStatement::operator=(CachedStatement&& other) noexcept {
+    if (this != &other) {
+        release();
+        cache_ = other.cache_;
+        sql_ = std::move(other.sql_);
+        stmt_ = other.stmt_;
+        other.cache_ = nullptr;
+        other.stmt_ = nullptr;
+    }
+    return *this;
+}
+
+void CachedStatement::release() {
+    if (cache_ && stmt_) cache_->give_back(std::move(sql_), stmt_);
+    cache_ = nullptr;
+    stmt_ = nullptr;
+}
+
+} // namespace services
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#if defined(HAVE_SQLITE3)
+#include <sqlite3.h>
+
+namespace services {
+
+class StatementCache;
+
+// RAII handle to a prepared statement borrowed from a StatementCache. The
+// statement arrives reset with no bindings and goes back to the cache
+// (reset and cleared again) on destruction. Empty (false) when preparing
+// failed. Must not outlive the connection handle it came from.
+class CachedStatement {
+public:
+    CachedStatement() = default;
+    ~CachedStatement();
+
+    // Moveable
+    CachedStatement(CachedStatement&& other) noexcept;
+    CachedStatement& operator=(CachedStatement&& other) noexcept;
+
+    sqlite3_stmt* get() const { return stmt_; }
+    explicit operator bool() const { return stmt_ != nullptr; }
+    // Give the statement back now
+    void release();
+
+private:
+    friend class StatementCache;
+    CachedStatement(StatementCache* cache, std::string sql, sqlite3_stmt* stmt)
+        : cache_(cache), sql_(std::move(sql)), stmt_(stmt) {}
+
+    StatementCache* cache_ = nullptr;
+    std::string sql_;
+    sqlite3_stmt* stmt_ = nullptr;
+};
+
+// LRU of prepared statements for one connection, keyed by SQL text. Only the
+// thread holding the connection uses it; the counters may be read from
+// anywhere. A statement that is checked out is not in the cache, so using the
+// same SQL twice at once prepares a second copy and the spare is finalized
+// when both come back.
+class StatementCache {
+public:
+    StatementCache(sqlite3* db, size_t capacity) : db_(db), capacity_(capacity) {}
+    ~StatementCache() { clear(); }
+
+    // Non-copyable
+    StatementCache(const StatementCache&) = delete;
+    StatementCache& operator=(const StatementCache&) = delete;
+
+    // Cached statement for `sql`, prepared on a miss
+    CachedStatement prepare(const std::string& sql);
+    // Finalize every cached statement (none may be checked out)
+    void clear();
+
+    size_t size() const { return lru_.size(); }
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+private:
+    friend class CachedStatement;
+    using Entry = std::pair<std::string, sqlite3_stmt*>;
+
+    void give_back(std::string sql, sqlite3_stmt* stmt);
+
+    sqlite3* db_;
+    size_t capacity_;
+    std::list<Entry> lru_; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    std::atomic<uint64_t> hits_{ 0 };
+    std::atomic<uint64_t> misses_{ 0 };
+};
+
+} // namespace services
+#endif
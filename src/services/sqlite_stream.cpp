@@ -0,0 +1,129 @@
+// Only compile the real implementation when SQLite3 headers are available
+#if defined(HAVE_SQLITE3)
+#include "sqlite_stream.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace services {
+
+static void append_json_string(std::string& out, const char* s, size_t len) {
+    static const char* HEX = "0123456789abcdef";
+    out += '"';
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                out += "\\u00";
+                out += HEX[c >> 4];
+                out += HEX[c & 0xf];
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+    }
+    out += '"';
+}
+
+static void append_base64(std::string& out, const unsigned char* p, size_t len) {
+    static const char* B64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    out += '"';
+    size_t i = 0;
+    for (; i + 2 < len; i += 3) {
+        uint32_t v = (uint32_t(p[i]) << 16) | (uint32_t(p[i + 1]) << 8) | p[i + 2];
+        out += B64[v >> 18];
+        out += B64[(v >> 12) & 63];
+        out += B64[(v >> 6) & 63];
+        out += B64[v & 63];
+    }
+    if (i < len) {
+        uint32_t v = uint32_t(p[i]) << 16;
+        if (i + 1 < len) v |= uint32_t(p[i + 1]) << 8;
+        out += B64[v >> 18];
+        out += B64[(v >> 12) & 63];
+        out += i + 1 < len ? B64[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+    out += '"';
+}
+
+static void append_value(std::string& out, sqlite3_stmt* stmt, int col) {
+    char num[32];
+    switch (sqlite3_column_type(stmt, col)) {
+    case SQLITE_INTEGER:
+        out.append(num, static_cast<size_t>(snprintf(num, sizeof(num), "%lld", sqlite3_column_int64(stmt, col))));
+        break;
+    case SQLITE_FLOAT: {
+        double d = sqlite3_column_double(stmt, col);
+        if (std::isfinite(d)) out.append(num, static_cast<size_t>(snprintf(num, sizeof(num), "%.17g", d)));
+        else out += "null";
+        break;
+    }
+    case SQLITE_TEXT: {
+        const char* s = reinterpret_cast<const char*>(sqlite3_column_text(stmt, col));
+        append_json_string(out, s, static_cast<size_t>(sqlite3_column_bytes(stmt, col)));
+        break;
+    }
+    case SQLITE_BLOB: {
+        const void* p = sqlite3_column_blob(stmt, col);
+        append_base64(out, static_cast<const unsigned char*>(p), static_cast<size_t>(sqlite3_column_bytes(stmt, col)));
+        break;
+    }
+    default:
+        out += "null";
+    }
+}
+
+bool stream_rows(sqlite3_stmt* stmt, RowFormat format, size_t flush_bytes, const ChunkSink& sink, std::string* error) {
+    // `"name":` of every column, encoded once
+    int cols = sqlite3_column_count(stmt);
+    std::vector<std::string> keys(static_cast<size_t>(cols));
+    for (int c = 0; c < cols; ++c) {
+        const char* name = sqlite3_column_name(stmt, c);
+        std::string& key = keys[static_cast<size_t>(c)];
+        append_json_string(key, name ? name : "", name ? strlen(name) : 0);
+        key += ':';
+    }
+
+    std::string buf;
+    buf.reserve(flush_bytes + 4096);
+    auto flush = [&]() {
+        bool ok = buf.empty() || sink(buf.data(), buf.size());
+        buf.clear();
+        return ok;
+    };
+
+    if (format == RowFormat::Json) buf += '[';
+    bool first = true;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (format == RowFormat::Json && !first) buf += ',';
+        first = false;
+        buf += '{';
+        for (int c = 0; c < cols; ++c) {
+            if (c) buf += ',';
+            buf += keys[static_cast<size_t>(c)];
+            append_value(buf, stmt, c);
+        }
+        buf += '}';
+        if (format == RowFormat::Ndjson) buf += '\n';
+        if (buf.size() >= flush_bytes && !flush()) return false;
+    }
+    if (rc != SQLITE_DONE) {
+        if (error) *error = sqlite3_errmsg(sqlite3_db_handle(stmt));
+        return false;
+    }
+    if (format == RowFormat::Json) buf += ']';
+    return flush();
+}
+
+} // namespace services
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace services {
+
+enum class RowFormat {
+    Json,   // one array of row objects
+    Ndjson  // one row object per line
+};
+
+// Receives encoded output in order; return false to stop (client gone)
+using ChunkSink = std::function<bool(const char* data, size_t size)>;
+
+} // namespace services
+
+#if defined(HAVE_SQLITE3)
+#include <sqlite3.h>
+
+namespace services {
+
+// Step `stmt` to the end, encoding each row as a JSON object keyed by column
+// name straight into a reused buffer that is handed to `sink` whenever it
+// reaches `flush_bytes` (and once more at the end). Nothing is kept per row,
+// so memory stays at about flush_bytes plus one row whatever the result
+// size. Integers and reals become numbers (non-finite reals null), text a
+// string, blobs base64 strings, NULL null.
+//
+// False if stepping failed (`error` says why) or the sink refused a chunk;
+// either way the output so far is incomplete.
+bool stream_rows(sqlite3_stmt* stmt, RowFormat format, size_t flush_bytes, const ChunkSink& sink,
+                 std::string* error = nullptr);
+
+} // namespace services
+#endif
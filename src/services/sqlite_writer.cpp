@@ -0,0 +1,171 @@
+// Only compile the real implementation when SQLite3 headers are available
+#if defined(HAVE_SQLITE3)
+#include "sqlite_writer.h"
+#include <iostream>
+#include <vector>
+
+namespace services {
+
+static bool exec(sqlite3* db, const char* sql) {
+    char* errmsg = nullptr;
+    int rc = sqlite3_exec(db, sql, nullptr, nullptr, &errmsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "[sqlite_writer] " << sql << ": " << (errmsg ? errmsg : sqlite3_errstr(rc)) << std::endl;
+        if (errmsg) sqlite3_free(errmsg);
+        return false;
+    }
+    return true;
+}
+
+SQLiteWriter::SQLiteWriter(std::string db_path, SQLiteWriterOptions opts)
+    : db_path_(std::move(db_path)), opts_(std::move(opts)) {}
+
+SQLiteWriter::~SQLiteWriter() {
+    stop();
+}
+
+bool SQLiteWriter::start() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (running_) return true;
+    int rc = sqlite3_open_v2(db_path_.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "[sqlite_writer] failed to open db: " << sqlite3_errstr(rc) << std::endl;
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+    sqlite3_busy_timeout(db_, opts_.busy_timeout_ms);
+    std::string pragmas = "PRAGMA journal_mode=WAL;PRAGMA synchronous=" + opts_.synchronous + ";";
+    if (opts_.cache_size) pragmas += "PRAGMA cache_size=" + std::to_string(opts_.cache_size) + ";";
+    if (!exec(db_, pragmas.c_str())) {
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+    if (opts_.on_wal_commit) {
+        // Replaces the hook behind wal_autocheckpoint
+        sqlite3_wal_hook(db_, [](void* arg, sqlite3*, const char*, int pages) {
+            static_cast<SQLiteWriter*>(arg)->opts_.on_wal_commit(pages);
+            return SQLITE_OK;
+        }, this);
+    }
+    if (opts_.on_tables_changed) {
+        // Row changes of rowid tables arrive through the update hook; the
+        // authorizer also sees WITHOUT ROWID tables, DELETEs that truncate
+        // and schema changes, which the update hook misses
+        sqlite3_update_hook(db_, [](void* arg, int, const char*, const char* table, sqlite3_int64) {
+            static_cast<SQLiteWriter*>(arg)->touched_.insert(table);
+        }, this);
+        sqlite3_set_authorizer(db_, [](void* arg, int action, const char* a1, const char*, const char*, const char*) {
+            auto& touched = static_cast<SQLiteWriter*>(arg)->touched_;
+            switch (action) {
+            case SQLITE_INSERT:
+            case SQLITE_UPDATE:
+            case SQLITE_DELETE:
+                if (a1) touched.insert(a1);
+                break;
+            case SQLITE_ALTER_TABLE:
+            case SQLITE_DROP_TABLE:
+            case SQLITE_DROP_VIEW:
+                touched.insert("*");
+                break;
+            }
+            return SQLITE_OK;
+        }, this);
+    }
+    running_ = true;
+    stopping_ = false;
+    thread_ = std::thread(&SQLiteWriter::run, this);
+    std::cout << "[sqlite_writer] started (synchronous=" << opts_.synchronous << ", batches of up to "
+              << opts_.max_batch << ")" << std::endl;
+    return true;
+}
+
+void SQLiteWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!running_) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+    std::lock_guard<std::mutex> lk(mtx_);
+    sqlite3_close(db_);
+    db_ = nullptr;
+    running_ = false;
+}
+
+std::future<bool> SQLiteWriter::submit(Transaction txn) {
+    Job job{ std::move(txn), {} };
+    auto fut = job.done.get_future();
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!running_ || stopping_) {
+            job.done.set_value(false);
+            return fut;
+        }
+        queue_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+    return fut;
+}
+
+std::future<bool> SQLiteWriter::execute(std::string sql) {
+    return submit([sql = std::move(sql)](sqlite3* db) { return exec(db, sql.c_str()); });
+}
+
+void SQLiteWriter::run() {
+    std::deque<Job> group;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            cv_.wait(lk, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return; // stopping with nothing left
+            // Everything that queued up while the last group committed goes
+            // into this one, up to max_batch
+            while (!queue_.empty() && group.size() < opts_.max_batch) {
+                group.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+        commit_group(group);
+        group.clear();
+    }
+}
+
+void SQLiteWriter::commit_group(std::deque<Job>& group) {
+    std::vector<bool> ok(group.size(), false);
+    touched_.clear();
+    if (!exec(db_, "BEGIN IMMEDIATE")) {
+        for (auto& job : group) job.done.set_value(false);
+        return;
+    }
+    size_t applied = 0;
+    for (size_t i = 0; i < group.size(); ++i) {
+        if (!exec(db_, "SAVEPOINT txn")) continue;
+        try {
+            ok[i] = group[i].txn(db_);
+        } catch (const std::exception& e) {
+            std::cerr << "[sqlite_writer] transaction threw: " << e.what() << std::endl;
+        }
+        if (!ok[i]) exec(db_, "ROLLBACK TO txn");
+        exec(db_, "RELEASE txn");
+        if (ok[i]) ++applied;
+    }
+    bool committed = exec(db_, "COMMIT");
+    if (committed) {
+        ++commits_;
+        transactions_ += applied;
+        // Only now can readers see the changes
+        if (opts_.on_tables_changed && !touched_.empty()) {
+            opts_.on_tables_changed(std::vector<std::string>(touched_.begin(), touched_.end()));
+        }
+    } else {
+        exec(db_, "ROLLBACK");
+    }
+    touched_.clear();
+    for (size_t i = 0; i < group.size(); ++i) group[i].done.set_value(committed && ok[i]);
+}
+
+} // namespace services
+#endif
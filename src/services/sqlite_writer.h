@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <future>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <set>
+#include <vector>
+
+namespace services {
+
+struct SQLiteWriterOptions {
+    std::string synchronous = "NORMAL"; // OFF | NORMAL | FULL | EXTRA
+    size_t max_batch = 256;             // most transactions per commit
+    int busy_timeout_ms = 5000;
+    int64_t cache_size = 0;             // PRAGMA cache_size (0 = leave default)
+    // Called with the WAL size in pages after each commit. Setting it turns
+    // SQLite's inline auto-checkpoint off (see SQLiteCheckpointer).
+    std::function<void(int)> on_wal_commit;
+    // Called after each successful commit with the tables it may have
+    // changed ("*" after schema changes), e.g. to invalidate a QueryCache
+    std::function<void(const std::vector<std::string>&)> on_tables_changed;
+};
+
+} // namespace services
+
+#if defined(HAVE_SQLITE3)
+#include <sqlite3.h>
+
+namespace services {
+
+// The only read-write connection to a database, owned by one thread. Write
+// transactions are queued; the thread drains the queue and commits up to
+// max_batch of them in one SQLite transaction, each inside its own savepoint
+// so a failing one is rolled back alone. Throughput therefore grows with the
+// batch size under load instead of collapsing into SQLITE_BUSY retries
+// between competing writers.
+class SQLiteWriter {
+public:
+    // Runs inside the group's transaction; return false to roll back just
+    // this one. Must not BEGIN/COMMIT itself.
+    using Transaction = std::function<bool(sqlite3*)>;
+
+    explicit SQLiteWriter(std::string db_path, SQLiteWriterOptions opts = {});
+    ~SQLiteWriter();
+
+    // Non-copyable
+    SQLiteWriter(const SQLiteWriter&) = delete;
+    SQLiteWriter& operator=(const SQLiteWriter&) = delete;
+
+    // Open (creating the database if needed), switch it to WAL and start the
+    // writer thread
+    bool start();
+    // Commit what is queued, then stop
+    void stop();
+
+    // Queue a transaction; the future is true once it is committed, false if
+    // it or the group's commit failed (or the writer is not running)
+    std::future<bool> submit(Transaction txn);
+    // Queue SQL text (may hold several statements)
+    std::future<bool> execute(std::string sql);
+
+    uint64_t commits() const { return commits_.load(); }           // group commits so far
+    uint64_t transactions() const { return transactions_.load(); } // transactions committed
+
+private:
+    struct Job {
+        Transaction txn;
+        std::promise<bool> done;
+    };
+
+    void run();
+    void commit_group(std::deque<Job>& group);
+
+    std::string db_path_;
+    SQLiteWriterOptions opts_;
+    sqlite3* db_ = nullptr;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Job> queue_;
+    bool running_ = false;
+    bool stopping_ = false;
+    std::thread thread_;
+    std::atomic<uint64_t> commits_{ 0 };
+    std::atomic<uint64_t> transactions_{ 0 };
+    std::set<std::string> touched_; // tables written by the open group (writer thread only)
+};
+
+} // namespace services
+#else
+namespace services {
+// Stubbed fallback when SQLite3 development headers are not available
+class SQLiteWriter {
+public:
+    explicit SQLiteWriter(std::string /*db_path*/, SQLiteWriterOptions /*opts*/ = {}) {}
+    bool start() { return false; }
+    void stop() {}
+    std::future<bool> execute(std::string /*sql*/) {
+        std::promise<bool> p;
+        p.set_value(false);
+        return p.get_future();
+    }
+    uint64_t commits() const { return 0; }
+    uint64_t transactions() const { return 0; }
+};
+} // namespace services
+#endif
@@ -1,8 +1,15 @@
 #include "simple_http.h"
 #include <sys/socket.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/time.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
 #include <cstring>
 #include <iostream>
 #include <fstream>
@@ -12,8 +19,18 @@
 #include <unordered_map>
 #include <vector>
 #include "sandbox/executor.h"
+#include "sandbox/executor_pool.h"
 #include "engine/engine.h"
+#include "engine/preload.h"
+#include "engine/script_registry.h"
+#include "engine/script_worker.h"
+#include "services/html_service.h"
+#include "services/query_cache.h"
 #include "services/services.h"
+#include "services/sqlite_checkpointer.h"
+#include "services/sqlite_pool.h"
+#include "services/sqlite_query_guard.h"
+#include "services/sqlite_stream.h"
 
 static std::atomic<bool> server_running{false};
 static int server_fd = -1;
@@ -30,10 +47,435 @@ static std::string read_file(const std::string& path) {
     return ss.str();
 }
 
+// Extract `key` from a query string (a=1&b=2); empty if absent
+static std::string query_param(const std::string& query, const std::string& key) {
+    size_t pos = 0;
+    while (pos <= query.size()) {
+        size_t amp = query.find('&', pos);
+        std::string part = query.substr(pos, amp == std::string::npos ? std::string::npos : amp - pos);
+        if (part.compare(0, key.size() + 1, key + "=") == 0) return part.substr(key.size() + 1);
+        if (amp == std::string::npos) break;
+        pos = amp + 1;
+    }
+    return {};
+}
+
+// Decode %XX escapes and '+' of a query parameter
+static std::string url_decode(const std::string& in) {
+    std::string out;
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (in[i] == '+') {
+            out += ' ';
+        } else if (in[i] == '%' && i + 2 < in.size() && isxdigit(static_cast<unsigned char>(in[i + 1])) &&
+                   isxdigit(static_cast<unsigned char>(in[i + 2]))) {
+            out += static_cast<char>(std::stoi(in.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += in[i];
+        }
+    }
+    return out;
+}
+
+// Send the captured output memfd straight to the client with sendfile().
+// 200 when the script exited (its status in X-Exit-Code), 502 with whatever
+// it wrote when it was killed or timed out, 500 when it could not be run.
+static void send_captured_output(int client, const sandbox::ExecResult& res) {
+    if (!res.capture) {
+        std::string body = "{\"error\": \"failed to run script\"}";
+        std::string resp = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: " + std::to_string(body.size()) + "\r\nContent-Type: application/json\r\n\r\n" + body;
+        send(client, resp.c_str(), resp.size(), 0);
+        return;
+    }
+    size_t size = res.capture->size();
+    std::string head = std::string(res.success ? "HTTP/1.1 200 OK" : "HTTP/1.1 502 Bad Gateway") +
+                       "\r\nContent-Length: " + std::to_string(size) + "\r\nContent-Type: text/plain\r\nX-Exit-Code: " +
+                       std::to_string(res.exit_code) + "\r\n";
+    if (res.term_signal) head += "X-Term-Signal: " + std::to_string(res.term_signal) + "\r\n";
+    head += "\r\n";
+    send(client, head.c_str(), head.size(), 0);
+    off_t off = 0;
+    while (static_cast<size_t>(off) < size) {
+        ssize_t n = sendfile(client, res.capture->fd(), &off, size - static_cast<size_t>(off));
+        if (n <= 0) break;
+    }
+}
+
+// Prometheus text exposition of executor concurrency, PSI pressure, script tiers
+// and SQLite (statement cache, WAL checkpoints, query cache)
+static std::string render_metrics() {
+    auto& pool = sandbox::executor_pool();
+    std::ostringstream m;
+    m << "# HELP native_node_executor_concurrency_limit Maximum concurrently running invocations.\n"
+      << "# TYPE native_node_executor_concurrency_limit gauge\n"
+      << "native_node_executor_concurrency_limit " << pool.concurrency_limit() << "\n"
+      << "# HELP native_node_executor_running Invocations currently running.\n"
+      << "# TYPE native_node_executor_running gauge\n"
+      << "native_node_executor_running " << pool.running() << "\n"
+      << "# HELP native_node_executor_frozen Preempted invocations currently frozen.\n"
+      << "# TYPE native_node_executor_frozen gauge\n"
+      << "native_node_executor_frozen " << pool.frozen() << "\n"
+      << "# HELP native_node_executor_queued Invocations waiting, by priority class.\n"
+      << "# TYPE native_node_executor_queued gauge\n";
+    for (const auto& cls : pool.class_names()) {
+        m << "native_node_executor_queued{class=\"" << cls << "\"} " << pool.queued(cls) << "\n";
+    }
+    auto p = pool.last_pressure();
+    m << "# HELP native_node_pressure_avg10 PSI stall percentage over 10s for the invocation parent cgroup.\n"
+      << "# TYPE native_node_pressure_avg10 gauge\n";
+    const std::pair<const char*, const sandbox::PressureStats*> resources[] = { { "cpu", &p.cpu }, { "memory", &p.memory }, { "io", &p.io } };
+    for (const auto& r : resources) {
+        m << "native_node_pressure_avg10{resource=\"" << r.first << "\",kind=\"some\"} " << r.second->some.avg10 << "\n"
+          << "native_node_pressure_avg10{resource=\"" << r.first << "\",kind=\"full\"} " << r.second->full.avg10 << "\n";
+    }
+    sandbox::spawn_histograms().render_prometheus(m);
+    auto scripts = engine::script_registry().stats();
+    m << "# HELP native_node_script_tier Compilation tier of each live script (0 baseline, 1 optimized).\n"
+      << "# TYPE native_node_script_tier gauge\n";
+    for (const auto& s : scripts) {
+        m << "native_node_script_tier{script=\"" << s.name << "\"} " << static_cast<int>(s.tier) << "\n";
+    }
+    m << "# HELP native_node_script_invocations_total Calls of each live script since its last edit.\n"
+      << "# TYPE native_node_script_invocations_total counter\n";
+    for (const auto& s : scripts) {
+        m << "native_node_script_invocations_total{script=\"" << s.name << "\"} " << s.calls << "\n";
+    }
+    if (auto* readers = services::sqlite_readers()) {
+        m << "# HELP native_node_sqlite_statement_cache_total Prepared statement cache lookups on pooled connections.\n"
+          << "# TYPE native_node_sqlite_statement_cache_total counter\n"
+          << "native_node_sqlite_statement_cache_total{result=\"hit\"} " << readers->statement_hits() << "\n"
+          << "native_node_sqlite_statement_cache_total{result=\"miss\"} " << readers->statement_misses() << "\n";
+    }
+    if (auto* checkpointer = services::sqlite_checkpointer()) checkpointer->render_prometheus(m);
+    if (auto* cache = services::query_cache()) {
+        m << "# HELP native_node_query_cache_total /api/query result cache lookups.\n"
+          << "# TYPE native_node_query_cache_total counter\n"
+          << "native_node_query_cache_total{result=\"hit\"} " << cache->hits() << "\n"
+          << "native_node_query_cache_total{result=\"miss\"} " << cache->misses() << "\n"
+          << "# HELP native_node_query_cache_invalidations_total Cached results dropped because a table they read changed.\n"
+          << "# TYPE native_node_query_cache_invalidations_total counter\n"
+          << "native_node_query_cache_invalidations_total " << cache->invalidations() << "\n"
+          << "# HELP native_node_query_cache_bytes Memory held by cached query results.\n"
+          << "# TYPE native_node_query_cache_bytes gauge\n"
+          << "native_node_query_cache_bytes " << cache->bytes() << "\n";
+    }
+    return m.str();
+}
+
+// Minimal JSON string escaping for error messages and script names
+static std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += ' ';
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+static const char* status_text(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    case 413: return "Payload Too Large";
+    case 500: return "Internal Server Error";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    default: return "Unknown";
+    }
+}
+
+// In-process script call: /script/<name>[?query] runs doGet/doPost of
+// scripts/<name>.cpp in a pre-forked worker (see engine/script_abi.h). The
+// request is received straight into the leased worker's arena slot and the
+// response is sent from there, so neither is copied. A client that stalls
+// mid-request gives the worker back: each read may wait READ_STALL_MS and
+// the whole request REQUEST_MS.
+static void handle_script_request(int client, const std::string& target) {
+    auto fail = [client](int status, const std::string& error) {
+        std::string body = "{\"error\": \"" + json_escape(error) + "\"}";
+        std::string resp = "HTTP/1.1 " + std::to_string(status) + " " + status_text(status) +
+                           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nContent-Type: application/json\r\n\r\n" + body;
+        send(client, resp.c_str(), resp.size(), 0);
+        // Closing with request bytes still unread would reset the connection
+        // and could discard the response
+        char drain[4096];
+        while (recv(client, drain, sizeof(drain), MSG_DONTWAIT) > 0) {}
+        close(client);
+    };
+    constexpr int READ_STALL_MS = 1000;
+    constexpr int REQUEST_MS = 5000;
+    constexpr auto LEASE_TIMEOUT = std::chrono::milliseconds(5000);
+
+    // Registry names are paths under scripts/ without the extension
+    // (ScriptRegistry::name_for), so nested ones like "webapps/shop" are fine
+    std::string name = target.substr(0, target.find('?'));
+    bool valid = !name.empty() && name.front() != '/';
+    for (size_t start = 0; valid && start <= name.size();) {
+        size_t slash = std::min(name.find('/', start), name.size());
+        valid = name.compare(start, slash - start, "..") != 0;
+        start = slash + 1;
+    }
+    if (!valid) return fail(400, "invalid script name");
+    auto& workers = engine::script_workers();
+    if (!workers.running()) return fail(503, "script workers not running");
+
+    // Current version; a hot reload during the call does not affect this one
+    auto script = engine::script_registry().call(name);
+    if (!script) {
+        engine::ScriptState state;
+        if (engine::preload_status().get(name, state) &&
+            (state == engine::ScriptState::Pending || state == engine::ScriptState::Compiling)) {
+            return fail(503, "script is still compiling");
+        }
+        return fail(404, "script not found");
+    }
+    auto lease = workers.acquire(LEASE_TIMEOUT);
+    if (!lease) return fail(503, "script workers busy");
+
+    // Receive the whole request (still unread: the router only peeked at it).
+    // Returning drops the lease.
+    char* buf = lease.request_buffer();
+    size_t cap = lease.request_capacity();
+    size_t got = 0, content_length = 0;
+    long head = 0;
+    engine::RequestLayout layout;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(REQUEST_MS);
+    for (;;) {
+        if (head == 0) {
+            head = engine::parse_request_head(buf, got, layout, content_length);
+            if (head < 0) return fail(400, "malformed request");
+        }
+        if (head > 0 && static_cast<size_t>(head) + content_length > cap) return fail(413, "request too large");
+        if (head > 0 && got >= static_cast<size_t>(head) + content_length) break;
+        if (got == cap) return fail(413, "request too large");
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        pollfd pfd{ client, POLLIN, 0 };
+        int pr = left > 0 ? poll(&pfd, 1, static_cast<int>(std::min<long long>(left, READ_STALL_MS))) : 0;
+        if (pr < 0 && errno == EINTR) continue;
+        if (pr == 0) return fail(408, "timed out reading the request");
+        ssize_t n = recv(client, buf + got, cap - got, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            close(client);
+            return;
+        }
+        got += static_cast<size_t>(n);
+    }
+    layout.body = { static_cast<uint32_t>(head), static_cast<uint32_t>(content_length) };
+    size_t size = static_cast<size_t>(head) + content_length;
+
+    std::string_view method(buf + layout.method.off, layout.method.len);
+    std::string entry = method == "GET" ? "doGet" : method == "POST" ? "doPost" : "";
+    if (entry.empty()) return fail(405, "scripts handle GET and POST");
+
+    engine::ScriptResponse res = lease.invoke(script->path(), entry, layout, size);
+    if (!res.ok) return fail(res.status, res.error);
+
+    std::string status_line = "HTTP/1.1 " + std::to_string(res.status) + " " + status_text(res.status) +
+                              "\r\nContent-Length: " + std::to_string(res.body.size()) + "\r\n";
+    iovec iov[4] = {
+        { status_line.data(), status_line.size() },
+        { const_cast<char*>(res.headers.data()), res.headers.size() },
+        { const_cast<char*>("\r\n"), 2 },
+        { const_cast<char*>(res.body.data()), res.body.size() },
+    };
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 4;
+    sendmsg(client, &msg, 0);
+    close(client);
+}
+
+// Data available to every template: process status and the live scripts
+static services::TemplateValue template_data() {
+    services::TemplateValue data;
+    data.set("uptime", std::to_string(g_start_time ? (long)(time(nullptr) - g_start_time) : 0));
+    data.set("engine", engine::is_initialized() ? "ok" : "down");
+    data.set("services", services::is_initialized() ? "ok" : "down");
+    services::TemplateValue scripts;
+    for (const auto& s : engine::script_registry().stats()) {
+        services::TemplateValue row;
+        row.set("name", s.name);
+        row.set("tier", engine::script_tier_name(s.tier));
+        row.set("calls", std::to_string(s.calls));
+        scripts.push(std::move(row));
+    }
+    data.set("scripts", std::move(scripts));
+    return data;
+}
+
+// Server-side template: /html/<name> renders <web root>/templates/<name>.html.
+// The template is parsed once (again after edits) and rendered straight into
+// a per-thread buffer that is sent as is.
+static void handle_template_request(int client, const std::string& name) {
+    auto reply = [client](int status, const char* type, const char* body, size_t len) {
+        std::string head = "HTTP/1.1 " + std::to_string(status) + " " + status_text(status) +
+                           "\r\nContent-Length: " + std::to_string(len) + "\r\nContent-Type: " + type + "\r\n\r\n";
+        iovec iov[2] = { { head.data(), head.size() }, { const_cast<char*>(body), len } };
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        sendmsg(client, &msg, 0);
+        close(client);
+    };
+    if (name.empty() || name.find('/') != std::string::npos || name.find("..") != std::string::npos) {
+        return reply(400, "text/plain", "invalid template name", 21);
+    }
+    auto tmpl = services::template_cache().get(g_web_root + "/templates/" + name + ".html");
+    if (!tmpl) return reply(404, "text/plain", "template not found", 18);
+
+    thread_local std::vector<char> out(64 * 1024);
+    auto data = template_data();
+    size_t len = tmpl->render(data, out.data(), out.size());
+    if (len > out.size()) {
+        out.resize(len);
+        tmpl->render(data, out.data(), out.size());
+    }
+    reply(200, "text/html; charset=utf-8", out.data(), len);
+}
+
+// Send every byte of `iov`, blocking while the client's socket buffer is
+// full. False once the client is gone or stalls past the send timeout.
+static bool send_all(int client, iovec* iov, size_t count) {
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    while (msg.msg_iovlen > 0) {
+        ssize_t n = sendmsg(client, &msg, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        while (msg.msg_iovlen > 0 && static_cast<size_t>(n) >= msg.msg_iov->iov_len) {
+            n -= static_cast<ssize_t>(msg.msg_iov->iov_len);
+            ++msg.msg_iov;
+            --msg.msg_iovlen;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = static_cast<char*>(msg.msg_iov->iov_base) + n;
+            msg.msg_iov->iov_len -= static_cast<size_t>(n);
+        }
+    }
+    return true;
+}
+
+// Read-only SQL: /api/query?sql=SELECT...[&format=ndjson]. Rows are encoded
+// as they are stepped and sent as HTTP chunks of about 64K, so a large
+// result never sits in memory; a slow client blocks the stepping instead.
+// Failing mid-result closes the connection without the final chunk, which
+// the client sees as a truncated response. Small results are also kept in
+// the query cache, if enabled, and served from there as a whole.
+static void handle_query_request(int client, const std::string& query) {
+    auto fail = [client](int status, const std::string& error) {
+        std::string body = "{\"error\": \"" + json_escape(error) + "\"}";
+        std::string resp = "HTTP/1.1 " + std::to_string(status) + " " + status_text(status) +
+                           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nContent-Type: application/json\r\n\r\n" + body;
+        send(client, resp.c_str(), resp.size(), 0);
+        close(client);
+    };
+#if defined(HAVE_SQLITE3)
+    constexpr size_t CHUNK_BYTES = 64 * 1024;
+    std::string sql = url_decode(query_param(query, "sql"));
+    std::string format = query_param(query, "format");
+    if (sql.empty()) return fail(400, "missing sql");
+    if (!format.empty() && format != "json" && format != "ndjson") return fail(400, "format must be json or ndjson");
+    auto* readers = services::sqlite_readers();
+    if (!readers) return fail(503, "database not available");
+    const char* content_type = format == "ndjson" ? "application/x-ndjson" : "application/json";
+
+    // Repeated reads are answered from the result cache until a commit
+    // touches one of the tables they read
+    auto* cache = services::query_cache();
+    std::string cache_key = cache ? services::QueryCache::key(sql, { format }) : std::string();
+    if (cache) {
+        if (auto hit = cache->get(cache_key)) {
+            std::string head = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(hit->size()) +
+                               "\r\nContent-Type: " + content_type + "\r\nX-Cache: hit\r\n\r\n";
+            iovec iov[2] = { { head.data(), head.size() }, { const_cast<char*>(hit->data()), hit->size() } };
+            send_all(client, iov, 2);
+            close(client);
+            return;
+        }
+    }
+
+    // One row-returning read per request: no transactions, ATTACH or PRAGMA
+    auto* guard = services::query_guard();
+    if (!guard) return fail(503, "database not available");
+    std::string rejected;
+    services::ReadQueryInfo info;
+    if (!guard->check(sql, rejected, &info)) return fail(403, rejected);
+
+    auto conn = readers->acquire(std::chrono::milliseconds(5000));
+    if (!conn) return fail(503, "database busy");
+    uint64_t stamp = cache ? cache->begin() : 0;
+    bool cacheable = cache && services::cacheable_query(info);
+    auto stmt = conn.prepare(sql);
+    if (!stmt) return fail(400, sqlite3_errmsg(conn.get()));
+
+    // Don't hold a connection forever for a client that stopped reading
+    timeval timeout{ 30, 0 };
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    std::string head = std::string("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nContent-Type: ") + content_type +
+                       (cache ? "\r\nX-Cache: miss" : "") + "\r\n\r\n";
+    iovec head_iov{ head.data(), head.size() };
+    if (!send_all(client, &head_iov, 1)) {
+        close(client);
+        return;
+    }
+    std::string error, captured;
+    bool ok = services::stream_rows(stmt.get(), format == "ndjson" ? services::RowFormat::Ndjson : services::RowFormat::Json,
+                                    CHUNK_BYTES, [&](const char* data, size_t size) {
+        // Keep a copy for the cache while the result is small enough
+        if (cacheable) {
+            if (captured.size() + size <= cache->max_entry_bytes()) {
+                captured.append(data, size);
+            } else {
+                cacheable = false;
+                std::string().swap(captured);
+            }
+        }
+        char size_line[24];
+        int len = snprintf(size_line, sizeof(size_line), "%zx\r\n", size);
+        iovec iov[3] = { { size_line, static_cast<size_t>(len) }, { const_cast<char*>(data), size }, { const_cast<char*>("\r\n"), 2 } };
+        return send_all(client, iov, 3);
+    }, &error);
+    if (ok) {
+        iovec end{ const_cast<char*>("0\r\n\r\n"), 5 };
+        send_all(client, &end, 1);
+        if (cacheable) cache->put(cache_key, info.tables, std::move(captured), stamp);
+    } else if (!error.empty()) {
+        std::cerr << "[http] query failed mid-result: " << error << std::endl;
+    }
+    close(client);
+#else
+    (void)query;
+    fail(503, "database not available");
+#endif
+}
+
 static void handle_client(int client) {
+    // Keep request handling on the reactor CPUs, away from script invocations
+    sandbox::cpu_placer().pin_to_reactor();
     constexpr size_t BUF = 8192;
     char buf[BUF];
-    ssize_t n = recv(client, buf, BUF - 1, 0);
+    // Peek only: script calls receive the request into their worker's buffer
+    ssize_t n = recv(client, buf, BUF - 1, MSG_PEEK);
     if (n <= 0) { close(client); return; }
     buf[n] = '\0';
     std::string req(buf);
@@ -43,6 +485,12 @@ static void handle_client(int client) {
     std::string method, path, proto;
     rs >> method >> path >> proto;
 
+    if (path.rfind("/script/", 0) == 0) {
+        handle_script_request(client, path.substr(8));
+        return;
+    }
+    recv(client, buf, static_cast<size_t>(n), 0); // consume what was peeked
+
     if (path == "/" ) path = "/index.html";
 
     // runtime endpoint to run a script: /run-script?name=sample_script.sh
@@ -51,13 +499,8 @@ static void handle_client(int client) {
         std::string::size_type q = path.find('?');
         std::string query;
         if (q != std::string::npos) query = path.substr(q+1);
-        std::string script_name;
-        if (!query.empty()) {
-            size_t pos = query.find("name=");
-            if (pos != std::string::npos) {
-                script_name = query.substr(pos+5);
-            }
-        }
+        std::string script_name = query_param(query, "name");
+        bool wait = query_param(query, "wait") == "1";
         if (script_name.empty()) {
             std::string body = "{\"error\": \"missing script name\"}";
             std::string resp = "HTTP/1.1 400 Bad Request\r\nContent-Length: " + std::to_string(body.size()) + "\r\nContent-Type: application/json\r\n\r\n" + body;
@@ -66,20 +509,54 @@ static void handle_client(int client) {
             return;
         }
 
-        // Execute the script using the executor in a new thread (non-blocking HTTP response)
-        std::thread([script_name](){
-            std::string script_path = std::string("./scripts/") + script_name;
-            // Use simple system() invocation via executor; avoid directly calling exec here.
-            sandbox::CgroupLimits limits;
-            limits.cpu_max = "max";
-            limits.memory_max = "max";
-            limits.pids_max = "max";
-            std::vector<std::string> args = { script_path };
-            auto res = sandbox::run_command_in_cgroup(args, limits, 10);
-            // Log result to artifacts
+        // Priority class: queue order, cpu.weight/io.weight/memory.high and timeout
+        std::string class_name = query_param(query, "class");
+        if (class_name.empty()) class_name = "default";
+        if (!sandbox::executor_pool().find_class(class_name)) {
+            std::string body = "{\"error\": \"unknown priority class\"}";
+            std::string resp = "HTTP/1.1 400 Bad Request\r\nContent-Length: " + std::to_string(body.size()) + "\r\nContent-Type: application/json\r\n\r\n" + body;
+            send(client, resp.c_str(), resp.size(), 0);
+            close(client);
+            return;
+        }
+
+        // Per-script Landlock/seccomp policy, compiled once and cached
+        auto policy = sandbox::policy_cache().get(sandbox::policy_config_for_script("./scripts", script_name));
+        if (!policy) {
+            std::string body = "{\"error\": \"failed to compile sandbox policy\"}";
+            std::string resp = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: " + std::to_string(body.size()) + "\r\nContent-Type: application/json\r\n\r\n" + body;
+            send(client, resp.c_str(), resp.size(), 0);
+            close(client);
+            return;
+        }
+
+        sandbox::ExecOptions opts;
+        opts.policy = policy;
+        opts.placer = &sandbox::cpu_placer();
+        std::vector<std::string> args = { std::string("./scripts/") + script_name };
+
+        // wait=1: run synchronously and stream the full output back without copying it
+        if (wait) {
+            opts.capture.mode = sandbox::CaptureMode::Handoff;
+            auto res = sandbox::executor_pool().submit(class_name, args, opts).get();
+            send_captured_output(client, res);
+            close(client);
+            return;
+        }
+
+        // Otherwise queue it and log the result to artifacts when it completes
+        bool queued = sandbox::executor_pool().submit(class_name, args, opts, [script_name](sandbox::ExecResult&& res) {
             std::ofstream ofs("artifacts/run_script_output.txt", std::ios::app);
-            ofs << "script=" << script_name << " exit=" << res.exit_code << " success=" << res.success << " output:\n" << res.output << "\n---\n";
-        }).detach();
+            ofs << "script=" << script_name << " exit=" << res.exit_code << " success=" << res.success
+                << (res.output_truncated ? " truncated=1" : "") << " output:\n" << res.output << "\n---\n";
+        });
+        if (!queued) {
+            std::string body = "{\"error\": \"executor not accepting jobs\"}";
+            std::string resp = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: " + std::to_string(body.size()) + "\r\nContent-Type: application/json\r\n\r\n" + body;
+            send(client, resp.c_str(), resp.size(), 0);
+            close(client);
+            return;
+        }
 
         std::string body = "{\"status\": " + std::string("\"scheduled\"") + "}";
         std::string resp = "HTTP/1.1 202 Accepted\r\nContent-Length: " + std::to_string(body.size()) + "\r\nContent-Type: application/json\r\n\r\n" + body;
@@ -89,6 +566,23 @@ static void handle_client(int client) {
     }
 
     // API endpoints
+    if (path == "/api/metrics") {
+        std::string body = render_metrics();
+        std::string resp = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\nContent-Type: text/plain; version=0.0.4\r\n\r\n" + body;
+        send(client, resp.c_str(), resp.size(), 0);
+        close(client);
+        return;
+    }
+
+    // Recent invocations as Chrome trace events (load in chrome://tracing or Perfetto)
+    if (path == "/api/trace") {
+        std::string body = sandbox::spawn_trace_ring().to_json();
+        std::string resp = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\nContent-Type: application/json\r\n\r\n" + body;
+        send(client, resp.c_str(), resp.size(), 0);
+        close(client);
+        return;
+    }
+
     if (path == "/api/status") {
         time_t now = time(nullptr);
         long uptime = g_start_time ? (long)(now - g_start_time) : 0;
@@ -99,17 +593,43 @@ static void handle_client(int client) {
         engine_ok = engine::is_initialized();
         services_ok = services::is_initialized();
 
+        // Per-script readiness while the engine preloads in the background
+        auto& preload = engine::preload_status();
+        std::string scripts = std::string("{\"preloading\": ") + (preload.done() ? "false" : "true");
+        for (auto state : { engine::ScriptState::Pending, engine::ScriptState::Compiling, engine::ScriptState::Ready,
+                            engine::ScriptState::Failed }) {
+            scripts += ", \"" + std::string(engine::script_state_name(state)) + "\": " + std::to_string(preload.count(state));
+        }
+        scripts += ", \"items\": {";
+        bool first = true;
+        for (const auto& item : preload.items()) {
+            scripts += std::string(first ? "" : ", ") + "\"" + json_escape(item.name) + "\": \"" + engine::script_state_name(item.state) + "\"";
+            first = false;
+        }
+        scripts += "}}";
+
         std::string body = "{\"status\":\"ok\", \"uptime\": " + std::to_string(uptime) +
                            ", \"engine\": \"" + (engine_ok ? "ok" : "down") +
-                           "\", \"services\": \"" + (services_ok ? "ok" : "down") + "\" }";
+                           "\", \"services\": \"" + (services_ok ? "ok" : "down") + "\", \"scripts\": " + scripts + " }";
         std::string resp = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\nContent-Type: application/json\r\n\r\n" + body;
         send(client, resp.c_str(), resp.size(), 0);
         close(client);
         return;
     }
 
-    std::string full = g_web_root + path;
-    std::string body = read_file(full);
+    if (path.rfind("/api/query", 0) == 0 && (path.size() == 10 || path[10] == '?')) {
+        handle_query_request(client, path.size() > 10 ? path.substr(11) : std::string());
+        return;
+    }
+
+    if (path.rfind("/html/", 0) == 0) {
+        handle_template_request(client, path.substr(6));
+        return;
+    }
+
+    // Template sources are only served rendered
+    std::string full = path.rfind("/templates/", 0) == 0 ? std::string() : g_web_root + path;
+    std::string body = full.empty() ? std::string() : read_file(full);
     if (body.empty()) {
         std::string resp = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
         send(client, resp.c_str(), resp.size(), 0);
@@ -123,6 +643,7 @@ static void handle_client(int client) {
 }
 
 static void server_loop(int port) {
+    sandbox::cpu_placer().pin_to_reactor();
     server_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (server_fd < 0) {
         perror("socket");
@@ -161,6 +682,8 @@ bool start(const std::string& web_root, int port) {
     if (server_running) return false;
     g_web_root = web_root;
     g_start_time = time(nullptr);
+    // Create the executor workers here so they do not inherit the reactor CPU pinning
+    sandbox::executor_pool();
     server_thread = std::thread(server_loop, port);
     // give it a moment
     std::this_thread::sleep_for(std::chrono::milliseconds(50));
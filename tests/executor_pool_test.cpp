@@ -0,0 +1,110 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include "sandbox/executor_pool.h"
+#include "sandbox/cgroups.h"
+
+int main() {
+    std::cout << "executor_pool_test: starting" << std::endl;
+
+    // Config parsing
+    char conf[] = "/tmp/priority_classes_XXXXXX";
+    int fd = mkstemp(conf);
+    if (fd < 0) {
+        std::cerr << "executor_pool_test: mkstemp failed" << std::endl;
+        return 2;
+    }
+    close(fd);
+    {
+        std::ofstream ofs(conf);
+        ofs << "# comment\n\nfast cpu.weight=500 io.weight=400 timeout=5\nslow cpu.weight=5 memory.high=1048576  # trailing\n";
+    }
+    std::vector<sandbox::PriorityClass> classes;
+    if (!sandbox::load_priority_classes(conf, classes) || classes.size() != 2 || classes[0].name != "fast" ||
+        classes[0].limits.cpu_weight != "500" || classes[0].limits.io_weight != "400" || classes[0].timeout_sec != 5 ||
+        classes[1].limits.memory_high != "1048576" || classes[1].timeout_sec != 30) {
+        std::cerr << "executor_pool_test: priority class parsing failed" << std::endl;
+        unlink(conf);
+        return 2;
+    }
+    {
+        std::ofstream ofs(conf);
+        ofs << "bad cpu.weight\n";
+    }
+    if (sandbox::load_priority_classes(conf, classes) || classes.size() != 2) {
+        std::cerr << "executor_pool_test: invalid config accepted" << std::endl;
+        unlink(conf);
+        return 2;
+    }
+    unlink(conf);
+
+    if (!sandbox::is_cgroup_v2_available()) {
+        std::cout << "cgroup v2 not available; skipping dispatch checks" << std::endl;
+        std::cout << "executor_pool_test: succeeded" << std::endl;
+        return 0;
+    }
+
+    // One worker: while it is busy, queued interactive work must run before
+    // batch work that was queued earlier
+    char log[] = "/tmp/executor_pool_order_XXXXXX";
+    fd = mkstemp(log);
+    close(fd);
+    std::string logpath = log;
+    sandbox::ExecutorPool pool(sandbox::default_priority_classes(), 1);
+    auto busy = pool.submit("default", {"/bin/sh", "-c", "sleep 0.3"});
+    usleep(100 * 1000);
+    auto batch = pool.submit("batch", {"/bin/sh", "-c", "echo batch >> " + logpath});
+    auto inter = pool.submit("interactive", {"/bin/sh", "-c", "echo interactive >> " + logpath});
+    if (pool.queued("batch") != 1 || pool.queued("interactive") != 1) {
+        std::cerr << "executor_pool_test: jobs not queued behind the busy worker" << std::endl;
+        unlink(log);
+        return 2;
+    }
+    bool ok = busy.get().success && batch.get().success && inter.get().success;
+    std::ifstream ifs(logpath);
+    std::string first, second;
+    ifs >> first >> second;
+    unlink(log);
+    if (!ok || first != "interactive" || second != "batch") {
+        std::cerr << "executor_pool_test: wrong dispatch order: " << first << ", " << second << std::endl;
+        return 2;
+    }
+
+    // Preemption: with one slot, a running batch job is frozen so interactive
+    // work runs first, then thawed; its frozen time does not hit its timeout
+    {
+        fd = mkstemp(log);
+        close(fd);
+        logpath = log;
+        auto classes = sandbox::default_priority_classes();
+        classes[2].timeout_sec = 1;
+        sandbox::ExecutorPool ppool(classes, 2);
+        ppool.set_concurrency_limit(1);
+        auto slow = ppool.submit("batch", {"/bin/sh", "-c", "sleep 0.6; echo batch >> " + logpath});
+        usleep(150 * 1000);
+        auto fast = ppool.submit("interactive", {"/bin/sh", "-c", "sleep 0.6; echo interactive >> " + logpath});
+        bool froze = ppool.frozen() == 1;
+        auto fr = fast.get();
+        auto sr = slow.get();
+        std::ifstream order(logpath);
+        first.clear();
+        second.clear();
+        order >> first >> second;
+        unlink(log);
+        if (!froze || !fr.success || !sr.success || sr.exit_code != 0 || first != "interactive" || second != "batch") {
+            std::cerr << "executor_pool_test: preemption failed (froze=" << froze << " batch exit=" << sr.exit_code
+                      << " order=" << first << "," << second << ")" << std::endl;
+            return 2;
+        }
+    }
+
+    auto rejected = pool.submit("no-such-class", {"/bin/true"}).get();
+    if (rejected.success) {
+        std::cerr << "executor_pool_test: unknown class was run" << std::endl;
+        return 2;
+    }
+
+    std::cout << "executor_pool_test: succeeded" << std::endl;
+    return 0;
+}
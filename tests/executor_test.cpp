@@ -16,6 +16,23 @@ int main() {
         return 2;
     }
 
+    // Every phase of a plain invocation is traced and exported
+    using sandbox::SpawnPhase;
+    for (auto phase : { SpawnPhase::CgroupCreate, SpawnPhase::CgroupLimits, SpawnPhase::CaptureSetup, SpawnPhase::Fork,
+                        SpawnPhase::Exec, SpawnPhase::Run, SpawnPhase::Collect, SpawnPhase::Teardown }) {
+        if (!r.trace.span(phase).recorded()) {
+            std::cerr << "executor_test: phase " << sandbox::spawn_phase_name(phase) << " not traced" << std::endl;
+            return 2;
+        }
+    }
+    if (r.trace.span(SpawnPhase::Exec).begin < r.trace.span(SpawnPhase::Fork).end ||
+        r.trace.span(SpawnPhase::Run).begin < r.trace.span(SpawnPhase::Exec).end ||
+        sandbox::spawn_histograms().count(SpawnPhase::Fork) != 1 ||
+        sandbox::spawn_trace_ring().to_json().find("\"name\":\"exec\"") == std::string::npos) {
+        std::cerr << "executor_test: spawn trace out of order or not exported" << std::endl;
+        return 2;
+    }
+
     // Run /bin/sh -c 'exit 3'
     std::vector<std::string> args2 = {"/bin/sh", "-c", "exit 3"};
     auto r2 = sandbox::run_command_in_cgroup(args2, limits, 5);
@@ -24,6 +41,40 @@ int main() {
         return 2;
     }
 
+    // Batch: six commands, two at a time, in one shared cgroup
+    std::vector<std::vector<std::string>> batch;
+    for (int i = 0; i < 6; ++i) {
+        batch.push_back({"/bin/sh", "-c", "echo item" + std::to_string(i) + "; exit " + std::to_string(i)});
+    }
+    batch.push_back({"/bin/sh", "-c", "sleep 10"});
+    sandbox::BatchOptions bopts;
+    bopts.limits = limits;
+    bopts.max_parallel = 2;
+    bopts.item_timeout_sec = 1;
+    std::vector<int> seen(batch.size(), 0);
+    std::vector<sandbox::ExecResult> results(batch.size());
+    bool ok = sandbox::run_batch_in_cgroup(batch, bopts, [&](size_t i, sandbox::ExecResult&& res) {
+        ++seen[i];
+        results[i] = std::move(res);
+    });
+    if (!ok) {
+        std::cerr << "executor_test: batch could not start" << std::endl;
+        return 2;
+    }
+    for (size_t i = 0; i < 6; ++i) {
+        std::string expected = "item" + std::to_string(i) + "\n";
+        if (seen[i] != 1 || !results[i].success || results[i].exit_code != static_cast<int>(i) ||
+            results[i].output != expected) {
+            std::cerr << "executor_test: batch item " << i << " wrong (seen=" << seen[i] << " exit="
+                      << results[i].exit_code << " output='" << results[i].output << "')" << std::endl;
+            return 2;
+        }
+    }
+    if (seen[6] != 1 || results[6].success) {
+        std::cerr << "executor_test: batch timeout item not reported as failed" << std::endl;
+        return 2;
+    }
+
     std::cout << "executor_test: succeeded" << std::endl;
     return 0;
 }
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "services/html_service.h"
+
+namespace fs = std::filesystem;
+
+static std::string render(const services::HtmlTemplate& t, const services::TemplateValue& data) {
+    char buf[4096];
+    size_t len = t.render(data, buf, sizeof(buf));
+    return std::string(buf, std::min(len, sizeof(buf)));
+}
+
+int main() {
+    std::cout << "html_service_test: starting" << std::endl;
+    int rc = 2;
+    fs::path dir = fs::temp_directory_path() / ("html_service_test_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+
+    do {
+        services::TemplateValue data;
+        data.set("title", "<Dash & \"board\">");
+        services::TemplateValue rows;
+        for (int i = 1; i <= 3; ++i) {
+            services::TemplateValue row;
+            row.set("id", std::to_string(i));
+            row.set("ok", i == 2 ? "0" : "1");
+            rows.push(std::move(row));
+        }
+        data.set("rows", std::move(rows));
+
+        std::string error;
+        auto t = services::HtmlTemplate::parse(
+            "<h1><?= title ?></h1><?!= title ?>\n"
+            "<? for r in rows ?>[<?= r.id ?>:<? if r.ok ?>up<? else ?>down<? end ?>]<? end ?>"
+            "<? if missing ?>never<? end ?><?= missing.field ?>.",
+            &error);
+        if (!t) {
+            std::cerr << "html_service_test: parse failed: " << error << std::endl;
+            break;
+        }
+        std::string want = "<h1>&lt;Dash &amp; &quot;board&quot;&gt;</h1><Dash & \"board\">\n[1:up][2:down][3:up].";
+        std::string got = render(*t, data);
+        if (got != want) {
+            std::cerr << "html_service_test: rendered '" << got << "'" << std::endl;
+            break;
+        }
+
+        // snprintf semantics: the full length is reported, nothing past cap written
+        char small[8] = "XXXXXXX";
+        if (t->render(data, small, 4) != want.size() || std::string(small, 7) != "<h1>XXX") {
+            std::cerr << "html_service_test: bounded render" << std::endl;
+            break;
+        }
+
+        // Syntax errors name the line
+        const char* bad[] = { "<? for x ?>", "a\n<? if a ?>", "<? end ?>", "<?= a..b ?>", "<? while a ?>", "<?= a" };
+        bool rejected = true;
+        for (const char* src : bad) {
+            error.clear();
+            if (services::HtmlTemplate::parse(src, &error) || error.empty()) {
+                std::cerr << "html_service_test: accepted '" << src << "'" << std::endl;
+                rejected = false;
+            }
+        }
+        if (!rejected) break;
+
+        // The cache parses once and again only after the file changes
+        services::TemplateCache cache;
+        fs::path file = dir / "page.html";
+        std::ofstream(file) << "v1 <?= title ?>";
+        auto first = cache.get(file.string());
+        if (!first || cache.get(file.string()) != first || cache.parses() != 1) {
+            std::cerr << "html_service_test: cache did not reuse the parsed template" << std::endl;
+            break;
+        }
+        std::ofstream(file) << "version 2 <?= title ?>";
+        auto second = cache.get(file.string());
+        if (!second || second == first || render(*second, data).rfind("version 2", 0) != 0 || cache.parses() != 2) {
+            std::cerr << "html_service_test: edit not picked up" << std::endl;
+            break;
+        }
+        if (cache.get((dir / "missing.html").string())) {
+            std::cerr << "html_service_test: missing file" << std::endl;
+            break;
+        }
+
+        // Dashboard-sized render time
+        char buf[4096];
+        const int N = 100000;
+        auto start = std::chrono::steady_clock::now();
+        size_t total = 0;
+        for (int i = 0; i < N; ++i) total += t->render(data, buf, sizeof(buf));
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "render: " << ns / N << " ns per page (" << total / N << " bytes, " << t->instructions()
+                  << " instructions)" << std::endl;
+        rc = 0;
+    } while (false);
+
+    fs::remove_all(dir);
+    if (rc == 0) std::cout << "html_service_test: succeeded" << std::endl;
+    return rc;
+}
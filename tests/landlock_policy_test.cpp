@@ -1,28 +1,80 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <thread>
+#include <chrono>
 #include <cstdlib>
 #include <sys/stat.h>
 #include "sandbox/ruleset.h"
 #include "sandbox/sandbox.h"
+#include "sandbox/policy.h"
+
+static bool check_access_specs() {
+    using namespace sandbox::landlock_access;
+    uint64_t a = 0;
+    if (!sandbox::parse_landlock_access("ro", a) || a != READ_ONLY) return false;
+    if (!sandbox::parse_landlock_access("rwx", a) || a != (READ_WRITE | EXECUTE)) return false;
+    if (!sandbox::parse_landlock_access("read_file,truncate,refer", a) || a != (READ_FILE | TRUNCATE | REFER)) return false;
+    if (sandbox::parse_landlock_access("read_file,bogus", a)) return false;
+    // Rights newer than the ABI must not be reported as supported
+    if (sandbox::landlock_supported_access(1) & (REFER | TRUNCATE)) return false;
+    if (!(sandbox::landlock_supported_access(3) & TRUNCATE)) return false;
+    return true;
+}
+
+static void write_policy(const std::string& file, const std::string& content) {
+    // Replace atomically, the way editors do
+    std::string tmp = file + ".tmp";
+    std::ofstream ofs(tmp);
+    ofs << content;
+    ofs.close();
+    rename(tmp.c_str(), file.c_str());
+}
 
 int main() {
     std::cout << "landlock_policy_test: starting" << std::endl;
+    if (!check_access_specs()) {
+        std::cerr << "access spec parsing failed" << std::endl;
+        return 2;
+    }
     if (!sandbox::is_landlock_available()) {
         std::cout << "landlock not available on this kernel; skipping test" << std::endl;
         return 0;
     }
+    std::cout << "landlock ABI version: " << sandbox::landlock_abi_version() << std::endl;
 
     // Create a temporary directory for testing
     std::string tmpdir = "/tmp/native_node_landlock_test";
     mkdir(tmpdir.c_str(), 0700);
 
     // Create a simple policy file pointing to the temp dir as read-only
-    std::string policy = "/tmp/native_node_landlock_test ro\n";
-    std::string policy_file = "/tmp/native_node_landlock_policy.conf";
-    std::ofstream ofs(policy_file);
-    ofs << policy;
-    ofs.close();
+    std::string policy_file = "/tmp/native_node_landlock_test/policy.conf";
+    write_policy(policy_file, "/tmp/native_node_landlock_test ro\n");
+
+    // Compiled once, then hot-swapped after the file changes
+    sandbox::PolicyCache cache;
+    sandbox::ScriptPolicyConfig cfg;
+    cfg.landlock_policy = policy_file;
+    auto first = cache.get(cfg);
+    if (!first || !first->has_landlock()) {
+        std::cerr << "failed to compile policy" << std::endl;
+        return 2;
+    }
+    if (!cache.start_watching()) {
+        std::cerr << "failed to start policy watcher" << std::endl;
+        return 2;
+    }
+    write_policy(policy_file, "/tmp/native_node_landlock_test read_file,read_dir,truncate\n");
+    bool swapped = false;
+    for (int i = 0; i < 100 && !swapped; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        swapped = cache.get(cfg) != first;
+    }
+    cache.stop_watching();
+    if (!swapped) {
+        std::cerr << "policy was not reloaded after the file changed" << std::endl;
+        return 2;
+    }
 
     sandbox::RulesetBuilder rb;
     if (!rb.load_policy(policy_file)) {
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <string>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <poll.h>
+#include "sandbox/output_capture.h"
+
+// Run `sh -c cmd` with stdout/stderr redirected into the capture
+static bool run_captured(sandbox::OutputCapture& cap, const char* cmd) {
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        dup2(cap.child_fd(), STDOUT_FILENO);
+        dup2(cap.child_fd(), STDERR_FILENO);
+        execl("/bin/sh", "sh", "-c", cmd, (char*)nullptr);
+        _exit(127);
+    }
+    cap.close_child_end();
+    while (cap.read_fd() >= 0) {
+        struct pollfd pfd = { cap.read_fd(), POLLIN, 0 };
+        poll(&pfd, 1, 1000);
+        if (!cap.drain()) break;
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    cap.finish();
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool check(sandbox::CaptureMode mode, size_t limit, const char* cmd,
+                  const std::string& expected, bool expect_truncated) {
+    sandbox::CaptureOptions opts;
+    opts.mode = mode;
+    opts.limit = limit;
+    sandbox::OutputCapture cap;
+    if (!cap.open(opts)) {
+        std::cerr << "open failed" << std::endl;
+        return false;
+    }
+    if (!run_captured(cap, cmd)) {
+        std::cerr << "child failed for: " << cmd << std::endl;
+        return false;
+    }
+    std::string out = cap.str();
+    if (out != expected || cap.truncated() != expect_truncated || cap.size() != expected.size()) {
+        std::cerr << "unexpected capture for '" << cmd << "': '" << out << "' truncated="
+                  << cap.truncated() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    std::cout << "output_capture_test: starting" << std::endl;
+
+    if (!check(sandbox::CaptureMode::Capped, 10, "printf 0123456789abcdef", "0123456789", true)) return 2;
+    if (!check(sandbox::CaptureMode::Capped, 64, "printf hello", "hello", false)) return 2;
+    if (!check(sandbox::CaptureMode::Tail, 4, "printf 0123456789abcdef", "cdef", true)) return 2;
+    // Several small writes that wrap the ring
+    if (!check(sandbox::CaptureMode::Tail, 5, "printf abc; printf def; printf ghi", "efghi", true)) return 2;
+    if (!check(sandbox::CaptureMode::Handoff, 0, "printf 0123456789abcdef", "0123456789abcdef", false)) return 2;
+
+    std::cout << "output_capture_test: succeeded" << std::endl;
+    return 0;
+}
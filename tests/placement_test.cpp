@@ -0,0 +1,121 @@
+#include <iostream>
+#include <fstream>
+#include <set>
+#include <cstdlib>
+#include <unistd.h>
+#include "sandbox/placement.h"
+
+// Two NUMA nodes with four CPUs each, SMT pairs (0,1) (2,3) (4,5) (6,7)
+static sandbox::CpuTopology make_topology() {
+    sandbox::CpuTopology topo;
+    for (int id = 0; id < 8; ++id) {
+        sandbox::CpuTopology::Cpu cpu;
+        cpu.id = id;
+        cpu.core = id & ~1;
+        cpu.node = id / 4;
+        topo.cpus.push_back(cpu);
+    }
+    return topo;
+}
+
+int main() {
+    std::cout << "placement_test: starting" << std::endl;
+
+    auto ids = sandbox::parse_cpu_list("0-2,5,7-8");
+    if (ids != std::vector<int>{0, 1, 2, 5, 7, 8} || sandbox::format_cpu_list(ids) != "0-2,5,7-8") {
+        std::cerr << "placement_test: cpu list round trip failed: " << sandbox::format_cpu_list(ids) << std::endl;
+        return 2;
+    }
+
+    // One reactor CPU reserves its whole core (CPUs 0 and 1)
+    sandbox::CpuPlacer placer(make_topology(), 1);
+    if (placer.reactor_cpus() != std::vector<int>{0, 1} || placer.worker_cpus().size() != 6) {
+        std::cerr << "placement_test: unexpected reactor reservation" << std::endl;
+        return 2;
+    }
+
+    // Single-CPU leases spread over distinct worker CPUs and stay on one node
+    std::vector<sandbox::CpuLease> leases;
+    std::set<int> used;
+    for (int i = 0; i < 6; ++i) {
+        leases.push_back(placer.acquire(1));
+        const auto& l = leases.back();
+        if (!l.valid() || l.cpus().size() != 1 || l.nodes().size() != 1) {
+            std::cerr << "placement_test: bad lease " << i << std::endl;
+            return 2;
+        }
+        int cpu = l.cpus()[0];
+        if (cpu < 2 || !used.insert(cpu).second) {
+            std::cerr << "placement_test: lease " << i << " got cpu " << cpu << std::endl;
+            return 2;
+        }
+        if (l.nodes()[0] != cpu / 4) {
+            std::cerr << "placement_test: cpu " << cpu << " placed on wrong node" << std::endl;
+            return 2;
+        }
+    }
+    // The first lease goes to the idle node with more worker CPUs
+    if (leases[0].cpus()[0] / 4 != 1) {
+        std::cerr << "placement_test: first lease not on node 1" << std::endl;
+        return 2;
+    }
+
+    // Releasing a lease makes its CPU the least loaded again
+    int freed = leases[3].cpus()[0];
+    leases[3] = sandbox::CpuLease();
+    if (placer.load(freed) != 0) {
+        std::cerr << "placement_test: load not released" << std::endl;
+        return 2;
+    }
+    auto again = placer.acquire(1);
+    if (again.cpus()[0] != freed) {
+        std::cerr << "placement_test: expected freed cpu " << freed << ", got " << again.cpus()[0] << std::endl;
+        return 2;
+    }
+
+    // Limits carry the lease as cpuset lists
+    sandbox::CgroupLimits limits;
+    sandbox::CpuPlacer fresh(make_topology(), 1);
+    auto multi = fresh.acquire(4);
+    multi.apply_to(limits);
+    if (limits.cpuset_cpus != "4-7" || limits.cpuset_mems != "1") {
+        std::cerr << "placement_test: unexpected cpuset " << limits.cpuset_cpus << " / " << limits.cpuset_mems << std::endl;
+        return 2;
+    }
+
+    // A single CPU is shared rather than reserved
+    sandbox::CpuTopology one;
+    one.cpus.push_back({});
+    sandbox::CpuPlacer small(one, 1);
+    if (!small.reactor_cpus().empty() || !small.acquire(1).valid()) {
+        std::cerr << "placement_test: single-CPU fallback failed" << std::endl;
+        return 2;
+    }
+
+    // Reactor size from the config file
+    char conf[] = "/tmp/placement_test_XXXXXX";
+    int fd = mkstemp(conf);
+    if (fd < 0) {
+        std::cerr << "placement_test: mkstemp failed" << std::endl;
+        return 2;
+    }
+    close(fd);
+    std::ofstream(conf) << "# comment\n\nreactor_cpus 4  # two cores\n";
+    sandbox::PlacementConfig cfg;
+    bool parsed = sandbox::load_placement_config(conf, cfg) && cfg.reactor_cpus == 4;
+    std::ofstream(conf) << "reactor_cpus many\n";
+    bool rejected = !sandbox::load_placement_config(conf, cfg) && cfg.reactor_cpus == 4;
+    unlink(conf);
+    if (!parsed || !rejected) {
+        std::cerr << "placement_test: placement config parsing failed" << std::endl;
+        return 2;
+    }
+    sandbox::CpuPlacer wide(make_topology(), cfg.reactor_cpus);
+    if (wide.reactor_cpus() != std::vector<int>{0, 1, 2, 3} || wide.worker_cpus() != std::vector<int>{4, 5, 6, 7}) {
+        std::cerr << "placement_test: configured reactor size not reserved" << std::endl;
+        return 2;
+    }
+
+    std::cout << "placement_test: succeeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include "sandbox/policy.h"
+
+int main() {
+    std::cout << "policy_test: starting" << std::endl;
+    // Whitelist without getppid: the compiled filter must reject it in the child
+    const char* wf = "/tmp/native_node_policy_whitelist.conf";
+    FILE* f = fopen(wf, "w");
+    if (!f) {
+        std::cerr << "failed to create whitelist file" << std::endl;
+        return 2;
+    }
+    fprintf(f, "read\nwrite\nexit\nexit_group\ngetpid\n");
+    fclose(f);
+
+    sandbox::ScriptPolicyConfig cfg;
+    cfg.seccomp_whitelist = wf;
+    auto policy = sandbox::policy_cache().get(cfg);
+    if (!policy || !policy->has_seccomp()) {
+        std::cerr << "failed to compile policy" << std::endl;
+        return 2;
+    }
+    if (sandbox::policy_cache().get(cfg) != policy) {
+        std::cerr << "policy was not served from the cache" << std::endl;
+        return 2;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "fork failed: " << strerror(errno) << std::endl;
+        return 2;
+    }
+    if (pid == 0) {
+        if (!policy->apply_in_child()) _exit(3);
+        if (syscall(SYS_getpid) <= 0) _exit(4);
+        if (syscall(SYS_getppid) == -1 && errno == EPERM) _exit(0);
+        _exit(5);
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0) {
+        std::cerr << "waitpid failed" << std::endl;
+        return 2;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "policy_test: child failed (status=" << status << ")" << std::endl;
+        return 2;
+    }
+
+    std::cout << "policy_test: succeeded" << std::endl;
+    return 0;
+}
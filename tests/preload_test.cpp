@@ -0,0 +1,94 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "engine/preload.h"
+
+int main() {
+    std::cout << "preload_test: starting" << std::endl;
+    int rc = 2;
+
+    do {
+        // A diamond: root -> {a, b} -> join, plus independent leaves
+        engine::TaskGraph graph;
+        std::mutex mtx;
+        std::vector<std::string> order;
+        auto record = [&](const std::string& name) {
+            return [&, name] {
+                std::lock_guard<std::mutex> lk(mtx);
+                order.push_back(name);
+                return name != "fails";
+            };
+        };
+        auto root = graph.add("root", record("root"));
+        auto a = graph.add("a", record("a"), { root });
+        auto b = graph.add("b", record("b"), { root });
+        graph.add("join", record("join"), { a, b });
+        graph.add("fails", record("fails"));
+        for (int i = 0; i < 32; ++i) graph.add("leaf", record("leaf"));
+        size_t failed = graph.run(4);
+        auto pos = [&](const std::string& name) {
+            for (size_t i = 0; i < order.size(); ++i) if (order[i] == name) return i;
+            return order.size();
+        };
+        if (failed != 1 || order.size() != graph.size() || pos("root") > pos("a") || pos("root") > pos("b") ||
+            pos("a") > pos("join") || pos("b") > pos("join")) {
+            std::cerr << "preload_test: dependency order or failure count wrong" << std::endl;
+            break;
+        }
+
+        // Independent tasks run concurrently, whichever worker they started on
+        engine::TaskGraph parallel;
+        std::atomic<int> running{ 0 }, peak{ 0 };
+        for (int i = 0; i < 8; ++i) {
+            parallel.add("sleep", [&] {
+                int now = ++running;
+                for (int seen = peak; now > seen && !peak.compare_exchange_weak(seen, now);) {}
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                --running;
+                return true;
+            });
+        }
+        auto start = std::chrono::steady_clock::now();
+        parallel.run(4);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "8 x 50 ms on 4 workers: " << ms << " ms, peak " << peak << std::endl;
+        if (peak < 2 || ms >= 400) {
+            std::cerr << "preload_test: tasks did not run in parallel" << std::endl;
+            break;
+        }
+
+        // Cancelling skips tasks that have not started
+        engine::TaskGraph cancelled;
+        std::atomic<int> ran{ 0 };
+        auto first = cancelled.add("first", [&] {
+            cancelled.cancel();
+            ++ran;
+            return true;
+        });
+        for (int i = 0; i < 4; ++i) cancelled.add("after", [&] { ++ran; return true; }, { first });
+        cancelled.run(2);
+        if (ran != 1) {
+            std::cerr << "preload_test: cancel did not skip pending tasks" << std::endl;
+            break;
+        }
+
+        // Readiness bookkeeping
+        engine::PreloadStatus status;
+        status.set("a", engine::ScriptState::Pending);
+        status.set("b", engine::ScriptState::Ready);
+        status.set("a", engine::ScriptState::Failed);
+        engine::ScriptState state;
+        if (!status.get("a", state) || state != engine::ScriptState::Failed || status.get("c", state) ||
+            status.count(engine::ScriptState::Ready) != 1 || status.items().size() != 2 || status.items()[0].name != "a") {
+            std::cerr << "preload_test: status tracking" << std::endl;
+            break;
+        }
+        rc = 0;
+    } while (false);
+
+    if (rc == 0) std::cout << "preload_test: succeeded" << std::endl;
+    return rc;
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <dlfcn.h>
+#include "engine/prelude.h"
+
+namespace fs = std::filesystem;
+
+static void write_file(const fs::path& path, const std::string& text) {
+    std::ofstream ofs(path);
+    ofs << text;
+}
+
+int main() {
+    std::cout << "prelude_test: starting" << std::endl;
+    engine::CompilerConfig cfg = engine::default_compiler_config();
+    if (engine::toolchain_version(cfg.compiler).empty()) {
+        std::cout << "no C++ compiler available; skipping test" << std::endl;
+        return 0;
+    }
+
+    char tmpl[] = "/tmp/prelude_test_XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        std::cerr << "prelude_test: mkdtemp failed" << std::endl;
+        return 2;
+    }
+    fs::path root = tmpl;
+    fs::create_directories(root / "api");
+    std::string header = (root / "api" / "api.h").string();
+    std::string pch_dir = (root / "pch").string();
+    write_file(header, "#pragma once\n#include <string>\n#include <vector>\n#include \"helper.h\"\n");
+    write_file(root / "api" / "helper.h", "#pragma once\ninline int helper() { return 5; }\n");
+    int rc = 2;
+
+    do {
+        bool rebuilt = false;
+        engine::Prelude p1 = engine::build_prelude(header, pch_dir, cfg, &rebuilt);
+        if (!p1.valid() || !rebuilt || !fs::exists(p1.pch)) {
+            std::cerr << "prelude_test: initial build failed" << std::endl;
+            break;
+        }
+
+        // Unchanged headers and toolchain: reused as is
+        engine::Prelude p2 = engine::build_prelude(header, pch_dir, cfg, &rebuilt);
+        if (!p2.valid() || rebuilt || p2.key != p1.key) {
+            std::cerr << "prelude_test: unchanged header was rebuilt" << std::endl;
+            break;
+        }
+
+        // A change in an included local header produces a new version and drops the old one
+        write_file(root / "api" / "helper.h", "#pragma once\ninline int helper() { return 6; }\n");
+        engine::Prelude p3 = engine::build_prelude(header, pch_dir, cfg, &rebuilt);
+        if (!p3.valid() || !rebuilt || p3.key == p1.key || fs::exists(p1.pch)) {
+            std::cerr << "prelude_test: dependency change not picked up" << std::endl;
+            break;
+        }
+
+        // Scripts see the prelude without including anything
+        std::string src = (root / "script.cpp").string();
+        write_file(src, "extern \"C\" int answer() { return static_cast<int>(std::string(\"abc\").size()) + helper(); }\n");
+        engine::ScriptCache cache((root / "cache").string(), 64ULL << 20, cfg);
+        cache.set_extra_flags(p3.flags);
+        auto script = cache.load(src);
+        void* handle = script ? dlopen(script->path().c_str(), RTLD_NOW | RTLD_LOCAL) : nullptr;
+        auto fn = handle ? reinterpret_cast<int (*)()>(dlsym(handle, "answer")) : nullptr;
+        if (!fn || fn() != 9) {
+            std::cerr << "prelude_test: script did not build against the prelude" << std::endl;
+            break;
+        }
+        rc = 0;
+    } while (false);
+
+    fs::remove_all(root);
+    if (rc == 0) std::cout << "prelude_test: succeeded" << std::endl;
+    return rc;
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "sandbox/pressure.h"
+
+int main() {
+    std::cout << "pressure_test: starting" << std::endl;
+
+    sandbox::PressureStats stats;
+    const char* text = "some avg10=12.50 avg60=3.00 avg300=1.25 total=4242\n"
+                       "full avg10=0.75 avg60=0.10 avg300=0.00 total=17\n";
+    if (!sandbox::parse_pressure(text, stats) || stats.some.avg10 != 12.5 || stats.some.avg300 != 1.25 ||
+        stats.some.total != 4242 || stats.full.avg10 != 0.75 || stats.full.total != 17) {
+        std::cerr << "pressure_test: PSI parsing failed" << std::endl;
+        return 2;
+    }
+
+    // AIMD: grow by one while saturated and calm, back off multiplicatively
+    // under pressure, at most once per hold period
+    sandbox::AimdLimiter::Options opts;
+    opts.min_limit = 1;
+    opts.max_limit = 10;
+    opts.initial = 4;
+    opts.hold = std::chrono::milliseconds(1000);
+    sandbox::AimdLimiter aimd(opts);
+    auto t0 = std::chrono::steady_clock::now();
+    sandbox::PressureSample calm, busy;
+    busy.cpu.some.avg10 = 80.0;
+    if (aimd.update(calm, true, t0) != 5 || aimd.update(calm, false, t0) != 5) {
+        std::cerr << "pressure_test: additive increase wrong" << std::endl;
+        return 2;
+    }
+    if (aimd.update(busy, true, t0) != 3 || aimd.update(busy, true, t0 + std::chrono::milliseconds(10)) != 3) {
+        std::cerr << "pressure_test: multiplicative decrease wrong" << std::endl;
+        return 2;
+    }
+    sandbox::PressureSample trig;
+    trig.triggered = true;
+    if (aimd.update(trig, true, t0 + std::chrono::milliseconds(1500)) != 2 ||
+        aimd.update(trig, true, t0 + std::chrono::milliseconds(3000)) != 1 ||
+        aimd.update(trig, true, t0 + std::chrono::milliseconds(4500)) != 1) {
+        std::cerr << "pressure_test: trigger back-off or floor wrong" << std::endl;
+        return 2;
+    }
+    for (int i = 0; i < 20; ++i) aimd.update(calm, true, t0);
+    if (aimd.limit() != 10) {
+        std::cerr << "pressure_test: limit exceeded max" << std::endl;
+        return 2;
+    }
+
+    // Monitor delivers samples on its interval
+    sandbox::PressureFiles files = sandbox::invocation_parent_pressure_files();
+    sandbox::PressureStats probe;
+    if (!sandbox::read_pressure(files.cpu, probe)) {
+        std::cout << "PSI not available; skipping monitor check" << std::endl;
+        std::cout << "pressure_test: succeeded" << std::endl;
+        return 0;
+    }
+    std::atomic<int> samples{0};
+    sandbox::PressureMonitor mon;
+    sandbox::PressureMonitor::Options mopts;
+    mopts.interval = std::chrono::milliseconds(20);
+    if (!mon.start(files, mopts, [&](const sandbox::PressureSample&) { ++samples; })) {
+        std::cerr << "pressure_test: monitor failed to start" << std::endl;
+        return 2;
+    }
+    for (int i = 0; i < 100 && samples < 2; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    mon.stop();
+    if (samples < 2) {
+        std::cerr << "pressure_test: monitor delivered " << samples << " samples" << std::endl;
+        return 2;
+    }
+
+    std::cout << "pressure_test: succeeded" << std::endl;
+    return 0;
+}
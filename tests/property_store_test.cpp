@@ -0,0 +1,161 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "services/property_store.h"
+#include "services/sqlite_pool.h"
+#include "services/sqlite_writer.h"
+
+using services::PropertyScope;
+
+static std::string name(const char* prefix, int i) {
+    std::string s(prefix);
+    s.append(std::to_string(i));
+    return s;
+}
+
+int main() {
+    std::cout << "property_store_test: starting" << std::endl;
+    const std::string dbpath = "/tmp/native_node_property_store_test.db";
+    std::remove(dbpath.c_str());
+    int rc = 2;
+
+    do {
+        services::SQLiteWriter writer(dbpath);
+        services::SQLitePoolOptions ropts;
+        ropts.read_only = true;
+        services::SQLiteConnectionPool readers(dbpath, 2, ropts);
+        if (!writer.start() || !writer.execute("PRAGMA user_version = 1;").get() || !readers.initialize()) {
+            std::cerr << "property_store_test: sqlite" << std::endl;
+            break;
+        }
+
+        services::PropertyStoreOptions opts;
+        opts.flush_interval_ms = 50;
+        uint64_t commits_before;
+        {
+            services::PropertyStore store(opts);
+            if (!store.start(&writer, &readers)) {
+                std::cerr << "property_store_test: start" << std::endl;
+                break;
+            }
+
+            // Scopes and owners are separate namespaces
+            store.set(PropertyScope::Script, "mailer", "api_key", "s");
+            store.set(PropertyScope::User, "mailer", "api_key", "u");
+            store.set(PropertyScope::Global, "", "api_key", "g");
+            store.set(PropertyScope::Script, "mail", "erapi_key", "other owner");
+            std::string v;
+            if (!store.get(PropertyScope::Script, "mailer", "api_key", v) || v != "s" ||
+                !store.get(PropertyScope::User, "mailer", "api_key", v) || v != "u" ||
+                !store.get(PropertyScope::Global, "", "api_key", v) || v != "g" ||
+                store.get(PropertyScope::Script, "mail", "api_key", v) ||
+                store.list(PropertyScope::Script, "mailer").size() != 1) {
+                std::cerr << "property_store_test: scopes" << std::endl;
+                break;
+            }
+
+            // TTL
+            store.set(PropertyScope::Script, "mailer", "token", "t", std::chrono::milliseconds(30));
+            store.set(PropertyScope::Script, "mailer", "short", "x", std::chrono::milliseconds(1));
+            if (!store.get(PropertyScope::Script, "mailer", "token", v)) {
+                std::cerr << "property_store_test: ttl entry missing early" << std::endl;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(40));
+            if (store.get(PropertyScope::Script, "mailer", "token", v)) {
+                std::cerr << "property_store_test: ttl entry still visible" << std::endl;
+                break;
+            }
+
+            // A burst of writes from several threads becomes a few transactions
+            if (!store.flush()) {
+                std::cerr << "property_store_test: flush" << std::endl;
+                break;
+            }
+            commits_before = store.flushes();
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; ++t) {
+                threads.emplace_back([&store, t] {
+                    for (int i = 0; i < 5000; ++i) {
+                        store.set(PropertyScope::User, name("user", t), name("k", i % 1000), std::to_string(i));
+                    }
+                });
+            }
+            for (auto& th : threads) th.join();
+            store.remove(PropertyScope::Global, "", "api_key");
+            store.stop();
+            uint64_t transactions = store.flushes() - commits_before;
+            std::cout << "20000 writes to 4000 keys persisted in " << transactions << " transactions" << std::endl;
+            if (transactions == 0 || transactions > 20) {
+                std::cerr << "property_store_test: write-behind not batched" << std::endl;
+                break;
+            }
+        }
+
+        // A new store warm-loads what was persisted: latest values, no
+        // removed or expired properties
+        services::PropertyStore store(opts);
+        if (!store.start(&writer, &readers)) {
+            std::cerr << "property_store_test: restart" << std::endl;
+            break;
+        }
+        std::string v;
+        if (store.size() != 4003 || !store.get(PropertyScope::User, "user2", "k999", v) || v != "4999" ||
+            !store.get(PropertyScope::Script, "mailer", "api_key", v) || v != "s" ||
+            store.get(PropertyScope::Global, "", "api_key", v) || store.get(PropertyScope::Script, "mailer", "token", v)) {
+            std::cerr << "property_store_test: warm load (" << store.size() << " properties)" << std::endl;
+            break;
+        }
+
+        // The final flush swept the expired rows, through the expiry index
+        {
+            auto conn = readers.acquire();
+            auto expired = conn.prepare("SELECT COUNT(*) FROM properties WHERE expires_at != 0 AND expires_at <= ?;");
+            auto plan = conn.prepare("EXPLAIN QUERY PLAN DELETE FROM properties WHERE expires_at != 0 AND expires_at <= ?;");
+            if (!expired || !plan) {
+                std::cerr << "property_store_test: prepare" << std::endl;
+                break;
+            }
+            sqlite3_bind_int64(expired.get(), 1, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                     std::chrono::system_clock::now().time_since_epoch()).count());
+            std::string detail;
+            while (sqlite3_step(plan.get()) == SQLITE_ROW) detail += reinterpret_cast<const char*>(sqlite3_column_text(plan.get(), 3));
+            if (sqlite3_step(expired.get()) != SQLITE_ROW || sqlite3_column_int(expired.get(), 0) != 0 ||
+                detail.find("properties_expires_at") == std::string::npos) {
+                std::cerr << "property_store_test: expiry sweep (plan: " << detail << ")" << std::endl;
+                break;
+            }
+        }
+
+        // Hits stay in memory: concurrent readers of different keys
+        const int N = 200000;
+        uint64_t commits = writer.commits();
+        std::atomic<long> found{ 0 };
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                std::string value;
+                std::string owner = name("user", t);
+                for (int i = 0; i < N; ++i) found += store.get(PropertyScope::User, owner, name("k", i % 1000), value);
+            });
+        }
+        for (auto& th : threads) th.join();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "get: " << ns / (4 * N) << " ns per hit across 4 threads" << std::endl;
+        if (found != 4 * N || writer.commits() != commits) {
+            std::cerr << "property_store_test: reads" << std::endl;
+            break;
+        }
+        store.stop();
+        rc = 0;
+    } while (false);
+
+    std::remove(dbpath.c_str());
+    if (rc == 0) std::cout << "property_store_test: succeeded" << std::endl;
+    return rc;
+}
@@ -0,0 +1,195 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+#include "services/query_cache.h"
+#include "services/sqlite_pool.h"
+#include "services/sqlite_query_guard.h"
+#include "services/sqlite_writer.h"
+
+using services::QueryCache;
+
+static bool has(std::vector<std::string> tables, const std::string& t) {
+    return std::find(tables.begin(), tables.end(), t) != tables.end();
+}
+
+int main() {
+    std::cout << "query_cache_test: starting" << std::endl;
+    const std::string dbpath = "/tmp/native_node_query_cache_test.db";
+    std::remove(dbpath.c_str());
+    int rc = 2;
+
+    do {
+        // Keys: comments, whitespace outside literals and a trailing ';' don't matter,
+        // literals and parameters do
+        if (QueryCache::key("SELECT  *\n FROM t ;", {}) != QueryCache::key("SELECT * FROM t", {}) ||
+            QueryCache::key("SELECT 'a  b'", {}) == QueryCache::key("SELECT 'a b'", {}) ||
+            QueryCache::key("SELECT ?", { "1" }) == QueryCache::key("SELECT ?", { "2" }) ||
+            QueryCache::key("SELECT ?", { "a", "b" }) == QueryCache::key("SELECT ?", { "ab" }) ||
+            QueryCache::key("SELECT * -- all\nFROM t /* the t */;", {}) != QueryCache::key("SELECT * FROM t", {}) ||
+            QueryCache::key("SELECT 1 -- x", {}) != QueryCache::key("SELECT 1", {}) ||
+            QueryCache::key("SELECT '--', 1 /* '*/", {}) == QueryCache::key("SELECT '--', 2", {}) ||
+            QueryCache::key("SELECT [a  b]", {}) == QueryCache::key("SELECT [a b]", {})) {
+            std::cerr << "query_cache_test: keys" << std::endl;
+            break;
+        }
+
+        // Per-table invalidation, stamps, budget
+        {
+            QueryCache cache(1000, 400);
+            auto stamp = cache.begin();
+            cache.put("a", { "users" }, "A", stamp);
+            cache.put("b", { "orders", "Users" }, "B", stamp);
+            cache.put("c", { "orders" }, "C", stamp);
+            cache.invalidate({ "USERS" });
+            if (cache.get("a") || cache.get("b") || !cache.get("c") || cache.invalidations() != 2) {
+                std::cerr << "query_cache_test: per-table invalidation" << std::endl;
+                break;
+            }
+            // A fill that started before the change is not kept
+            if (cache.put("a", { "users" }, "stale", stamp) || !cache.put("a", { "users" }, "A", cache.begin())) {
+                std::cerr << "query_cache_test: stale fill kept" << std::endl;
+                break;
+            }
+            if (cache.put("big", {}, std::string(500, 'x'), cache.begin())) {
+                std::cerr << "query_cache_test: oversized entry kept" << std::endl;
+                break;
+            }
+            stamp = cache.begin();
+            cache.put("d", { "t" }, std::string(390, 'd'), stamp);
+            cache.put("e", { "t" }, std::string(390, 'e'), stamp);
+            cache.get("d");
+            cache.put("f", { "t" }, std::string(390, 'f'), stamp); // evicts e, the least recently used
+            if (!cache.get("d") || cache.get("e") || !cache.get("f") || cache.bytes() > 1000) {
+                std::cerr << "query_cache_test: budget" << std::endl;
+                break;
+            }
+            cache.invalidate({ QueryCache::ALL_TABLES });
+            if (cache.size() != 0 || cache.bytes() != 0 || cache.put("g", {}, "G", stamp)) {
+                std::cerr << "query_cache_test: invalidate all" << std::endl;
+                break;
+            }
+        }
+
+        // Commits through the writer invalidate exactly the tables they touch
+        QueryCache cache(1 << 20, 1 << 16);
+        services::SQLiteWriterOptions wopts;
+        services::ReadQueryGuard guard(dbpath);
+        wopts.on_tables_changed = [&cache, &guard](const std::vector<std::string>& tables) {
+            cache.invalidate(tables);
+            guard.invalidate(tables);
+        };
+        services::SQLiteWriter writer(dbpath, wopts);
+        services::SQLitePoolOptions ropts;
+        ropts.read_only = true;
+        services::SQLiteConnectionPool readers(dbpath, 1, ropts);
+        if (!writer.start() ||
+            !writer.execute("CREATE TABLE users(id INTEGER PRIMARY KEY, name TEXT);"
+                            "CREATE TABLE orders(id INTEGER PRIMARY KEY, user INTEGER, total REAL);"
+                            "CREATE TABLE kv(k TEXT PRIMARY KEY, v TEXT) WITHOUT ROWID;"
+                            "CREATE VIEW big_orders AS SELECT * FROM orders WHERE total > 100;"
+                            "INSERT INTO users VALUES(1, 'ann'); INSERT INTO orders VALUES(1, 1, 250);").get() ||
+            !readers.initialize()) {
+            std::cerr << "query_cache_test: sqlite" << std::endl;
+            break;
+        }
+        services::ReadQueryInfo info;
+        std::string error;
+        if (!guard.open() || !guard.check("SELECT u.name FROM users u JOIN big_orders o ON o.user = u.id", error, &info) ||
+            !services::cacheable_query(info) || !has(info.tables, "users") || !has(info.tables, "orders")) {
+            std::cerr << "query_cache_test: tables of a join through a view" << std::endl;
+            break;
+        }
+        // The verdict is remembered under the normalized SQL
+        uint64_t prepares = guard.prepares();
+        info = {};
+        if (!guard.check("SELECT u.name FROM users u\n  JOIN big_orders o ON o.user = u.id; -- again", error, &info) ||
+            guard.prepares() != prepares || !has(info.tables, "orders")) {
+            std::cerr << "query_cache_test: verdict not reused" << std::endl;
+            break;
+        }
+        if (!guard.check("SELECT random() FROM users", error, &info) || services::cacheable_query(info) ||
+            !guard.check("SELECT DateTime('now')", error, &info) || services::cacheable_query(info)) {
+            std::cerr << "query_cache_test: volatile query deemed cacheable" << std::endl;
+            break;
+        }
+
+        auto fill = [&cache](const std::string& key, std::vector<std::string> tables) {
+            return cache.put(key, tables, "result", cache.begin());
+        };
+        fill("users", { "users" });
+        fill("orders", { "orders" });
+        fill("kv", { "kv" });
+        writer.execute("INSERT INTO orders VALUES(2, 1, 5);").get();
+        if (!cache.get("users") || cache.get("orders") || !cache.get("kv")) {
+            std::cerr << "query_cache_test: insert invalidated the wrong tables" << std::endl;
+            break;
+        }
+        // WITHOUT ROWID tables are missed by the update hook
+        writer.execute("INSERT INTO kv VALUES('a', 'b');").get();
+        if (cache.get("kv") || !cache.get("users")) {
+            std::cerr << "query_cache_test: WITHOUT ROWID insert not seen" << std::endl;
+            break;
+        }
+        // So are whole-table DELETEs (truncate optimization)
+        writer.execute("DELETE FROM users;").get();
+        if (cache.get("users")) {
+            std::cerr << "query_cache_test: truncating delete not seen" << std::endl;
+            break;
+        }
+        // A failed transaction changes nothing visible, but may still
+        // invalidate; a read-only one must not
+        fill("users", { "users" });
+        writer.submit([](sqlite3* db) {
+            return sqlite3_exec(db, "SELECT COUNT(*) FROM users;", nullptr, nullptr, nullptr) == SQLITE_OK;
+        }).get();
+        if (!cache.get("users")) {
+            std::cerr << "query_cache_test: a read invalidated" << std::endl;
+            break;
+        }
+        writer.execute("DROP VIEW big_orders;").get();
+        if (cache.size() != 0) {
+            std::cerr << "query_cache_test: schema change kept entries" << std::endl;
+            break;
+        }
+        if (guard.check("SELECT u.name FROM users u JOIN big_orders o ON o.user = u.id", error)) {
+            std::cerr << "query_cache_test: verdict outlived the schema change" << std::endl;
+            break;
+        }
+        writer.execute("CREATE TABLE later(x INTEGER);").get();
+        if (!guard.check("SELECT x FROM later", error)) {
+            std::cerr << "query_cache_test: guard missed a new table: " << error << std::endl;
+            break;
+        }
+
+        // Hit vs running the query
+        writer.execute("WITH RECURSIVE n(i) AS (SELECT 2 UNION ALL SELECT i + 1 FROM n WHERE i < 500) "
+                       "INSERT INTO orders SELECT i + 10, i % 7, i * 1.5 FROM n;").get();
+        const std::string sql = "SELECT user, COUNT(*), SUM(total) FROM orders GROUP BY user";
+        const int N = 2000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) {
+            auto c = readers.acquire();
+            auto stmt = c.prepare(sql);
+            while (sqlite3_step(stmt.get()) == SQLITE_ROW) {}
+        }
+        auto query_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / N;
+        std::string key = QueryCache::key(sql, { "json" });
+        fill(key, { "orders" });
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) cache.get(key);
+        auto hit_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / N;
+        std::cout << "dashboard query: " << query_ns << " ns from SQLite, " << hit_ns << " ns from the cache" << std::endl;
+
+        readers.shutdown();
+        writer.stop();
+        rc = 0;
+    } while (false);
+
+    std::remove(dbpath.c_str());
+    if (rc == 0) std::cout << "query_cache_test: succeeded" << std::endl;
+    return rc;
+}
@@ -0,0 +1,152 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "engine/repl_pool.h"
+
+// Drives the pool with /bin/sh standing in for clang-repl: same line protocol
+// (trailing '\' continues a line), with an echo as the sentinel.
+static engine::ReplOptions shell_options() {
+    engine::ReplOptions opts;
+    opts.command = "/bin/sh";
+    opts.preload = { "GREETING=hello" };
+    opts.sentinel = [](const std::string& marker) { return "echo; echo " + marker; };
+    opts.prompt.clear();
+    opts.startup_timeout_ms = 5000;
+    return opts;
+}
+
+int main() {
+    std::cout << "repl_pool_test: starting" << std::endl;
+    int rc = 2;
+
+    do {
+        engine::ReplSession session(shell_options());
+        if (!session.start()) {
+            std::cerr << "repl_pool_test: session failed to start" << std::endl;
+            break;
+        }
+        // Preloaded state is visible to evaluations
+        auto r = session.evaluate("echo $GREETING", 2000);
+        if (!r.ok || r.output != "hello") {
+            std::cerr << "repl_pool_test: unexpected output '" << r.output << "'" << std::endl;
+            break;
+        }
+        // Multi-line input is submitted as one continued line
+        r = session.evaluate("echo a\necho b", 2000);
+        if (!r.ok || r.output != "a echo b") {
+            std::cerr << "repl_pool_test: continuation output '" << r.output << "'" << std::endl;
+            break;
+        }
+        // A // comment is dropped rather than continued over the next line
+        r = session.evaluate("echo a // note\necho b", 2000);
+        if (!r.ok || r.output != "a echo b") {
+            std::cerr << "repl_pool_test: comment output '" << r.output << "'" << std::endl;
+            break;
+        }
+        // A directive ends the code before it and goes in on its own line
+        r = session.evaluate("echo a\n#define X\necho b\necho c", 2000);
+        if (!r.ok || r.output != "a\nb echo c") {
+            std::cerr << "repl_pool_test: directive output '" << r.output << "'" << std::endl;
+            break;
+        }
+        // Diagnostics mark the result as failed but keep the session
+        r = session.evaluate("echo 'error: bad input'", 2000);
+        if (r.ok || !session.running() || !session.healthy()) {
+            std::cerr << "repl_pool_test: diagnostic handling" << std::endl;
+            break;
+        }
+        if (session.evaluations() != 5 || session.rss_bytes() == 0) {
+            std::cerr << "repl_pool_test: bookkeeping evals=" << session.evaluations() << std::endl;
+            break;
+        }
+        // A session outlives the thread that started it
+        engine::ReplSession detached(shell_options());
+        bool started = false;
+        std::thread([&] { started = detached.start(); }).join();
+        r = detached.evaluate("echo alive", 2000);
+        if (!started || !r.ok || r.output != "alive") {
+            std::cerr << "repl_pool_test: session died with its starting thread" << std::endl;
+            break;
+        }
+        // A hung evaluation times out and kills the session
+        r = session.evaluate("sleep 5", 200);
+        if (!r.timed_out || r.ok || session.running()) {
+            std::cerr << "repl_pool_test: timeout not enforced" << std::endl;
+            break;
+        }
+
+        // Pool: state persists within a session, recycling after max_evaluations resets it
+        auto opts = shell_options();
+        opts.max_evaluations = 3;
+        engine::ReplPool pool(1, opts);
+        if (pool.warm() != 1) {
+            std::cerr << "repl_pool_test: warm failed" << std::endl;
+            break;
+        }
+        pool.evaluate("N=1");
+        r = pool.evaluate("N=$((N+1)); echo $N");
+        if (r.output != "2") {
+            std::cerr << "repl_pool_test: state not kept, got '" << r.output << "'" << std::endl;
+            break;
+        }
+        pool.evaluate("true"); // third evaluation triggers recycling
+        r = pool.evaluate("echo ${N:-unset}");
+        if (pool.recycled() != 1 || r.output != "unset") {
+            std::cerr << "repl_pool_test: recycle after max_evaluations, recycled=" << pool.recycled() << std::endl;
+            break;
+        }
+
+        // An RSS threshold below any real process recycles after every evaluation
+        auto tiny = shell_options();
+        tiny.max_rss_bytes = 1;
+        engine::ReplPool small(1, tiny);
+        small.evaluate("true");
+        small.evaluate("true");
+        if (small.recycled() != 2) {
+            std::cerr << "repl_pool_test: RSS recycling, recycled=" << small.recycled() << std::endl;
+            break;
+        }
+        if (small.check_health() != 0) {
+            std::cerr << "repl_pool_test: healthy session restarted" << std::endl;
+            break;
+        }
+
+        // A session killed while idle is restarted by the background check...
+        auto watched_opts = shell_options();
+        watched_opts.health_check_interval_ms = 50;
+        engine::ReplPool watched(1, watched_opts);
+        watched.evaluate("N=1; (sleep 0.1; kill -9 $$) &");
+        for (int i = 0; i < 100 && watched.recycled() == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        r = watched.evaluate("echo ${N:-unset}");
+        if (watched.recycled() != 1 || !r.ok || r.output != "unset") {
+            std::cerr << "repl_pool_test: dead session not restarted by the health check" << std::endl;
+            break;
+        }
+        // ...and, without it, before the next evaluation
+        auto unwatched_opts = shell_options();
+        unwatched_opts.health_check_interval_ms = 0;
+        engine::ReplPool unwatched(1, unwatched_opts);
+        unwatched.evaluate("(sleep 0.1; kill -9 $$) &");
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        r = unwatched.evaluate("echo alive");
+        if (!r.ok || r.output != "alive") {
+            std::cerr << "repl_pool_test: evaluated on a dead session: '" << r.output << "'" << std::endl;
+            break;
+        }
+
+        // A missing binary fails cleanly
+        auto missing = shell_options();
+        missing.command = "/nonexistent/clang-repl";
+        missing.startup_timeout_ms = 1000;
+        engine::ReplPool broken(1, missing);
+        if (broken.warm() != 0 || broken.evaluate("true").ok) {
+            std::cerr << "repl_pool_test: missing binary accepted" << std::endl;
+            break;
+        }
+        rc = 0;
+    } while (false);
+
+    if (rc == 0) std::cout << "repl_pool_test: succeeded" << std::endl;
+    return rc;
+}
@@ -0,0 +1,140 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <dlfcn.h>
+#include <unistd.h>
+#include "engine/script_cache.h"
+
+namespace fs = std::filesystem;
+
+static void write_script(const std::string& path, int value) {
+    std::ofstream ofs(path);
+    ofs << "extern \"C\" int answer() { return " << value << "; }\n";
+}
+
+static int call_answer(const std::shared_ptr<engine::CompiledScript>& s) {
+    // The cache only builds objects; load them here as a worker would
+    void* handle = s ? dlopen(s->path().c_str(), RTLD_NOW | RTLD_LOCAL) : nullptr;
+    auto fn = handle ? reinterpret_cast<int (*)()>(dlsym(handle, "answer")) : nullptr;
+    int result = fn ? fn() : -1;
+    if (handle) dlclose(handle);
+    return result;
+}
+
+int main() {
+    std::cout << "script_cache_test: starting" << std::endl;
+    engine::CompilerConfig cfg = engine::default_compiler_config();
+    if (engine::toolchain_version(cfg.compiler).empty()) {
+        std::cout << "no C++ compiler available; skipping test" << std::endl;
+        return 0;
+    }
+
+    char tmpl[] = "/tmp/script_cache_test_XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        std::cerr << "script_cache_test: mkdtemp failed" << std::endl;
+        return 2;
+    }
+    std::string root = tmpl;
+    std::string src = root + "/answer.cpp";
+    std::string cache_dir = root + "/cache";
+    int rc = 2;
+
+    do {
+        // Keys depend on flags and toolchain as well as source
+        engine::CompilerConfig o0 = cfg;
+        o0.flags.push_back("-O0");
+        if (engine::script_cache_key("x", cfg, "v1") == engine::script_cache_key("x", o0, "v1") ||
+            engine::script_cache_key("x", cfg, "v1") == engine::script_cache_key("x", cfg, "v2")) {
+            std::cerr << "script_cache_test: key ignores flags or toolchain" << std::endl;
+            break;
+        }
+
+        write_script(src, 42);
+        {
+            engine::ScriptCache cache(cache_dir, 64ULL << 20, cfg);
+            auto s1 = cache.load(src);
+            auto s2 = cache.load(src);
+            if (!s1 || call_answer(s1) != 42 || s1 != s2 || cache.compiles() != 1) {
+                std::cerr << "script_cache_test: first load/compile failed" << std::endl;
+                break;
+            }
+        }
+
+        // A restart (new cache instance) reuses the object without compiling
+        engine::ScriptCache cache(cache_dir, 64ULL << 20, cfg);
+        auto s3 = cache.load(src);
+        if (!s3 || call_answer(s3) != 42 || cache.compiles() != 0 || cache.hits() != 1) {
+            std::cerr << "script_cache_test: restart recompiled" << std::endl;
+            break;
+        }
+
+        // A changed source gets a new key and is rebuilt
+        sleep(1); // make sure mtime moves on coarse-grained filesystems
+        write_script(src, 7);
+        auto s4 = cache.load(src);
+        if (!s4 || call_answer(s4) != 7 || s4->key() == s3->key() || cache.compiles() != 1) {
+            std::cerr << "script_cache_test: changed source not rebuilt" << std::endl;
+            break;
+        }
+
+        // So does one whose local header changed, even two includes deep
+        {
+            std::string with_header = root + "/with_header.cpp";
+            std::ofstream(root + "/outer.h") << "#include \"inner.h\"\n";
+            std::ofstream(root + "/inner.h") << "constexpr int VALUE = 1;\n";
+            std::ofstream(with_header) << "#include \"outer.h\"\nextern \"C\" int answer() { return VALUE; }\n";
+            auto before = cache.load(with_header);
+            sleep(1);
+            std::ofstream(root + "/inner.h") << "constexpr int VALUE = 2;\n";
+            auto after = cache.load(with_header);
+            if (!before || !after || after->key() == before->key() || call_answer(after) != 2) {
+                std::cerr << "script_cache_test: changed header not rebuilt" << std::endl;
+                break;
+            }
+            fs::remove(before->path());
+            fs::remove(after->path());
+        }
+
+        // An edit made after hashing but before the compiler reads the file is
+        // not filed under the old key: the object is dropped and rebuilt
+        {
+            std::string racy = root + "/racy.cpp";
+            engine::CompilerConfig slow_cfg = cfg;
+            slow_cfg.compiler = root + "/slow-c++";
+            std::ofstream(slow_cfg.compiler) << "#!/bin/sh\nfor a; do case \"$a\" in *.cpp) grep -q SLOW \"$a\" && sleep 1;; esac; done\n"
+                                             << "exec " << cfg.compiler << " \"$@\"\n";
+            fs::permissions(slow_cfg.compiler, fs::perms::owner_exec, fs::perm_options::add);
+            engine::ScriptCache slow_cache(root + "/slow-cache", 64ULL << 20, slow_cfg);
+            std::ofstream(racy) << "// SLOW\nextern \"C\" int answer() { return 1; }\n";
+            std::shared_ptr<engine::CompiledScript> raced;
+            std::thread loader([&] { raced = slow_cache.load(racy); });
+            usleep(300 * 1000);
+            write_script(racy, 2);
+            loader.join();
+            auto now = slow_cache.load(racy);
+            size_t objects = 0;
+            for (const auto& e : fs::directory_iterator(root + "/slow-cache")) objects += e.path().extension() == ".so";
+            if (!raced || call_answer(raced) != 2 || raced->key() != now->key() || objects != 1) {
+                std::cerr << "script_cache_test: object built from newer source kept under the old key" << std::endl;
+                break;
+            }
+        }
+
+        // Over the size bound, the least recently used unreferenced object goes first
+        std::string old_path = s3->path();
+        s3.reset();
+        engine::ScriptCache bounded(cache_dir, fs::file_size(s4->path()), cfg);
+        auto s5 = bounded.load(src);
+        if (!s5 || bounded.evict() != 1 || fs::exists(old_path) || !fs::exists(s5->path())) {
+            std::cerr << "script_cache_test: eviction removed the wrong objects" << std::endl;
+            break;
+        }
+        rc = 0;
+    } while (false);
+
+    fs::remove_all(root);
+    if (rc == 0) std::cout << "script_cache_test: succeeded" << std::endl;
+    return rc;
+}
@@ -0,0 +1,177 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <dlfcn.h>
+#include "engine/script_registry.h"
+
+namespace fs = std::filesystem;
+
+static void write_script(const fs::path& path, const std::string& body) {
+    // Write and rename, the way editors save
+    fs::path tmp = path;
+    tmp += ".swp";
+    std::ofstream(tmp) << "extern \"C\" int answer() { " << body << " }\n";
+    fs::rename(tmp, path);
+}
+
+static int call_answer(const std::shared_ptr<engine::CompiledScript>& s) {
+    // The cache only builds objects; load them here as a worker would
+    void* handle = s ? dlopen(s->path().c_str(), RTLD_NOW | RTLD_LOCAL) : nullptr;
+    auto fn = handle ? reinterpret_cast<int (*)()>(dlsym(handle, "answer")) : nullptr;
+    int result = fn ? fn() : -1;
+    if (handle) dlclose(handle);
+    return result;
+}
+
+// Wait for the watcher to publish a new generation
+static bool wait_generation(const engine::ScriptRegistry& reg, uint64_t after, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (reg.generation() == after) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+int main() {
+    std::cout << "script_registry_test: starting" << std::endl;
+    engine::CompilerConfig cfg = engine::default_compiler_config();
+    if (engine::toolchain_version(cfg.compiler).empty()) {
+        std::cout << "no C++ compiler available; skipping test" << std::endl;
+        return 0;
+    }
+
+    char tmpl[] = "/tmp/script_registry_test_XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        std::cerr << "script_registry_test: mkdtemp failed" << std::endl;
+        return 2;
+    }
+    fs::path root = tmpl;
+    fs::path scripts = root / "scripts";
+    fs::create_directories(scripts / "sub");
+    write_script(scripts / "a.cpp", "return 1;");
+    write_script(scripts / "sub" / "b.cpp", "return 2;");
+    std::ofstream(scripts / "notes.txt") << "not a script\n";
+    int rc = 2;
+
+    do {
+        engine::ScriptCache cache((root / "cache").string(), 64ULL << 20, cfg);
+        engine::ScriptRegistry reg(scripts.string(), cache);
+        size_t failed = 0;
+        if (reg.load_all(&failed) != 2 || failed != 0 || call_answer(reg.get("a")) != 1 ||
+            call_answer(reg.get("sub/b")) != 2 || reg.get("notes")) {
+            std::cerr << "script_registry_test: load_all" << std::endl;
+            break;
+        }
+        if (!reg.start_watching()) {
+            std::cerr << "script_registry_test: inotify unavailable" << std::endl;
+            break;
+        }
+
+        // An edit is recompiled and swapped in; a holder of the old version keeps it
+        auto in_flight = reg.get("a");
+        uint64_t gen = reg.generation();
+        auto start = std::chrono::steady_clock::now();
+        write_script(scripts / "a.cpp", "return 10;");
+        if (!wait_generation(reg, gen, 30000)) {
+            std::cerr << "script_registry_test: edit not picked up" << std::endl;
+            break;
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "edit to live: " << ms << " ms" << std::endl;
+        if (call_answer(reg.get("a")) != 10 || call_answer(in_flight) != 1) {
+            std::cerr << "script_registry_test: swap did not preserve the old version" << std::endl;
+            break;
+        }
+
+        // A broken edit keeps serving the previous version
+        std::ofstream(scripts / "a.cpp") << "this does not compile\n";
+        if (reg.reload((scripts / "a.cpp").string()) || call_answer(reg.get("a")) != 10) {
+            std::cerr << "script_registry_test: broken edit replaced the live version" << std::endl;
+            break;
+        }
+
+        // New and deleted scripts are published and withdrawn
+        gen = reg.generation();
+        write_script(scripts / "c.cpp", "return 3;");
+        if (!wait_generation(reg, gen, 30000) || call_answer(reg.get("c")) != 3) {
+            std::cerr << "script_registry_test: new script not published" << std::endl;
+            break;
+        }
+        gen = reg.generation();
+        fs::remove(scripts / "c.cpp");
+        if (!wait_generation(reg, gen, 5000) || reg.get("c")) {
+            std::cerr << "script_registry_test: deleted script still live" << std::endl;
+            break;
+        }
+        reg.stop_watching();
+
+        // Overlapping reloads: a compile that read the source first and finishes
+        // last must not publish over the newer version, nor revive a deleted one
+        engine::CompilerConfig slow_cfg = cfg;
+        slow_cfg.compiler = (root / "slow-c++").string();
+        std::ofstream(slow_cfg.compiler) << "#!/bin/sh\nslow=\nfor a; do case \"$a\" in *.cpp) grep -q SLOW \"$a\" && slow=1;; esac; done\n"
+                                         << cfg.compiler << " \"$@\" || exit 1\n[ -z \"$slow\" ] || sleep 1\n";
+        fs::permissions(slow_cfg.compiler, fs::perms::owner_exec, fs::perm_options::add);
+        engine::ScriptCache slow_cache((root / "slow-cache").string(), 64ULL << 20, slow_cfg);
+        engine::ScriptRegistry raced(scripts.string(), slow_cache);
+        write_script(scripts / "d.cpp", "/* SLOW */ return 4;");
+        std::thread older([&] { raced.reload((scripts / "d.cpp").string()); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        write_script(scripts / "d.cpp", "return 5;");
+        raced.reload((scripts / "d.cpp").string());
+        older.join();
+        if (call_answer(raced.get("d")) != 5) {
+            std::cerr << "script_registry_test: an older compile replaced a newer one" << std::endl;
+            break;
+        }
+        write_script(scripts / "d.cpp", "/* SLOW */ return 6;");
+        older = std::thread([&] { raced.reload((scripts / "d.cpp").string()); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        fs::remove(scripts / "d.cpp");
+        raced.remove((scripts / "d.cpp").string());
+        older.join();
+        if (raced.get("d")) {
+            std::cerr << "script_registry_test: a compile revived a deleted script" << std::endl;
+            break;
+        }
+
+        // Tiering: published at baseline, recompiled once hot
+        engine::ScriptRegistry tiered(scripts.string(), cache);
+        engine::TierConfig tiers;
+        tiers.hot_threshold = 3;
+        tiers.optimized_flags = { "-O2" };
+        tiered.enable_tiering(tiers);
+        if (!tiered.reload((scripts / "sub" / "b.cpp").string()) ||
+            tiered.tier("sub/b") != engine::ScriptTier::Baseline) {
+            std::cerr << "script_registry_test: tiered load" << std::endl;
+            break;
+        }
+        gen = tiered.generation();
+        for (int i = 0; i < 3; ++i) call_answer(tiered.call("sub/b"));
+        if (!wait_generation(tiered, gen, 30000) || tiered.tier("sub/b") != engine::ScriptTier::Optimized ||
+            call_answer(tiered.call("sub/b")) != 2) {
+            std::cerr << "script_registry_test: hot script not optimized" << std::endl;
+            break;
+        }
+        auto stats = tiered.stats();
+        if (stats.size() != 1 || stats[0].calls != 4) {
+            std::cerr << "script_registry_test: stats" << std::endl;
+            break;
+        }
+        // Reloading the unchanged source keeps the optimized build
+        if (!tiered.reload((scripts / "sub" / "b.cpp").string()) ||
+            tiered.tier("sub/b") != engine::ScriptTier::Optimized) {
+            std::cerr << "script_registry_test: unchanged reload dropped the optimized build" << std::endl;
+            break;
+        }
+        rc = 0;
+    } while (false);
+
+    fs::remove_all(root);
+    if (rc == 0) std::cout << "script_registry_test: succeeded" << std::endl;
+    return rc;
+}
@@ -0,0 +1,241 @@
+#include <iostream>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <cstring>
+#include "engine/script_cache.h"
+#include "engine/script_worker.h"
+#include "sandbox/policy.h"
+
+namespace fs = std::filesystem;
+
+// Handlers built against the ABI header from the source tree
+static const char* SCRIPT = R"(#include "engine/script_abi.h"
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+static nn_str lit(const char* s) { return nn_str{ s, strlen(s) }; }
+
+extern "C" int doGet(const nn_request* req, nn_response* res) {
+    if (req->abi_version != NN_SCRIPT_ABI_VERSION) return 1;
+    if (req->query.size == 5 && memcmp(req->query.data, "crash", 5) == 0) abort();
+    if (req->query.size == 4 && memcmp(req->query.data, "hang", 4) == 0) for (;;) pause();
+    if (req->query.size == 4 && memcmp(req->query.data, "fail", 4) == 0) return 7;
+    if (req->query.size == 3 && memcmp(req->query.data, "fds", 3) == 0) {
+        char n = '0';
+        for (int fd = 3; fd < 1024; ++fd) n += fcntl(fd, F_GETFD) != -1;
+        return res->write(res->ctx, &n, 1);
+    }
+    if (req->query.size == 7 && memcmp(req->query.data, "runtime", 7) == 0) {
+        // What handler code commonly does: grow buffers (large blocks are
+        // mmap()ed and grow with mremap()), run threads, sleep
+        volatile char* block = static_cast<char*>(malloc(1 << 20));
+        for (size_t n = 2 << 20; block && n <= (32u << 20); n *= 2) {
+            block = static_cast<char*>(realloc(const_cast<char*>(block), n));
+            if (block) block[n - 1] = 1;
+        }
+        if (!block) return 1;
+        free(const_cast<char*>(block));
+        std::string big;
+        for (int i = 0; i < 64; ++i) big.append(64 << 10, 'x');
+        std::vector<std::thread> threads;
+        long sum = 0;
+        for (int t = 0; t < 2; ++t) threads.emplace_back([&sum] {
+            std::this_thread::yield();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            __atomic_add_fetch(&sum, 1, __ATOMIC_RELAXED);
+        });
+        for (auto& th : threads) th.join();
+        std::random_device rd;
+        (void)rd();
+        big.resize(16);
+        const char* ok = sum == 2 ? "ok" : "bad";
+        return res->write(res->ctx, ok, strlen(ok));
+    }
+    res->set_status(res->ctx, 201);
+    res->add_header(res->ctx, lit("X-Path"), req->path);
+    for (size_t i = 0; i < req->header_count; ++i) {
+        if (req->headers[i].name.size == 6 && memcmp(req->headers[i].name.data, "X-Echo", 6) == 0)
+            res->write(res->ctx, req->headers[i].value.data, req->headers[i].value.size);
+    }
+    return 0;
+}
+
+extern "C" int doPost(const nn_request* req, nn_response* res) {
+    res->write(res->ctx, "got:", 4);
+    return res->write(res->ctx, req->body.data, req->body.size);
+}
+)";
+
+// Receive-side stand-in: place `raw` in the lease buffer and parse it
+static engine::ScriptResponse call(engine::ScriptWorkerPool::Lease& lease, const std::string& so, const std::string& raw,
+                                   const std::string& entry) {
+    memcpy(lease.request_buffer(), raw.data(), raw.size());
+    engine::RequestLayout layout;
+    size_t content_length = 0;
+    long head = engine::parse_request_head(lease.request_buffer(), raw.size(), layout, content_length);
+    if (head <= 0) return {};
+    layout.body = { static_cast<uint32_t>(head), static_cast<uint32_t>(content_length) };
+    return lease.invoke(so, entry, layout, raw.size());
+}
+
+int main() {
+    std::cout << "script_worker_test: starting" << std::endl;
+    engine::CompilerConfig cfg = engine::default_compiler_config();
+    if (engine::toolchain_version(cfg.compiler).empty()) {
+        std::cout << "no C++ compiler available; skipping test" << std::endl;
+        return 0;
+    }
+
+    char tmpl[] = "/tmp/script_worker_test_XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        std::cerr << "script_worker_test: mkdtemp failed" << std::endl;
+        return 2;
+    }
+    fs::path root = tmpl;
+    int rc = 2;
+
+    do {
+        // Request parsing
+        engine::RequestLayout layout;
+        size_t cl = 0;
+        std::string raw = "GET /a/b?x=1 HTTP/1.1\r\nHost: h\r\nContent-Length: 3\r\n\r\nabc";
+        long head = engine::parse_request_head(raw.data(), raw.size(), layout, cl);
+        if (head != static_cast<long>(raw.size()) - 3 || cl != 3 || layout.header_count != 2 ||
+            raw.substr(layout.path.off, layout.path.len) != "/a/b" || raw.substr(layout.query.off, layout.query.len) != "x=1" ||
+            raw.substr(layout.headers[0][1].off, layout.headers[0][1].len) != "h") {
+            std::cerr << "script_worker_test: parse_request_head" << std::endl;
+            break;
+        }
+        if (engine::parse_request_head(raw.data(), 20, layout, cl) != 0 ||
+            engine::parse_request_head("GARBAGE\r\n\r\n", 11, layout, cl) != -1) {
+            std::cerr << "script_worker_test: incomplete/malformed heads" << std::endl;
+            break;
+        }
+
+        std::ofstream(root / "handler.cpp") << SCRIPT;
+        cfg.flags.push_back("-I" SOURCE_DIR "/src");
+        engine::ScriptCache cache((root / "cache").string(), 64ULL << 20, cfg);
+        auto script = cache.load((root / "handler.cpp").string());
+        if (!script) {
+            std::cerr << "script_worker_test: compiling the handler failed" << std::endl;
+            break;
+        }
+
+        engine::ScriptWorkerOptions opts;
+        opts.workers = 2;
+        opts.timeout_ms = 500;
+        engine::ScriptWorkerPool pool(opts);
+        if (!pool.start()) {
+            std::cerr << "script_worker_test: pool failed to start" << std::endl;
+            break;
+        }
+
+        auto lease = pool.acquire();
+        auto r = call(lease, script->path(), "GET /hello HTTP/1.1\r\nX-Echo: ping\r\n\r\n", "doGet");
+        if (!r.ok || r.status != 201 || r.headers != "X-Path: /hello\r\n" || r.body != "ping") {
+            std::cerr << "script_worker_test: doGet status=" << r.status << " error=" << r.error << std::endl;
+            break;
+        }
+        // The response lives in the arena slot, next to the request
+        if (r.body.data() < lease.request_buffer() || r.body.data() > lease.request_buffer() + (2 << 20)) {
+            std::cerr << "script_worker_test: response not in the shared slot" << std::endl;
+            break;
+        }
+        r = call(lease, script->path(), "POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello", "doPost");
+        if (!r.ok || r.body != "got:hello") {
+            std::cerr << "script_worker_test: doPost body '" << r.body << "'" << std::endl;
+            break;
+        }
+        r = call(lease, script->path(), "GET /?runtime HTTP/1.1\r\n\r\n", "doGet");
+        if (!r.ok || r.body != "ok") {
+            std::cerr << "script_worker_test: runtime handler error=" << r.error << std::endl;
+            break;
+        }
+        // Only its own socket is open in the worker: not the arena memfd or
+        // anything else the server had
+        r = call(lease, script->path(), "GET /?fds HTTP/1.1\r\n\r\n", "doGet");
+        if (!r.ok || r.body != "1") {
+            std::cerr << "script_worker_test: worker has " << r.body << " descriptors open" << std::endl;
+            break;
+        }
+        r = call(lease, script->path(), "GET /?fail HTTP/1.1\r\n\r\n", "doGet");
+        if (r.ok || r.status != 500) {
+            std::cerr << "script_worker_test: handler error not reported" << std::endl;
+            break;
+        }
+        r = call(lease, script->path(), "PUT / HTTP/1.1\r\n\r\n", "doPut");
+        if (r.ok || r.error.empty()) {
+            std::cerr << "script_worker_test: missing entry point accepted" << std::endl;
+            break;
+        }
+
+        // A crash or a hang costs one worker, which is replaced
+        r = call(lease, script->path(), "GET /?crash HTTP/1.1\r\n\r\n", "doGet");
+        if (r.ok || r.status != 502 || pool.respawns() != 1) {
+            std::cerr << "script_worker_test: crash status=" << r.status << std::endl;
+            break;
+        }
+        r = call(lease, script->path(), "GET /?hang HTTP/1.1\r\n\r\n", "doGet");
+        if (r.ok || r.status != 504 || pool.respawns() != 2) {
+            std::cerr << "script_worker_test: timeout status=" << r.status << std::endl;
+            break;
+        }
+        r = call(lease, script->path(), "GET /again HTTP/1.1\r\n\r\n", "doGet");
+        if (!r.ok || r.headers != "X-Path: /again\r\n") {
+            std::cerr << "script_worker_test: replacement worker not usable" << std::endl;
+            break;
+        }
+
+        // Both workers can be leased at once
+        auto second = pool.acquire();
+        if (!second || second.request_buffer() == lease.request_buffer()) {
+            std::cerr << "script_worker_test: second lease shares a slot" << std::endl;
+            break;
+        }
+        // With every worker leased, acquire gives up at its deadline
+        if (pool.acquire(std::chrono::milliseconds(50))) {
+            std::cerr << "script_worker_test: acquire on a busy pool did not time out" << std::endl;
+            break;
+        }
+
+        // The shipped worker whitelist is enough for that handler
+        sandbox::ScriptPolicyConfig pcfg;
+        pcfg.seccomp_whitelist = SOURCE_DIR "/config/script_worker.syscalls.conf";
+        auto policy = sandbox::CompiledPolicy::compile(pcfg);
+        if (!policy) {
+            std::cout << "no libseccomp; skipping the worker whitelist check" << std::endl;
+            rc = 0;
+            break;
+        }
+        engine::ScriptWorkerOptions sopts;
+        sopts.workers = 1;
+        sopts.timeout_ms = 5000;
+        sopts.policy = policy;
+        engine::ScriptWorkerPool confined(sopts);
+        auto confined_lease = confined.start() ? confined.acquire() : engine::ScriptWorkerPool::Lease();
+        if (!confined_lease) {
+            std::cerr << "script_worker_test: confined pool failed to start" << std::endl;
+            break;
+        }
+        r = call(confined_lease, script->path(), "GET /?runtime HTTP/1.1\r\n\r\n", "doGet");
+        if (!r.ok || r.body != "ok") {
+            std::cerr << "script_worker_test: handler under the worker whitelist: status=" << r.status << " error=" << r.error
+                      << " body='" << r.body << "'" << std::endl;
+            break;
+        }
+        rc = 0;
+    } while (false);
+
+    fs::remove_all(root);
+    if (rc == 0) std::cout << "script_worker_test: succeeded" << std::endl;
+    return rc;
+}
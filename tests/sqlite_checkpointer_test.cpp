@@ -0,0 +1,158 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sqlite3.h>
+#include "services/sqlite_checkpointer.h"
+#include "services/sqlite_pool.h"
+#include "services/sqlite_writer.h"
+
+static const std::string ROW(2000, 'x');
+
+static bool insert_rows(services::SQLiteWriter& writer, int n, std::vector<double>* latencies_us = nullptr) {
+    for (int i = 0; i < n; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        if (!writer.execute("INSERT INTO blob(v) VALUES('" + ROW + "');").get()) return false;
+        if (latencies_us) {
+            latencies_us->push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+    return true;
+}
+
+static int64_t file_size(const std::string& path) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return 0;
+    std::fseek(f, 0, SEEK_END);
+    long size = std::ftell(f);
+    std::fclose(f);
+    return size;
+}
+
+static bool wait_for(const std::function<bool()>& cond) {
+    for (int i = 0; i < 500 && !cond(); ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return cond();
+}
+
+// Worst commit latency over `n` commits, with SQLite checkpointing inline or
+// a checkpointer doing it in the background
+static double worst_commit_us(const std::string& dbpath, bool background, int n) {
+    std::remove(dbpath.c_str());
+    std::remove((dbpath + "-wal").c_str());
+    services::CheckpointPolicy policy;
+    policy.passive_bytes = 4LL << 20; // SQLite's own default: 1000 pages
+    services::SQLiteCheckpointer checkpointer(dbpath, policy);
+    services::SQLiteWriterOptions opts;
+    opts.synchronous = "FULL";
+    if (background) opts.on_wal_commit = [&checkpointer](int pages) { checkpointer.notify(pages); };
+    services::SQLiteWriter writer(dbpath, opts);
+    if (!writer.start() || !writer.execute("CREATE TABLE blob(v TEXT);").get()) return -1;
+    if (background && !checkpointer.start()) return -1;
+    std::vector<double> lat;
+    if (!insert_rows(writer, n, &lat)) return -1;
+    writer.stop();
+    checkpointer.stop();
+    std::remove(dbpath.c_str());
+    std::remove((dbpath + "-wal").c_str());
+    return *std::max_element(lat.begin(), lat.end());
+}
+
+int main() {
+    std::cout << "sqlite_checkpointer_test: starting" << std::endl;
+    const std::string dbpath = "/tmp/native_node_sqlite_checkpointer_test.db";
+    const std::string walpath = dbpath + "-wal";
+    std::remove(dbpath.c_str());
+    std::remove(walpath.c_str());
+    int rc = 2;
+
+    do {
+        services::CheckpointPolicy policy;
+        policy.interval_ms = 50;
+        policy.passive_bytes = 256 << 10;
+        policy.limit_bytes = 2 << 20;
+        policy.busy_timeout_ms = 20;
+        services::SQLiteCheckpointer checkpointer(dbpath, policy);
+        services::SQLiteWriterOptions opts;
+        opts.on_wal_commit = [&checkpointer](int pages) { checkpointer.notify(pages); };
+        services::SQLiteWriter writer(dbpath, opts);
+        if (!writer.start() || !writer.execute("CREATE TABLE blob(v TEXT);").get() || !checkpointer.start()) {
+            std::cerr << "sqlite_checkpointer_test: start" << std::endl;
+            break;
+        }
+
+        // Passive checkpoints let the WAL be reset and reused instead of
+        // growing; should it outrun them, the limit still bounds it
+        if (!insert_rows(writer, 2000)) {
+            std::cerr << "sqlite_checkpointer_test: inserts failed" << std::endl;
+            break;
+        }
+        if (!wait_for([&] {
+                return checkpointer.count(services::CheckpointMode::Passive) > 0 && file_size(walpath) < policy.limit_bytes;
+            })) {
+            std::cerr << "sqlite_checkpointer_test: passive (" << checkpointer.count(services::CheckpointMode::Passive)
+                      << " runs, WAL " << file_size(walpath) << " bytes)" << std::endl;
+            break;
+        }
+        std::cout << "after 4 MB of rows: " << checkpointer.count(services::CheckpointMode::Passive)
+                  << " passive checkpoints, WAL " << file_size(walpath) << " bytes" << std::endl;
+
+        // A long reader pins the WAL; past the limit the checkpointer
+        // escalates, and once the reader is gone the WAL is truncated
+        services::SQLitePoolOptions ropts;
+        ropts.read_only = true;
+        services::SQLiteConnectionPool readers(dbpath, 1, ropts);
+        if (!readers.initialize()) {
+            std::cerr << "sqlite_checkpointer_test: readers" << std::endl;
+            break;
+        }
+        {
+            auto reader = readers.acquire();
+            sqlite3_exec(reader.get(), "BEGIN; SELECT COUNT(*) FROM blob;", nullptr, nullptr, nullptr);
+            if (!insert_rows(writer, 600)) {
+                std::cerr << "sqlite_checkpointer_test: inserts under a reader failed" << std::endl;
+                break;
+            }
+            if (file_size(walpath) < policy.limit_bytes ||
+                !wait_for([&] { return checkpointer.count(services::CheckpointMode::Truncate) > 0; })) {
+                std::cerr << "sqlite_checkpointer_test: no escalation with a pinned WAL" << std::endl;
+                break;
+            }
+            sqlite3_exec(reader.get(), "COMMIT;", nullptr, nullptr, nullptr);
+        }
+        if (!wait_for([&] { return file_size(walpath) == 0 && checkpointer.wal_bytes() == 0; })) {
+            std::cerr << "sqlite_checkpointer_test: WAL not truncated (" << file_size(walpath) << " bytes)" << std::endl;
+            break;
+        }
+        readers.shutdown();
+
+        std::ostringstream metrics;
+        checkpointer.render_prometheus(metrics);
+        if (metrics.str().find("native_node_sqlite_checkpoint_seconds_count{mode=\"truncate\"}") == std::string::npos ||
+            metrics.str().find("native_node_sqlite_wal_bytes 0") == std::string::npos) {
+            std::cerr << "sqlite_checkpointer_test: metrics\n" << metrics.str() << std::endl;
+            break;
+        }
+        writer.stop();
+        checkpointer.stop();
+
+        double inline_us = worst_commit_us(dbpath, false, 4000);
+        double background_us = worst_commit_us(dbpath, true, 4000);
+        std::cout << "worst commit: " << static_cast<long>(inline_us) << " us with inline checkpoints, "
+                  << static_cast<long>(background_us) << " us with the checkpointer" << std::endl;
+        if (inline_us < 0 || background_us < 0) {
+            std::cerr << "sqlite_checkpointer_test: latency run failed" << std::endl;
+            break;
+        }
+        rc = 0;
+    } while (false);
+
+    std::remove(dbpath.c_str());
+    std::remove(walpath.c_str());
+    if (rc == 0) std::cout << "sqlite_checkpointer_test: succeeded" << std::endl;
+    return rc;
+}
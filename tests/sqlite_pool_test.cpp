@@ -1,6 +1,8 @@
 #include <iostream>
+#include <atomic>
 #include <thread>
 #include <vector>
+#include <chrono>
 #include <cstdio>
 #include <sqlite3.h>
 #include "services/sqlite_pool.h"
@@ -18,59 +20,221 @@ int main() {
 
     // Create a table using one connection
     {
-        sqlite3* c = pool.acquire();
+        auto c = pool.acquire();
         char* err = nullptr;
-        int rc = sqlite3_exec(c, "CREATE TABLE kv(k TEXT PRIMARY KEY, v TEXT);", nullptr, nullptr, &err);
+        int rc = sqlite3_exec(c.get(), "CREATE TABLE kv(k TEXT PRIMARY KEY, v TEXT);", nullptr, nullptr, &err);
         if (rc != SQLITE_OK) {
             std::cerr << "create table failed: " << (err?err:"") << std::endl;
             if (err) sqlite3_free(err);
             return 2;
         }
-        pool.release(c);
     }
 
-    // Launch concurrent writers
+    // Launch concurrent writers (more threads than connections)
     auto writer = [&](int id){
         for (int i = 0; i < 50; ++i) {
-            sqlite3* c = pool.acquire();
+            auto c = pool.acquire();
+            sqlite3_busy_timeout(c.get(), 5000);
             std::string sql = "INSERT OR REPLACE INTO kv(k,v) VALUES('k" + std::to_string(id) + "_" + std::to_string(i) + "','v');";
             char* err = nullptr;
-            int rc = sqlite3_exec(c, sql.c_str(), nullptr, nullptr, &err);
+            int rc = sqlite3_exec(c.get(), sql.c_str(), nullptr, nullptr, &err);
             if (rc != SQLITE_OK) {
                 std::cerr << "insert failed: " << (err?err:"") << std::endl;
                 if (err) sqlite3_free(err);
             }
-            pool.release(c);
         }
     };
 
     std::vector<std::thread> threads;
-    for (int t = 0; t < 4; ++t) threads.emplace_back(writer, t);
+    for (int t = 0; t < 8; ++t) threads.emplace_back(writer, t);
     for (auto& th : threads) th.join();
 
     // Verify some reads
     {
-        sqlite3* c = pool.acquire();
+        auto c = pool.acquire();
         sqlite3_stmt* stmt = nullptr;
-        int rc = sqlite3_prepare_v2(c, "SELECT COUNT(*) FROM kv;", -1, &stmt, nullptr);
+        int rc = sqlite3_prepare_v2(c.get(), "SELECT COUNT(*) FROM kv;", -1, &stmt, nullptr);
         if (rc != SQLITE_OK) {
             std::cerr << "prepare failed: " << sqlite3_errstr(rc) << std::endl;
-            pool.release(c);
             return 2;
         }
         rc = sqlite3_step(stmt);
         if (rc == SQLITE_ROW) {
             int count = sqlite3_column_int(stmt, 0);
             std::cout << "row count: " << count << std::endl;
-            if (count <= 0) {
+            if (count != 8 * 50) {
                 std::cerr << "unexpected row count" << std::endl;
                 sqlite3_finalize(stmt);
-                pool.release(c);
                 return 2;
             }
         }
         sqlite3_finalize(stmt);
-        pool.release(c);
+    }
+
+    // A thread gets its previous connection back
+    {
+        sqlite3* first = nullptr;
+        {
+            auto c = pool.acquire();
+            first = c.get();
+        }
+        uint64_t hits = pool.affinity_hits();
+        auto again = pool.acquire();
+        if (again.get() != first || pool.affinity_hits() != hits + 1) {
+            std::cerr << "affinity: did not get the previous connection back" << std::endl;
+            return 2;
+        }
+    }
+
+    // A transaction left open is rolled back before the connection is reused
+    {
+        sqlite3* conn = nullptr;
+        {
+            auto c = pool.acquire();
+            conn = c.get();
+            sqlite3_exec(c.get(), "BEGIN; SELECT COUNT(*) FROM kv;", nullptr, nullptr, nullptr);
+            if (sqlite3_get_autocommit(c.get())) {
+                std::cerr << "rollback: BEGIN did not open a transaction" << std::endl;
+                return 2;
+            }
+        }
+        if (!sqlite3_get_autocommit(conn)) {
+            std::cerr << "rollback: connection returned to the pool inside a transaction" << std::endl;
+            return 2;
+        }
+    }
+
+    // Exhausted pool: acquire times out, then succeeds once one is released
+    {
+        std::vector<services::SQLiteConnHandle> held;
+        for (size_t i = 0; i < pool.size(); ++i) held.push_back(pool.acquire());
+        auto start = std::chrono::steady_clock::now();
+        auto none = pool.acquire(std::chrono::milliseconds(50));
+        auto waited = std::chrono::steady_clock::now() - start;
+        if (none || waited < std::chrono::milliseconds(40)) {
+            std::cerr << "timeout: acquire on an exhausted pool did not time out" << std::endl;
+            return 2;
+        }
+        std::thread releaser([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            held.back().release();
+        });
+        auto late = pool.acquire(std::chrono::milliseconds(5000));
+        releaser.join();
+        if (!late) {
+            std::cerr << "timeout: waiter not woken by release" << std::endl;
+            return 2;
+        }
+    }
+
+    // No connection is ever handed to two threads at once
+    {
+        std::vector<sqlite3*> conns;
+        std::vector<services::SQLiteConnHandle> all;
+        for (size_t i = 0; i < pool.size(); ++i) {
+            all.push_back(pool.acquire());
+            conns.push_back(all.back().get());
+        }
+        all.clear();
+        std::vector<std::atomic<int>> owners(conns.size());
+        std::atomic<bool> overlap{ false };
+        std::vector<std::thread> hammer;
+        for (int t = 0; t < 8; ++t) {
+            hammer.emplace_back([&] {
+                for (int i = 0; i < 20000; ++i) {
+                    auto c = pool.acquire();
+                    size_t idx = 0;
+                    while (conns[idx] != c.get()) ++idx;
+                    if (owners[idx].fetch_add(1) != 0) overlap = true;
+                    owners[idx].fetch_sub(1);
+                }
+            });
+        }
+        for (auto& th : hammer) th.join();
+        if (overlap) {
+            std::cerr << "exclusivity: a connection was shared" << std::endl;
+            return 2;
+        }
+    }
+
+    // Uncontended acquire/release cost
+    {
+        const int N = 1000000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) pool.acquire();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "acquire+release: " << ns / N << " ns" << std::endl;
+    }
+
+    // Statement cache: repeated SQL reuses a cached statement, handed out reset
+    // with no bindings; the least recently used one is evicted
+    {
+        services::SQLitePoolOptions opts;
+        opts.statement_cache = 2;
+        services::SQLiteConnectionPool small(dbpath, 1, opts);
+        if (!small.initialize()) {
+            std::cerr << "statements: failed to init pool" << std::endl;
+            return 2;
+        }
+        auto c = small.acquire();
+        const std::string by_key = "SELECT v FROM kv WHERE k = ?;";
+        {
+            auto stmt = c.prepare(by_key);
+            sqlite3_bind_text(stmt.get(), 1, "k0_0", -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt.get()) != SQLITE_ROW) {
+                std::cerr << "statements: lookup failed" << std::endl;
+                return 2;
+            }
+            // Same SQL while the first is out gets its own statement
+            auto nested = c.prepare(by_key);
+            if (!nested || nested.get() == stmt.get()) {
+                std::cerr << "statements: checked-out statement handed out twice" << std::endl;
+                return 2;
+            }
+        }
+        {
+            auto stmt = c.prepare(by_key);
+            if (small.statement_hits() != 1 || sqlite3_bind_parameter_count(stmt.get()) != 1 ||
+                sqlite3_step(stmt.get()) != SQLITE_DONE) { // unbound: matches nothing
+                std::cerr << "statements: cached statement not reused clean" << std::endl;
+                return 2;
+            }
+        }
+        c.prepare("SELECT 1;");
+        c.prepare("SELECT 2;"); // evicts by_key
+        c.prepare(by_key);
+        if (small.statement_hits() != 1 || small.statement_misses() != 5) {
+            std::cerr << "statements: " << small.statement_hits() << " hits, " << small.statement_misses() << " misses" << std::endl;
+            return 2;
+        }
+        if (c.prepare("SELEC nonsense")) {
+            std::cerr << "statements: invalid SQL prepared" << std::endl;
+            return 2;
+        }
+
+        // Cost of a lookup by key, re-preparing vs cached
+        const int N = 100000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) {
+            sqlite3_stmt* stmt = nullptr;
+            sqlite3_prepare_v2(c.get(), by_key.c_str(), -1, &stmt, nullptr);
+            sqlite3_bind_text(stmt, 1, "k0_0", -1, SQLITE_STATIC);
+            sqlite3_step(stmt);
+            sqlite3_finalize(stmt);
+        }
+        auto prepared = std::chrono::steady_clock::now() - start;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) {
+            auto stmt = c.prepare(by_key);
+            sqlite3_bind_text(stmt.get(), 1, "k0_0", -1, SQLITE_STATIC);
+            sqlite3_step(stmt.get());
+        }
+        auto cached = std::chrono::steady_clock::now() - start;
+        std::cout << "lookup: " << std::chrono::duration_cast<std::chrono::nanoseconds>(prepared).count() / N
+                  << " ns re-preparing, " << std::chrono::duration_cast<std::chrono::nanoseconds>(cached).count() / N
+                  << " ns cached" << std::endl;
+        c.release();
+        small.shutdown();
     }
 
     pool.shutdown();
@@ -0,0 +1,155 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+#include "services/sqlite_pool.h"
+#include "services/sqlite_query_guard.h"
+#include "services/sqlite_stream.h"
+
+int main() {
+    std::cout << "sqlite_stream_test: starting" << std::endl;
+    const std::string dbpath = "/tmp/native_node_sqlite_stream_test.db";
+    std::remove(dbpath.c_str());
+    int rc = 2;
+
+    do {
+        services::SQLiteConnectionPool pool(dbpath, 1);
+        if (!pool.initialize()) {
+            std::cerr << "sqlite_stream_test: pool" << std::endl;
+            break;
+        }
+        auto conn = pool.acquire();
+        const char* setup =
+            "CREATE TABLE t(id INTEGER, name TEXT, score REAL, data BLOB, note TEXT);"
+            "INSERT INTO t VALUES(1, 'quote\" back\\ nl\n tab\t ctl' || char(1), 1.5, x'00ff10', NULL);"
+            "INSERT INTO t VALUES(2, 'plain', 1e308 * 10, x'616263', 'x');";
+        if (sqlite3_exec(conn.get(), setup, nullptr, nullptr, nullptr) != SQLITE_OK) {
+            std::cerr << "sqlite_stream_test: setup" << std::endl;
+            break;
+        }
+
+        // Encoding of every column type, both formats
+        std::string out;
+        auto collect = [&out](const char* data, size_t size) {
+            out.append(data, size);
+            return true;
+        };
+        {
+            auto stmt = conn.prepare("SELECT id, name, score, data, note FROM t ORDER BY id;");
+            if (!services::stream_rows(stmt.get(), services::RowFormat::Json, 1 << 16, collect)) {
+                std::cerr << "sqlite_stream_test: json" << std::endl;
+                break;
+            }
+        }
+        const std::string expected =
+            "[{\"id\":1,\"name\":\"quote\\\" back\\\\ nl\\n tab\\t ctl\\u0001\",\"score\":1.5,\"data\":\"AP8Q\",\"note\":null},"
+            "{\"id\":2,\"name\":\"plain\",\"score\":null,\"data\":\"YWJj\",\"note\":\"x\"}]";
+        if (out != expected) {
+            std::cerr << "sqlite_stream_test: json encoding\n" << out << std::endl;
+            break;
+        }
+        out.clear();
+        {
+            auto stmt = conn.prepare("SELECT id FROM t ORDER BY id;");
+            services::stream_rows(stmt.get(), services::RowFormat::Ndjson, 1 << 16, collect);
+        }
+        if (out != "{\"id\":1}\n{\"id\":2}\n") {
+            std::cerr << "sqlite_stream_test: ndjson encoding\n" << out << std::endl;
+            break;
+        }
+        out.clear();
+        {
+            auto stmt = conn.prepare("SELECT id FROM t WHERE id > 5;");
+            services::stream_rows(stmt.get(), services::RowFormat::Json, 1 << 16, collect);
+        }
+        if (out != "[]") {
+            std::cerr << "sqlite_stream_test: empty result " << out << std::endl;
+            break;
+        }
+
+        // A large result goes out in bounded chunks, never as a whole
+        if (sqlite3_exec(conn.get(),
+                         "CREATE TABLE big(id INTEGER PRIMARY KEY, v TEXT);"
+                         "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 200000) "
+                         "INSERT INTO big SELECT i, printf('row %d', i) FROM n;",
+                         nullptr, nullptr, nullptr) != SQLITE_OK) {
+            std::cerr << "sqlite_stream_test: big table" << std::endl;
+            break;
+        }
+        const size_t flush = 64 * 1024;
+        size_t total = 0, largest = 0, chunks = 0, lines = 0;
+        auto start = std::chrono::steady_clock::now();
+        bool ok;
+        {
+            auto stmt = conn.prepare("SELECT id, v FROM big;");
+            ok = services::stream_rows(stmt.get(), services::RowFormat::Ndjson, flush, [&](const char* data, size_t size) {
+                total += size;
+                largest = std::max(largest, size);
+                ++chunks;
+                lines += static_cast<size_t>(std::count(data, data + size, '\n'));
+                return true;
+            });
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "200000 rows: " << total << " bytes in " << chunks << " chunks (largest " << largest << ") in "
+                  << ms << " ms" << std::endl;
+        if (!ok || lines != 200000 || largest > flush + 256) {
+            std::cerr << "sqlite_stream_test: chunking" << std::endl;
+            break;
+        }
+
+        // A sink that stops (client gone) stops the stepping
+        size_t calls = 0;
+        {
+            auto stmt = conn.prepare("SELECT id, v FROM big;");
+            ok = services::stream_rows(stmt.get(), services::RowFormat::Json, 1024, [&calls](const char*, size_t) {
+                return ++calls < 3;
+            });
+        }
+        if (ok || calls != 3) {
+            std::cerr << "sqlite_stream_test: refused chunk did not stop the stream" << std::endl;
+            break;
+        }
+        // The guard lets through one row-returning read and nothing else
+        services::ReadQueryGuard guard(dbpath);
+        if (!guard.open()) {
+            std::cerr << "sqlite_stream_test: guard" << std::endl;
+            break;
+        }
+        const char* rejected[] = {
+            "BEGIN", "SAVEPOINT s", "ATTACH '/tmp/other.db' AS o", "PRAGMA table_info(t)",
+            "INSERT INTO t(id) VALUES(3)", "SELECT 1; DELETE FROM t", "SELECT 1; BEGIN", "SELEC 1", "",
+        };
+        bool all_rejected = true;
+        for (const char* sql : rejected) {
+            std::string error;
+            if (guard.check(sql, error) || error.empty()) {
+                std::cerr << "sqlite_stream_test: guard accepted " << sql << std::endl;
+                all_rejected = false;
+            }
+        }
+        if (!all_rejected) break;
+        std::string error;
+        services::ReadQueryInfo info;
+        if (!guard.check("SELECT 1; -- trailing comment", error) ||
+            !guard.check("WITH x AS (SELECT id FROM big) SELECT count(*) FROM x /* done */ ;", error, &info)) {
+            std::cerr << "sqlite_stream_test: guard rejected a read: " << error << std::endl;
+            break;
+        }
+        if (info.tables != std::vector<std::string>{ "big" } ||
+            std::find(info.functions.begin(), info.functions.end(), "count") == info.functions.end()) {
+            std::cerr << "sqlite_stream_test: guard info" << std::endl;
+            break;
+        }
+        conn.release();
+        pool.shutdown();
+        rc = 0;
+    } while (false);
+
+    std::remove(dbpath.c_str());
+    if (rc == 0) std::cout << "sqlite_stream_test: succeeded" << std::endl;
+    return rc;
+}
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sqlite3.h>
+#include "services/sqlite_pool.h"
+#include "services/sqlite_writer.h"
+
+static int count_rows(services::SQLiteConnectionPool& readers) {
+    auto c = readers.acquire();
+    sqlite3_stmt* stmt = nullptr;
+    int n = -1;
+    if (sqlite3_prepare_v2(c.get(), "SELECT COUNT(*) FROM kv;", -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        n = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return n;
+}
+
+// Rows/s for `threads` x `per_thread` single-row transactions
+static double write_rate(size_t max_batch, int threads, int per_thread) {
+    const std::string dbpath = "/tmp/native_node_sqlite_writer_rate.db";
+    std::remove(dbpath.c_str());
+    services::SQLiteWriterOptions opts;
+    opts.max_batch = max_batch;
+    services::SQLiteWriter writer(dbpath, opts);
+    if (!writer.start() || !writer.execute("CREATE TABLE kv(k TEXT PRIMARY KEY, v TEXT);").get()) return 0;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            std::vector<std::future<bool>> pending;
+            for (int i = 0; i < per_thread; ++i) {
+                pending.push_back(writer.execute("INSERT INTO kv VALUES('" + std::to_string(t) + "_" + std::to_string(i) + "','v');"));
+                // Callers wait for their commit every few writes, like request handlers
+                if (pending.size() == 8) {
+                    for (auto& f : pending) f.get();
+                    pending.clear();
+                }
+            }
+            for (auto& f : pending) f.get();
+        });
+    }
+    for (auto& th : pool) th.join();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    writer.stop();
+    std::remove(dbpath.c_str());
+    return threads * per_thread / secs;
+}
+
+int main() {
+    std::cout << "sqlite_writer_test: starting" << std::endl;
+    const std::string dbpath = "/tmp/native_node_sqlite_writer_test.db";
+    std::remove(dbpath.c_str());
+    int rc = 2;
+
+    do {
+        services::SQLiteWriter writer(dbpath);
+        if (!writer.start() || !writer.execute("CREATE TABLE kv(k TEXT PRIMARY KEY, v TEXT);").get()) {
+            std::cerr << "sqlite_writer_test: start" << std::endl;
+            break;
+        }
+        services::SQLitePoolOptions ropts;
+        ropts.read_only = true;
+        ropts.mmap_size = 64 << 20;
+        services::SQLiteConnectionPool readers(dbpath, 2, ropts);
+        if (!readers.initialize()) {
+            std::cerr << "sqlite_writer_test: read-only pool" << std::endl;
+            break;
+        }
+
+        // Concurrent submitters; every future resolves true and all rows land
+        std::vector<std::thread> threads;
+        std::atomic<int> failures{ 0 };
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&, t] {
+                std::vector<std::future<bool>> futs;
+                for (int i = 0; i < 100; ++i) {
+                    futs.push_back(writer.execute("INSERT INTO kv VALUES('k" + std::to_string(t) + "_" + std::to_string(i) + "','v');"));
+                }
+                for (auto& f : futs) if (!f.get()) ++failures;
+            });
+        }
+        for (auto& th : threads) th.join();
+        if (failures != 0 || count_rows(readers) != 800) {
+            std::cerr << "sqlite_writer_test: concurrent writes (" << failures << " failed)" << std::endl;
+            break;
+        }
+        std::cout << writer.transactions() << " transactions in " << writer.commits() << " commits" << std::endl;
+
+        // A failing transaction is rolled back alone; its group still commits
+        auto good1 = writer.execute("INSERT INTO kv VALUES('a','v');");
+        auto bad = writer.execute("INSERT INTO kv VALUES('b','v'); INSERT INTO kv VALUES('a','dup');");
+        auto good2 = writer.submit([](sqlite3* db) {
+            return sqlite3_exec(db, "INSERT INTO kv VALUES('c','v');", nullptr, nullptr, nullptr) == SQLITE_OK;
+        });
+        if (!good1.get() || bad.get() || !good2.get() || count_rows(readers) != 802) {
+            std::cerr << "sqlite_writer_test: savepoint isolation" << std::endl;
+            break;
+        }
+
+        // Readers cannot write
+        {
+            auto c = readers.acquire();
+            if (sqlite3_exec(c.get(), "INSERT INTO kv VALUES('x','v');", nullptr, nullptr, nullptr) != SQLITE_READONLY) {
+                std::cerr << "sqlite_writer_test: reader accepted a write" << std::endl;
+                break;
+            }
+        }
+
+        // After stop nothing is accepted
+        writer.stop();
+        if (writer.execute("INSERT INTO kv VALUES('late','v');").get()) {
+            std::cerr << "sqlite_writer_test: write accepted after stop" << std::endl;
+            break;
+        }
+
+        double single = write_rate(1, 8, 100);
+        double grouped = write_rate(256, 8, 100);
+        std::cout << "writes/s: " << static_cast<long>(single) << " committing one at a time, " << static_cast<long>(grouped)
+                  << " with group commit" << std::endl;
+        if (grouped <= 0 || single <= 0) {
+            std::cerr << "sqlite_writer_test: throughput run failed" << std::endl;
+            break;
+        }
+        readers.shutdown();
+        rc = 0;
+    } while (false);
+
+    std::remove(dbpath.c_str());
+    if (rc == 0) std::cout << "sqlite_writer_test: succeeded" << std::endl;
+    return rc;
+}
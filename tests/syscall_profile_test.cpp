@@ -0,0 +1,41 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "sandbox/syscall_profile.h"
+#include "sandbox/seccomp.h"
+
+int main() {
+    std::cout << "syscall_profile_test: starting" << std::endl;
+    sandbox::SyscallCounts counts;
+    // The shell forks, so this also exercises following child processes
+    if (!sandbox::profile_syscalls({"/bin/sh", "-c", "/bin/true; echo profiled"}, counts, 10)) {
+        std::cerr << "profile_syscalls failed" << std::endl;
+        return 2;
+    }
+    if (counts.find("execve") == counts.end() || counts.find("exit_group") == counts.end()) {
+        std::cerr << "expected execve and exit_group in profile" << std::endl;
+        return 2;
+    }
+
+    const std::string out = "/tmp/native_node_profiled_syscalls.conf";
+    if (!sandbox::write_profiled_whitelist(out, counts, {"getrandom"})) {
+        std::cerr << "write_profiled_whitelist failed" << std::endl;
+        return 2;
+    }
+
+    // Reading it back must yield the hottest syscall first
+    std::vector<std::string> names;
+    if (!sandbox::read_seccomp_whitelist(out, names) || names.size() < counts.size()) {
+        std::cerr << "failed to read back whitelist" << std::endl;
+        return 2;
+    }
+    for (const auto& kv : counts) {
+        if (kv.second > counts[names.front()]) {
+            std::cerr << "whitelist not ordered by frequency: " << kv.first << " hotter than " << names.front() << std::endl;
+            return 2;
+        }
+    }
+
+    std::cout << "syscall_profile_test: succeeded (hottest: " << names.front() << ")" << std::endl;
+    return 0;
+}